@@ -11,9 +11,15 @@ extern "C" {
 #include <cLinkedList.h>
 #include <NIDAQmx.h>
 #include <macrodef.h>
-#include <msunistd.h>
+#if defined(_WIN32) || defined(_WIN64)
+	#include <msunistd.h>
+	#include <targetver.h>
+#endif
+#include <quickDAQ_compiler.h>
+#include <quickDAQ_scale.h>
+#include <quickDAQ_hist.h>
+#include <quickDAQ_logfile.h>
 #include <stdafx.h>
-#include <targetver.h>
 #include <stdbool.h>
 
 //-----------------------------
@@ -38,6 +44,19 @@ extern "C" {
 #define DAQMX_MAX_PIN_CNT			32
 #define DAQMX_MAX_PIN_STR_LEN		16 + 1
 
+//quickDAQ real-time bring-up: stack bytes touched before the loop starts
+#define QUICKDAQ_STACK_PREFAULT		(64 * 1024)
+
+//quickDAQ frame snapshots: attempts before a reader gives up on a frame being rewritten
+#define QUICKDAQ_SNAPSHOT_RETRIES	64
+
+//quickDAQ event dispatch constants
+#define QUICKDAQ_MAX_EVENT_HANDLERS	32
+#define QUICKDAQ_EVENT_IDLE_MS		100
+
+//quickDAQ task table constants: one task group per I/O mode
+#define NITASK_GROUP_CNT			6
+
 //DAQmx default sample clock source
 #define DAQMX_SAMPLE_CLK_SRC_FINITE		"OnboardClock"
 #define DAQMX_SAMPLE_CLK_SRC_HW_CLOCKED	"/PXI1Slot5/ai/SampleClock"
@@ -70,6 +89,8 @@ typedef enum _quickDAQStatusModes {
 typedef enum _quickDAQErrorCodes {
 	/*! Library has encountered an unknown error*/
 	ERROR_UNKNOWN = -99,
+	/*! The replay source has no more recorded samples (see setReplay).*/
+	ERROR_REPLAYEND = -8,
 	/*! Library is not ready to run. Configure library, sample clock and pin mode first!*/
 	ERROR_NOTREADY = -7,
 	/*! A feature or functionality that is unsupported by quickDAQ requested.*/
@@ -147,16 +168,249 @@ typedef enum _trigger_modes {
 	FALLING = DAQmx_Val_Falling
 }triggerModes;
 
+// Background reader ring of a task and seqlock-published frame (see setBackgroundAcquisition and
+// setFramePublishing), defined by the library
+typedef struct _quickDAQring quickDAQring;
+typedef struct _quickDAQframePub quickDAQframePub;
+
+
+
+/*!
+* Defines the metadata of a frame snapshot.
+*/
+typedef struct _quickDAQframeInfo {
+	uInt64	frameNum;	// 1 for the first frame published since quickDAQstart()
+	uInt64	timestamp;	// qdMonotonicNs() at publication
+} quickDAQframeInfo;
+
 /*!
-* Defines the details of each NI-DAQmx task
+* Enumerates how a replay source (see setReplay) advances through the recorded log.
 */
-typedef struct _NItask {
+typedef enum _replayModes {
+	/*! One row per tick at the recorded sample rate, paced like the ON_DEMAND software clock.*/
+	REPLAY_PACED = 0,
+	/*! One row per tick as fast as the loop runs.*/
+	REPLAY_FAST
+} replayModes;
+
+/*!
+* Defines a replay source: a columnar data log read back chunk by chunk on the control thread.
+* Each tick (syncSampling or quickDAQcycle) moves to the next recorded row; input reads copy that
+* row into the task buffers instead of reading the driver.
+*/
+typedef struct _quickDAQreplaySource {
+	FILE				*file;
+	quickDAQlogHeader	header;
+	quickDAQlogColumn	*columnInfo;
+	size_t				*columnOffset;	// bytes from the start of the chunk data
+	char				*chunk;			// chunk being replayed
+	unsigned			chunkRowCnt;	// valid rows of 'chunk'
+	unsigned			row;
+	uInt64				nextChunk;
+	uInt64				rowCount;		// rows replayed since quickDAQstart()
+	bool32				isDone;
+	replayModes			mode;
+	// Recorded input columns mapped to configured channels
+	unsigned			inputCount;
+	struct _NItask		**inputTask;
+	unsigned			*inputIdx;		// position in the task buffer
+	unsigned			*inputColumn;
+	float64				*inputValue;	// value of the current row
+} quickDAQreplaySource;
+
+/*!
+* Defines the details of each NI-DAQmx task. Tasks live in the contiguous 'NItaskTable',
+* one cache line (or more) per task.
+*/
+typedef struct QD_CACHE_ALIGNED _NItask {
 	TaskHandle	taskHandler;
 	IOmodes		taskType;
 	unsigned	pinCount;
 	void*		dataBuffer;
+	// Input tasks are double-buffered: reads land in 'backBuffer' which is then swapped to the front
+	void*		backBuffer;
+	// Incremented on every hardware read; lets multi-device tasks serve one read per cycle
+	uInt64		frameSeq;
+	// Set at every cycle boundary (syncSampling, quickDAQcycle): the next device read goes to hardware
+	bool32		frameStale;
+	// Background reader ring, only used for opt-in CONTINUOUS acquisition
+	quickDAQring	*ring;
+	// First NI-DAQmx error since the last (re)start; non-zero marks the task for quickDAQrecover()
+	volatile int32	faultCode;
+	// Output tasks only: safe-state frame written by enterSafeState() (zeros unless set)
+	void*		safeBuffer;
+	// Set when 'ring' is filled by NI-DAQmx Every N Samples callbacks instead of a reader thread
+	bool32		eventDriven;
+	// Input tasks only: latest frame for other threads, see setFramePublishing()
+	quickDAQframePub	*published;
+	// Raw ANALOG IN tasks only: int16 counts of the front frame (followed by those of the previous
+	// frame) and the scaling polynomial of every channel, stored as QUICKDAQ_SCALE_COEFFS planes of
+	// 'pinCount' coefficients
+	int16		*rawBuffer;
+	float64		*scaleCoeffs;
 } NItask;
 
+/*!
+* One entry of the non-fatal error ring: what failed, in which task, and when (qdMonotonicNs).
+*/
+typedef struct _quickDAQerror {
+	int32			code;
+	struct _NItask	*task;
+	uInt64			timestamp;
+} quickDAQerror;
+
+/*!
+* Cycle timing histograms kept by the timing recorder. All values are in nanoseconds.
+*/
+typedef enum _timingHists {
+	/*! Time blocked in the sample clock wait.*/
+	TIMING_WAIT = 0,
+	/*! Interval between successive wake-ups from the sample clock wait.*/
+	TIMING_PERIOD,
+	/*! Wake-up interval in excess of the nominal sample period (0 if on time).*/
+	TIMING_LATENESS,
+	/*! Time spent flushing outputs before the wait.*/
+	TIMING_WRITE,
+	/*! Time spent reading inputs after the wait.*/
+	TIMING_READ,
+	/*! Polling wait strategies: time from the last empty poll to the poll that saw the new sample.*/
+	TIMING_WAKE,
+	TIMING_HIST_CNT
+} timingHists;
+
+/*!
+* Strategies for waiting on the next sample clock edge (see setWaitStrategy).
+*/
+typedef enum _waitModes {
+	/*! Block in DAQmxWaitForNextSampleClock (default).*/
+	WAIT_BLOCKING = 0,
+	/*! Spin on the number of acquired samples of an input task; burns a CPU.*/
+	WAIT_BUSY_POLL,
+	/*! Sleep until shortly before the predicted edge, then spin.*/
+	WAIT_HYBRID
+} waitModes;
+
+/*!
+* What quickDAQcycle() does after a cycle whose sample clock wait reported a late (missed) edge.
+*/
+typedef enum _missPolicies {
+	/*! Treat the cycle as on time (default).*/
+	MISS_IGNORE = 0,
+	/*! Do not write outputs in the cycle after a miss.*/
+	MISS_SKIP_OUTPUT,
+	/*! Re-write the last frame written before the miss instead of the new one.*/
+	MISS_HOLD_OUTPUT,
+	/*! Replace the late input frame by linear extrapolation of the two previous frames, at most 'missLimit' frames in a row.*/
+	MISS_EXTRAPOLATE,
+	/*! Advance the cycle count by the number of missed edges, so the controller can catch up.*/
+	MISS_CATCH_UP,
+	/*! Write the safe-state outputs after 'missLimit' consecutive misses and keep them until cleared.*/
+	MISS_SAFE_STATE
+} missPolicies;
+
+/*!
+* Running cycle timing statistics, written by the control thread only.
+*/
+typedef struct _quickDAQtiming {
+	bool32			enabled;
+	uInt64			ticks;
+	// Cycles for which NI-DAQmx reported a late sample clock
+	uInt64			lateSamples;
+	// Wake-ups more than 1.5 nominal periods apart, i.e. at least one clock edge missed
+	uInt64			missedTicks;
+	uInt64			lateRun;
+	uInt64			maxLateRun;
+	// Polling waits whose first poll already saw the new sample (e.g. hybrid sleep overshot the edge)
+	uInt64			wakeOvershoots;
+	uInt64			lastWaitBegin;
+	uInt64			lastWaitEnd;
+	bool32			lastLate;
+	quickDAQhist	hist[TIMING_HIST_CNT];
+} quickDAQtiming;
+
+/*!
+* Read-only view of one block delivered to an event handler. Blocks are scan-interleaved with
+* 'stride' samples per scan; channel k of scan s lives at quickDAQblockAt(view, s, k).
+* The view is only valid during the handler call.
+*/
+typedef struct _quickDAQblockView {
+	const float64	*data;
+	const unsigned	*chanIdx;
+	unsigned		len;
+	unsigned		stride;
+	unsigned		scans;
+	uInt64			blockSeq;
+} quickDAQblockView;
+
+#define quickDAQblockAt(view, scan, k)	((view).data[(size_t)(scan) * (view).stride + (((view).chanIdx != NULL) ? (view).chanIdx[(k)] : (k))])
+
+typedef void (*quickDAQblockHandler)(quickDAQblockView block, void* userData);
+typedef void (*quickDAQdoneHandler)(int32 taskStatus, void* userData);
+
+// Watchdog escalation hook: 'lastBeat' is the heartbeat count at which the loop stalled
+typedef void (*quickDAQwatchdogHandler)(uInt64 lastBeat, void* userData);
+
+/*!
+* A registered event handler: a block handler for one task (or one device's slice of it),
+* or a done handler if 'task' is NULL.
+*/
+typedef struct _quickDAQeventHandler {
+	struct _NItask			*task;
+	int						devNum;
+	unsigned				nSamples;
+	quickDAQblockHandler	onBlock;
+	quickDAQdoneHandler		onDone;
+	void					*userData;
+} quickDAQeventHandler;
+
+/*!
+* Defines the slot range of one I/O mode group inside the contiguous task table.
+*/
+typedef struct _NItaskGroup {
+	unsigned	first;
+	unsigned	count;
+	unsigned	capacity;
+} NItaskGroup;
+
+/*!
+* Operations of the flat per-cycle execution plan compiled at quickDAQstart().
+*/
+typedef enum _cycleOps {
+	/*! Cycle step: flush the ANALOG OUT task buffer to hardware.*/
+	CYCLE_WRITE_ANALOG	= 0,
+	/*! Cycle step: flush the DIGITAL OUT task buffer to hardware.*/
+	CYCLE_WRITE_DIGITAL	= 1,
+	/*! Cycle step: wait for the next sample clock on the clock master task (the software clock if it has no task).*/
+	CYCLE_WAIT_CLOCK	= 2,
+	/*! Cycle step: read the ANALOG IN task into its buffer.*/
+	CYCLE_READ_ANALOG	= 3,
+	/*! Cycle step: read a COUNTER ANGLE IN task into its buffer.*/
+	CYCLE_READ_COUNTER	= 4,
+	/*! Cycle step: refresh a task buffer with the latest frame of its background reader ring.*/
+	CYCLE_READ_RING		= 5,
+	/*! Cycle step: copy the current replay row into an input task buffer.*/
+	CYCLE_READ_REPLAY	= 6
+}cycleOps;
+
+/*!
+* Defines one step of the per-cycle execution plan.
+*/
+typedef struct _cycleStep {
+	cycleOps	op;
+	TaskHandle	taskHandler;
+	NItask		*task;
+} cycleStep;
+
+/*!
+* Defines the arguments of a parallel cycle phase (a run of consecutive I/O steps).
+*/
+typedef struct _cyclePhase {
+	cycleStep	*steps;
+	int32		*errors;
+	bool32		outputsLate;
+	bool32		extrapolate;	// input reads replaced by extrapolation (see missExtrapolates)
+} cyclePhase;
+
 /*!
 * Defines details on a device pin/channel.
 */
@@ -167,6 +421,53 @@ typedef struct _pinInfo {
 	NItask				*pinTask;
 }pinInfo;
 
+/*!
+* Zero-copy read-only view of a device's input channels inside a task's front buffer.
+* Channel k lives at data[chanIdx[k]], or at data[k] when 'chanIdx' is NULL (see quickDAQviewAt).
+* A view stays valid across one further read of the same task (input tasks are double-buffered).
+*/
+typedef struct _quickDAQreadView {
+	const float64		*data;
+	const unsigned int	*chanIdx;
+	unsigned int		len;
+} quickDAQreadView;
+
+/*!
+* Zero-copy writable view of a device's analog output channels inside the AO task buffer.
+* Fill it in place and flush it with writeAnalog(devNum).
+*/
+typedef struct _quickDAQanalogWriteView {
+	float64				*data;
+	const unsigned int	*chanIdx;
+	unsigned int		len;
+} quickDAQanalogWriteView;
+
+/*!
+* Zero-copy writable view of a device's digital output ports inside the DO task buffer.
+* Fill it in place and flush it with writeDigital(devNum).
+*/
+typedef struct _quickDAQdigitalWriteView {
+	uInt32				*data;
+	const unsigned int	*chanIdx;
+	unsigned int		len;
+} quickDAQdigitalWriteView;
+
+/*!
+* Pre-resolved handle to one scalar channel (AI/AO pin, DO port or counter), obtained once with
+* getChannelHandle() after pinMode(). It holds the address of the owning task's front buffer
+* pointer (input tasks are double-buffered) and the channel's position in that buffer, so the
+* hot-path accessors below skip the status check and all device/pin table lookups.
+*/
+typedef struct _quickDAQchan {
+	void			**frame;
+	unsigned int	idx;
+	IOmodes			ioMode;
+	struct _NItask	*task;
+} quickDAQchan;
+
+// Element access for read and write views
+#define quickDAQviewAt(view, k)	((view).data[((view).chanIdx == NULL) ? (k) : (view).chanIdx[(k)]])
+
 /*!
  * Defined details of each device enumerated.
 */
@@ -183,12 +484,19 @@ typedef struct _deviceInfo {
 	unsigned int		AIcnt;
 	pinInfo				*AIpins;
 	NItask				*AItask;
+	// Device slices of the shared AI/AO/DO tasks, built at quickDAQstart(): AIchanIdx[k] is the
+	// 'dataBuffer' position of the k-th active AI pin of this device (same for AO and DO).
+	unsigned int		AIchanCnt;
+	unsigned int		*AIchanIdx;
+	uInt64				AIframeSeq;
 	//unsigned			AItaskDataLen;
 	//bool				AItaskEnable;
 	
 	unsigned int		AOcnt;
 	pinInfo				*AOpins;
 	NItask				*AOtask;
+	unsigned int		AOchanCnt;
+	unsigned int		*AOchanIdx;
 	//unsigned			AOtaskDataLen;
 	//bool				AOtaskEnable;
 	
@@ -201,6 +509,8 @@ typedef struct _deviceInfo {
 	unsigned int		DOcnt;
 	pinInfo				*DOpins;
 	NItask				*DOtask;
+	unsigned int		DOchanCnt;
+	unsigned int		*DOchanIdx;
 	//unsigned			DOtaskDataLen;
 	//bool				DOtaskEnable;
 	
@@ -276,46 +586,86 @@ typedef struct _NIdefault_values {
 	int32	plsLoTick;
 	int32	plsHiTick;
 } NIdefaults;
+/*!
+* Defines the public part of a quickDAQ session: library status, devices and sampling settings,
+* and the shared tasks. It is the first member of the session (see quickDAQsetSession), whose
+* run-time state is private to the library.
+*/
+typedef struct _quickDAQSessionInfo {
+	// Library status
+	quickDAQErrorCodes	errorCode;
+	int32				NIerrorCode;
+	quickDAQStatusModes	status;
+	bool32				sampleLate;
+
+	// NI-DAQmx devices and sampling
+	char				devPrefix[DAQMX_MAX_DEV_STR_LEN];
+	unsigned int		devEnumerated;
+	deviceInfo			*devList;
+	unsigned int		devCount;
+	unsigned int		devMaxNum;
+	int32				triggerEdge;
+	samplingModes		sampleMode;
+	char				sampleModeString[20];
+	float64				samplingRate;
+	uInt64				pointsPerSample;
+	char				clockSource[DAQMX_MAX_STR_LEN];
+	IOmodes				clockSourceTask;
+	int					clockSourceDev, clockSourcePin;
+
+	// Shared NI-DAQmx subsystem tasks
+	NItask				*AIshared, *AOshared, *DIshared, *DOshared;
+} quickDAQSessionInfo;
+
+typedef struct _quickDAQSession quickDAQSession;
 
 //------------------------------
 // quickDAQ Glabal Declarations
 //------------------------------
-extern quickDAQErrorCodes		quickDAQErrorCode;
-extern int32					NIDAQmxErrorCode;
-extern quickDAQStatusModes		quickDAQStatus;
-extern bool32					lateSampleWarning;
-
-// NI-DAQmx specific declarations
-extern char						DAQmxDevPrefix[DAQMX_MAX_DEV_STR_LEN];
-extern unsigned int				DAQmxEnumerated;
-//extern long						DAQmxErrorCode;
 extern const NIdefaults			DAQmxDefaults;
-extern deviceInfo				*DAQmxDevList;
-extern unsigned int				DAQmxDevCount;
-extern unsigned int				DAQmxMaxCount;
-extern int32					DAQmxTriggerEdge;
-extern samplingModes			DAQmxSampleMode;
-extern char						DAQmxSampleModeString[20];
-extern float64					DAQmxSamplingRate;
-extern uInt64					DAQmxNumDataPointsPerSample;
-extern char						DAQmxClockSource[DAQMX_MAX_STR_LEN];
-extern IOmodes					DAQmxClockSourceTask;
-extern int						DAQmxClockSourceDev, DAQmxClockSourcePin;
+extern QD_THREAD_LOCAL quickDAQSession	*quickDAQactiveSession;
 
-// NI-DAQmx subsystem tasks
+// The names below resolve to the session bound to the calling thread
+#define quickDAQsessionInfo			((quickDAQSessionInfo*)quickDAQactiveSession)
+#define quickDAQErrorCode			(quickDAQsessionInfo->errorCode)
+#define NIDAQmxErrorCode			(quickDAQsessionInfo->NIerrorCode)
+#define quickDAQStatus				(quickDAQsessionInfo->status)
+#define lateSampleWarning			(quickDAQsessionInfo->sampleLate)
 
-extern cLinkedList	*NItaskList;
-//extern TaskHandle	*AItaskHandle, *AOtaskHandle, *DItaskHandle, *DOtaskHandle;
-//extern unsigned		 AIpinCount, AOpinCount, DIpinCount, DOpinCount;
-extern NItask		*AItask	   , *AOtask   , *DItask   , *DOtask;
-
-extern cLinkedList	*CItaskList, *COtaskList;
-//extern unsigned		 CIpinCount, COpinCount;
+// NI-DAQmx specific declarations
+#define DAQmxDevPrefix				(quickDAQsessionInfo->devPrefix)
+#define DAQmxEnumerated				(quickDAQsessionInfo->devEnumerated)
+#define DAQmxDevList				(quickDAQsessionInfo->devList)
+#define DAQmxDevCount				(quickDAQsessionInfo->devCount)
+#define DAQmxMaxCount				(quickDAQsessionInfo->devMaxNum)
+#define DAQmxTriggerEdge			(quickDAQsessionInfo->triggerEdge)
+#define DAQmxSampleMode				(quickDAQsessionInfo->sampleMode)
+#define DAQmxSampleModeString		(quickDAQsessionInfo->sampleModeString)
+#define DAQmxSamplingRate			(quickDAQsessionInfo->samplingRate)
+#define DAQmxNumDataPointsPerSample	(quickDAQsessionInfo->pointsPerSample)
+#define DAQmxClockSource			(quickDAQsessionInfo->clockSource)
+#define DAQmxClockSourceTask		(quickDAQsessionInfo->clockSourceTask)
+#define DAQmxClockSourceDev			(quickDAQsessionInfo->clockSourceDev)
+#define DAQmxClockSourcePin			(quickDAQsessionInfo->clockSourcePin)
 
+// NI-DAQmx subsystem tasks
+// API break: the shared tasks were the globals AItask, AOtask, DItask and DOtask. As macros those
+// names would also rewrite the deviceInfo members of the same name, so code using the old globals
+// must switch to NItaskAI, NItaskAO, NItaskDI and NItaskDO.
+#define NItaskAI					(quickDAQsessionInfo->AIshared)
+#define NItaskAO					(quickDAQsessionInfo->AOshared)
+#define NItaskDI					(quickDAQsessionInfo->DIshared)
+#define NItaskDO					(quickDAQsessionInfo->DOshared)
 
 //--------------------------------
 // quickDAQ Function Declarations
 //--------------------------------
+// session functions
+quickDAQSession* quickDAQnewSession();
+void quickDAQfreeSession(quickDAQSession* session);
+void quickDAQsetSession(quickDAQSession* session);
+quickDAQSession* quickDAQgetSession();
+
 // support functions
 void DAQmxErrChk(int32 errCode);
 char* dev2string(char* strBuf, unsigned int devNum);
@@ -324,6 +674,8 @@ int quickDAQSetError(quickDAQErrorCodes newError, bool printFlag);
 int quickDAQGetError();
 int quickDAQSetStatus(quickDAQStatusModes newStatus, bool printFlag);
 int quickDAQgetStatus();
+void swapTaskBuffers(NItask* task);
+size_t taskSampleSize(NItask* task);
 
 // library initialization functions
 char* setDAQmxDevPrefix(char* newPrefix);
@@ -331,6 +683,11 @@ void enumerateNIDevices();
 unsigned int enumerateNIDevChannels(unsigned int myDev, IOmodes IOtype, unsigned int printFlag);
 unsigned int enumerateNIDevTerminals(unsigned int deviceNumber);
 void initDevTaskFlags();
+void initTaskTable();
+void freeTaskTable();
+NItask* newNItask(IOmodes ioMode);
+NItask* firstNItask();
+NItask* nextNItask(NItask* task);
 void quickDAQinit();
 
 // configuration functions
@@ -338,18 +695,24 @@ void setActiveEdgeRising();
 void setActiveEdgeFalling();
 void setSampleClockTiming(samplingModes sampleMode, float64 samplingRate, char* triggerSource, triggerModes triggerEdge, uInt64 numDataPointsPerSample, bool printFlag);
 bool setClockSource(unsigned devNum, int pinNum, IOmodes ioMode);
+void selectClockMaster();
 void pinMode(unsigned int devNum, IOmodes ioMode, unsigned int pinNum);
 
 // library run functions
+unsigned int* buildPinIndex(pinInfo* pins, unsigned int pinCnt, unsigned int* activeCnt);
+void buildDevChannelIndex();
+void freeDevChannelIndex();
 void quickDAQstart();
+void prefaultRunBuffers();
+int quickDAQstartRT(int cpu, int priority);
 void quickDAQstop();
 
 // read/write functions
 typedef struct { unsigned _; } NoArg; // use compound literal to form a dummy value for _Generic, only its type matters
 #define NO_ARG ((const NoArg){0})
 	// Function calls that write to/read either from external buffers or internal buffers
-void readAnalog_extBuf(unsigned devNum, float64 *outputData);
-void readAnalog_intBuf(unsigned devNum);
+int readAnalog_extBuf(unsigned devNum, float64 *outputData);
+int readAnalog_intBuf(unsigned devNum);
 #define readAnalog_(args, a, b, ...)	\
   _Generic((b),							\
            NoArg:	readAnalog_intBuf,	\
@@ -361,8 +724,8 @@ void readAnalog_intBuf(unsigned devNum);
 #define readAnalog(...) readAnalog_((__VA_ARGS__), __VA_ARGS__, NO_ARG, ~)
 float64 getAnalogInPin(unsigned devNum, unsigned pinNum);
 
-void writeAnalog_extBuf(unsigned devNum, float64 *inputData);
-void writeAnalog_intBuf(unsigned devNum);
+int writeAnalog_extBuf(unsigned devNum, float64 *inputData);
+int writeAnalog_intBuf(unsigned devNum);
 #define writeAnalog_(args, a, b, ...)	\
   _Generic((b),							\
            NoArg:	writeAnalog_intBuf,	\
@@ -371,8 +734,8 @@ void writeAnalog_intBuf(unsigned devNum);
 #define writeAnalog(...) writeAnalog_((__VA_ARGS__), __VA_ARGS__, NO_ARG, ~)
 void setAnalogOutPin(unsigned devNum, unsigned pinNum, float64 pinValue);
 
-void writeDigital_extBuf(unsigned devNum, uInt32 *inputData);
-void writeDigital_intBuf(unsigned devNum);
+int writeDigital_extBuf(unsigned devNum, uInt32 *inputData);
+int writeDigital_intBuf(unsigned devNum);
 #define writeDigitalPort_(args, a, b, ...)	\
   _Generic((b),							\
            NoArg:	writeDigital_intBuf,	\
@@ -381,11 +744,11 @@ void writeDigital_intBuf(unsigned devNum);
 #define writeDigital(...) writeDigitalPort_((__VA_ARGS__), __VA_ARGS__, NO_ARG, ~)
 void setDigitalOutPort(unsigned devNum, unsigned portNum, uInt32 portValue);
 
-void writeDigitalPin(unsigned devNum, unsigned portNum, unsigned pinNum, bool bitState);
+int writeDigitalPin(unsigned devNum, unsigned portNum, unsigned pinNum, bool bitState);
 void setDigitalOutPin(unsigned devNum, unsigned portNum, unsigned pinNum, bool bitState);
 
-void readCounterAngle_extBuf(unsigned devNum, unsigned ctrNum, float64 *outputData);
-void readCounterAngle_intBuf(unsigned devNum, unsigned ctrNum);
+int readCounterAngle_extBuf(unsigned devNum, unsigned ctrNum, float64 *outputData);
+int readCounterAngle_intBuf(unsigned devNum, unsigned ctrNum);
 #define readCounterAngle_(args, a, b, c, ...)	\
   _Generic((c),							\
            NoArg:	writeDigitalPin_intBuf,	\
@@ -394,7 +757,181 @@ void readCounterAngle_intBuf(unsigned devNum, unsigned ctrNum);
 #define readCounterAngle(...) readCounterAngle_((__VA_ARGS__), __VA_ARGS__, NO_ARG, ~)
 float64 getCounterAngle(unsigned devNum, unsigned ctrNum);
 
-void syncSampling();
+	// Grouped read of all counter tasks
+void setCounterWorkers(unsigned workerCount, const int* cpuList);
+void buildCounterTable();
+void freeCounterTable();
+int getCounterIndex(unsigned devNum, unsigned ctrNum);
+const float64* readAllCounters();
+
+	// Pre-resolved channel handles
+quickDAQchan getChannelHandle(unsigned devNum, IOmodes ioMode, unsigned pinNum);
+bool quickDAQchanValid(quickDAQchan chan, IOmodes ioMode);
+
+#if defined(_DEBUG) || defined(QUICKDAQ_CHECKED_CHANS)
+	// Debug builds validate every handle access
+	#define QUICKDAQ_CHAN_CHECK(chan, ioMode)	assert(quickDAQchanValid((chan), (ioMode)))
+#else
+	#define QUICKDAQ_CHAN_CHECK(chan, ioMode)	((void)0)
+#endif
+
+QD_INLINE float64 getAnalogInChan(quickDAQchan chan)
+{
+	QUICKDAQ_CHAN_CHECK(chan, ANALOG_IN);
+	return ((const float64*)*chan.frame)[chan.idx];
+}
+
+QD_INLINE void setAnalogOutChan(quickDAQchan chan, float64 pinValue)
+{
+	QUICKDAQ_CHAN_CHECK(chan, ANALOG_OUT);
+	((float64*)*chan.frame)[chan.idx] = pinValue;
+}
+
+QD_INLINE void setDigitalOutChan(quickDAQchan chan, uInt32 portValue)
+{
+	QUICKDAQ_CHAN_CHECK(chan, DIGITAL_OUT);
+	((uInt32*)*chan.frame)[chan.idx] = portValue;
+}
+
+QD_INLINE void setDigitalOutChanPin(quickDAQchan chan, unsigned pinNum, bool bitState)
+{
+	uInt32* port = NULL;
+	QUICKDAQ_CHAN_CHECK(chan, DIGITAL_OUT);
+	port = &(((uInt32*)*chan.frame)[chan.idx]);
+	*port = (*port & ~((uInt32)1 << pinNum)) | ((uInt32)bitState << pinNum);
+}
+
+QD_INLINE float64 getCounterAngleChan(quickDAQchan chan)
+{
+	QUICKDAQ_CHAN_CHECK(chan, CTR_ANGLE_IN);
+	return ((const float64*)*chan.frame)[chan.idx];
+}
+
+	// Zero-copy views into the internal task buffers
+quickDAQreadView readAnalogView(unsigned devNum);
+quickDAQreadView readCounterAngleView(unsigned devNum, unsigned ctrNum);
+quickDAQanalogWriteView writeAnalogView(unsigned devNum);
+quickDAQdigitalWriteView writeDigitalView(unsigned devNum);
+
+int syncSampling();
+
+// background acquisition functions
+void setBackgroundAcquisition(bool enable, unsigned blockScans, unsigned ringBlocks);
+quickDAQring* quickDAQringCreate(NItask* task, unsigned blockScans, unsigned ringBlocks);
+void quickDAQringDestroy(quickDAQring* ring);
+int32 quickDAQringFill(quickDAQring* ring);
+int quickDAQringStartReader(quickDAQring* ring);
+void quickDAQringStopReader(quickDAQring* ring);
+void startBackgroundReaders();
+void stopBackgroundReaders();
+unsigned quickDAQringAvailable(quickDAQring* ring);
+const float64* quickDAQringPeekBlock(quickDAQring* ring);
+void quickDAQringReleaseBlock(quickDAQring* ring);
+bool quickDAQringPopBlock(quickDAQring* ring, float64* outputData);
+bool quickDAQringLatestFrame(quickDAQring* ring, float64* outputData);
+const int16* quickDAQringPeekRawBlock(quickDAQring* ring);
+bool quickDAQringPopRawBlock(quickDAQring* ring, int16* outputData);
+bool quickDAQringLatestRawFrame(quickDAQring* ring, int16* outputData);
+int32 quickDAQringReaderError(quickDAQring* ring);
+void quickDAQringSetReaderError(quickDAQring* ring, int32 error);
+quickDAQring* getAnalogInRing();
+quickDAQring* getCounterAngleRing(unsigned devNum, unsigned ctrNum);
+
+// frame snapshot functions
+void setFramePublishing(bool enable);
+quickDAQframePub* quickDAQframeCreate(unsigned chanCount);
+void quickDAQframeDestroy(quickDAQframePub* pub);
+void publishFrame(NItask* task);
+bool quickDAQsnapshot(const quickDAQframePub* pub, const unsigned* chanIdx, unsigned len, float64* outputData, quickDAQframeInfo* info);
+bool readAnalogSnapshot(unsigned devNum, float64* outputData, quickDAQframeInfo* info);
+bool readCounterSnapshot(unsigned devNum, unsigned ctrNum, float64* angle, quickDAQframeInfo* info);
+
+// scheduled output command functions
+void setCommandQueue(unsigned capacity);
+void freeCommandQueue();
+void resetCommandQueue();
+bool scheduleAnalogOut(quickDAQchan chan, uInt64 tick, float64 pinValue);
+bool scheduleDigitalOut(quickDAQchan chan, uInt64 tick, uInt32 portValue);
+uInt64 getCommandTick();
+unsigned applyCommands();
+
+// loop watchdog functions
+void setWatchdog(unsigned missedTicks, quickDAQwatchdogHandler handler, void* userData);
+void startWatchdog();
+void stopWatchdog();
+uInt64 getWatchdogTrips();
+void quickDAQbeat();
+
+// event-driven acquisition functions
+int registerAnalogInHandler(unsigned devNum, unsigned nSamples, quickDAQblockHandler handler, void* userData);
+int registerCounterHandler(unsigned devNum, unsigned ctrNum, unsigned nSamples, quickDAQblockHandler handler, void* userData);
+int registerDoneHandler(quickDAQdoneHandler handler, void* userData);
+void clearEventHandlers();
+void startEventSources();
+void stopEventSources();
+
+// cycle engine functions
+void setCycleWorkers(unsigned workerCount, const int* cpuList);
+void buildCyclePlan();
+void freeCyclePlan();
+int quickDAQcycle();
+
+// cycle timing functions
+void setCycleTiming(bool enable);
+void resetCycleTiming();
+void recordWaitTiming(uInt64 waitBegin, uInt64 waitEnd, bool32 late);
+void recordCycleTiming(uInt64 cycleBegin, uInt64 waitBegin, uInt64 waitEnd, uInt64 cycleEnd, bool32 late);
+const quickDAQtiming* getCycleTiming();
+void dumpCycleTiming(FILE* stream);
+
+// deadline-miss policy functions
+void setMissPolicy(missPolicies missPolicy, unsigned missLimit);
+void* missOutputFrame(NItask* task, bool32 lateCycle);
+bool32 recordMiss(bool32 late);
+bool32 missExtrapolates();
+void extrapolateInputs(NItask* task);
+unsigned getMissedTicks();
+void setSafeAnalogOut(unsigned devNum, unsigned pinNum, float64 pinValue);
+void setSafeDigitalOut(unsigned devNum, unsigned portNum, uInt32 portValue);
+int enterSafeState();
+void clearSafeState();
+
+// sample clock wait functions
+void setWaitStrategy(waitModes waitMode, unsigned spinMarginUs);
+void initSampleClockWait();
+int32 waitForSampleClock(TaskHandle masterTask);
+int32 waitForSoftClock();
+
+// non-fatal error handling functions
+void setNonFatalErrors(bool enable, unsigned ringSize);
+int taskErrChk(int32 errCode, NItask* task);
+void quickDAQpushError(int32 errCode, NItask* task);
+bool quickDAQpopError(quickDAQerror* err);
+unsigned quickDAQpendingErrors();
+int recoverTask(NItask* task);
+int quickDAQrecover();
+void freeErrorRing();
+
+// raw analog input functions
+void setRawAnalogIn(bool enable);
+bool32 captureAnalogScaling(NItask* task);
+int32 readAnalogRaw(NItask* task);
+
+// data logging functions
+void setDataLogging(const char* filePath, unsigned chunkRows, unsigned chunkCount);
+void startDataLog();
+void stopDataLog();
+void setDataLogFormat(logFormats format);
+void logFrame();
+uInt64 getLogDroppedRows();
+
+// replay functions
+void setReplay(const char* filePath, replayModes mode);
+void startReplay();
+void stopReplay();
+int32 replayTick();
+void replayReadTask(NItask* task);
+uInt64 getReplayRows();
 
 // shutdown routines
 int quickDAQTerminate();
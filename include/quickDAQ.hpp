@@ -0,0 +1,339 @@
+#pragma once
+#ifndef QUICKDAQ_HPP
+#define QUICKDAQ_HPP
+
+/* C++20 coroutine layer for quickDAQ. Each control task is a coroutine that awaits
+* nextTick(), nextBlock(n) or writeComplete(); a single-threaded executor runs one
+* quickDAQcycle() per sample clock tick and then resumes the due coroutines in spawn
+* order, so several controllers at different rates share one core without threads.
+*
+* Usage:
+*	quickDAQ::controlTask fastLoop() {
+*		for (;;) { co_await quickDAQ::nextTick(); ... }
+*	}
+*	quickDAQ::controlTask slowLoop() {
+*		for (;;) { quickDAQblockView block = co_await quickDAQ::nextBlock(100); ... }
+*	}
+*	quickDAQ::executor exec;
+*	exec.spawn(fastLoop());
+*	exec.spawn(slowLoop());
+*	quickDAQstart();
+*	exec.run(10000);
+*/
+
+#include <quickDAQ.h>
+
+#if (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L) || __cplusplus >= 202002L
+#include <coroutine>
+#include <exception>
+#include <vector>
+#include <cstring>
+
+//quickDAQ coroutine executor constants
+#define QUICKDAQ_MAX_COROUTINES		32
+
+namespace quickDAQ {
+
+class executor;
+
+/*!
+* Coroutine wait conditions.
+*/
+enum coWaitKinds {
+	/*! Runnable: resumed on the next step.*/
+	CO_RUNNABLE		= 0,
+	/*! Waiting for the sample clock tick 'wakeTick'.*/
+	CO_WAIT_TICK		= 1,
+	/*! Waiting for the next cycle's output flush to complete.*/
+	CO_WAIT_WRITE		= 2
+};
+
+/*!
+* Return type of a control task coroutine. Created suspended; executor::spawn() takes it over.
+*/
+class controlTask {
+public:
+	struct promise_type {
+		executor			*exec = nullptr;
+		coWaitKinds			waitKind = CO_RUNNABLE;
+		uInt64				wakeTick = 0;
+		int					cycleStatus = ERROR_NONE;
+		std::exception_ptr	error;
+
+		controlTask get_return_object() { return controlTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { error = std::current_exception(); }
+	};
+	typedef std::coroutine_handle<promise_type> handle;
+
+	controlTask() = default;
+	explicit controlTask(handle coHandle) : coHandle(coHandle) {}
+	controlTask(controlTask&& other) noexcept : coHandle(other.coHandle) { other.coHandle = nullptr; }
+	controlTask(const controlTask&) = delete;
+	controlTask& operator=(const controlTask&) = delete;
+	~controlTask() { if (coHandle) coHandle.destroy(); }
+
+	handle release() { handle h = coHandle; coHandle = nullptr; return h; }
+
+private:
+	handle coHandle = nullptr;
+};
+
+/*!
+* Single-threaded, deterministic executor driven by the hardware sample clock.
+* step() runs one quickDAQcycle() (output flush, sample clock wait, input reads), then resumes
+* the coroutines that awaited writeComplete() and then those whose tick is due, each group in
+* spawn order. Coroutine frames are allocated once in spawn(), the block history (see nextBlock)
+* by the first step after a larger block is awaited; other steps never allocate.
+*/
+class executor {
+public:
+	executor() = default;
+	executor(const executor&) = delete;
+	executor& operator=(const executor&) = delete;
+	~executor()
+	{
+		for (unsigned k = 0; k < taskCnt; k++) {
+			if (tasks[k]) tasks[k].destroy();
+		}
+	}
+
+	/*!
+	* Takes over 'task' and runs it up to its first co_await, so it can set the outputs of the
+	* first cycle. Returns false if QUICKDAQ_MAX_COROUTINES tasks are already spawned.
+	*/
+	bool spawn(controlTask&& task)
+	{
+		if (taskCnt >= QUICKDAQ_MAX_COROUTINES)
+			return false;
+		controlTask::handle h = task.release();
+		h.promise().exec = this;
+		h.promise().waitKind = CO_RUNNABLE;
+		tasks[taskCnt++] = h;
+		resumeTask(taskCnt - 1);
+		return true;
+	}
+
+	/*!
+	* Runs one cycle and resumes the due coroutines. Rethrows the first exception escaping a coroutine.
+	* \return Returns the quickDAQcycle() status.
+	*/
+	int step()
+	{
+		unsigned k;
+
+		status = quickDAQcycle();
+		tickCount++;
+		recordHistory();
+		for (k = 0; k < taskCnt; k++) {
+			if (tasks[k] && tasks[k].promise().waitKind == CO_WAIT_WRITE)
+				resumeTask(k);
+		}
+		for (k = 0; k < taskCnt; k++) {
+			if (tasks[k] && tasks[k].promise().waitKind != CO_WAIT_WRITE && tasks[k].promise().wakeTick <= tickCount)
+				resumeTask(k);
+		}
+		if (pendingError) {
+			std::exception_ptr error = pendingError;
+			pendingError = nullptr;
+			std::rethrow_exception(error);
+		}
+		return status;
+	}
+
+	/*!
+	* Runs 'ticks' steps, or fewer once every coroutine has returned.
+	* \return Returns the status of the last cycle.
+	*/
+	int run(uInt64 ticks)
+	{
+		while (ticks-- > 0 && liveCount() > 0) {
+			step();
+		}
+		return status;
+	}
+
+	uInt64 tick() const { return tickCount; }
+	int lastStatus() const { return status; }
+
+	/*!
+	* Keeps the analog input frames of at least the last 'scans' ticks for block awaiters.
+	*/
+	void reserveBlock(uInt64 scans)
+	{
+		if (scans > historyWanted)
+			historyWanted = scans;
+	}
+
+	/*!
+	* View of the analog input frames of the 'scans' ticks ending at 'lastTick', oldest first, or
+	* of fewer scans if the history started later. Valid until the next step.
+	*/
+	quickDAQblockView block(uInt64 lastTick, uInt64 scans) const
+	{
+		quickDAQblockView view = { nullptr, nullptr, 0, 0, 0, 0 };
+		uInt64 kept = 0;
+
+		if (historyScans == 0 || lastTick < historyFirst || lastTick > tickCount)
+			return view;
+		kept = lastTick - historyFirst + 1;
+		if (kept > scans) kept = scans;
+		if (kept > historyScans) kept = historyScans;
+		// Frames are stored twice, one history length apart, so any block is contiguous
+		view.data = history.data() + (size_t)((lastTick % historyScans) + historyScans - kept + 1) * historyChans;
+		view.len = historyChans;
+		view.stride = historyChans;
+		view.scans = (unsigned)kept;
+		view.blockSeq = (scans > 0) ? lastTick / scans - 1 : 0;
+		return view;
+	}
+
+	unsigned liveCount() const
+	{
+		unsigned k, live = 0;
+		for (k = 0; k < taskCnt; k++) {
+			if (tasks[k]) live++;
+		}
+		return live;
+	}
+
+private:
+	void resumeTask(unsigned k)
+	{
+		controlTask::handle h = tasks[k];
+		h.promise().waitKind = CO_RUNNABLE;
+		h.promise().cycleStatus = status;
+		h.resume();
+		if (h.done()) {
+			if (h.promise().error && !pendingError)
+				pendingError = h.promise().error;
+			h.destroy();
+			tasks[k] = nullptr;
+		}
+	}
+
+	// Copies this tick's analog input frame into the block history
+	void recordHistory()
+	{
+		size_t slot = 0;
+
+		if (historyWanted > historyScans && NItaskAI != NULL && NItaskAI->dataBuffer != NULL) {
+			historyScans = (unsigned)historyWanted;
+			historyChans = NItaskAI->pinCount;
+			history.assign((size_t)2 * historyScans * historyChans, 0.0);
+			historyFirst = tickCount;
+		}
+		if (historyScans == 0)
+			return;
+		slot = (size_t)(tickCount % historyScans) * historyChans;
+		std::memcpy(history.data() + slot, NItaskAI->dataBuffer, historyChans * sizeof(float64));
+		std::memcpy(history.data() + slot + (size_t)historyScans * historyChans, NItaskAI->dataBuffer, historyChans * sizeof(float64));
+	}
+
+	controlTask::handle	tasks[QUICKDAQ_MAX_COROUTINES] = {};
+	unsigned			taskCnt = 0;
+	uInt64				tickCount = 0;
+	int					status = ERROR_NONE;
+	std::exception_ptr	pendingError;
+
+	// Block history: 'historyScans' analog input frames of 'historyChans' channels, see block()
+	std::vector<float64>	history;
+	uInt64				historyWanted = 0;
+	uInt64				historyFirst = 0;
+	unsigned			historyScans = 0;
+	unsigned			historyChans = 0;
+};
+
+/*!
+* Awaitable that parks the coroutine until sample clock tick 'wakeTick'.
+* co_await returns the tick it resumed on.
+*/
+struct tickAwaiter {
+	uInt64 ticks;
+	controlTask::promise_type* promise = nullptr;
+
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(controlTask::handle h) noexcept
+	{
+		uInt64 now = h.promise().exec->tick();
+		promise = &h.promise();
+		promise->waitKind = CO_WAIT_TICK;
+		promise->wakeTick = now + ticks;
+	}
+	uInt64 await_resume() const noexcept { return promise->wakeTick; }
+};
+
+/*!
+* Awaitable that parks the coroutine until the end of the next block of 'scans' ticks.
+* co_await returns the analog input frames of the block.
+*/
+struct blockAwaiter {
+	uInt64 scans;
+	controlTask::promise_type* promise = nullptr;
+
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(controlTask::handle h) noexcept
+	{
+		uInt64 now = h.promise().exec->tick();
+		promise = &h.promise();
+		promise->waitKind = CO_WAIT_TICK;
+		promise->wakeTick = (now / scans + 1) * scans;
+		promise->exec->reserveBlock(scans);
+	}
+	quickDAQblockView await_resume() const noexcept { return promise->exec->block(promise->wakeTick, scans); }
+};
+
+/*!
+* Awaitable that parks the coroutine until the next cycle has flushed the outputs.
+* co_await returns that cycle's quickDAQcycle() status.
+*/
+struct writeAwaiter {
+	controlTask::promise_type* promise = nullptr;
+
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(controlTask::handle h) noexcept
+	{
+		promise = &h.promise();
+		promise->waitKind = CO_WAIT_WRITE;
+	}
+	int await_resume() const noexcept { return promise->cycleStatus; }
+};
+
+/*!
+* \fn tickAwaiter nextTick(uInt64 ticks = 1)
+* Resumes 'ticks' sample clock ticks after the current one (a controller at rate/ticks).
+*/
+inline tickAwaiter nextTick(uInt64 ticks = 1)
+{
+	return tickAwaiter{ (ticks > 0) ? ticks : 1 };
+}
+
+/*!
+* \fn blockAwaiter nextBlock(uInt64 samples)
+* Resumes on the next tick that completes a block of 'samples' ticks, counted from the first
+* executor step, and returns the analog input frames of those ticks (all AI channels, scan by
+* scan; read them with quickDAQblockAt). The view is valid until the coroutine awaits again.
+* Controllers at the same block size run in phase, whenever they were spawned. The first block
+* can be short if it began before the executor kept a history that long (see block()).
+*/
+inline blockAwaiter nextBlock(uInt64 samples)
+{
+	return blockAwaiter{ (samples > 0) ? samples : 1 };
+}
+
+/*!
+* \fn writeAwaiter writeComplete()
+* Resumes once the outputs set so far have been written by the next cycle, before any tick waiter.
+*/
+inline writeAwaiter writeComplete()
+{
+	return writeAwaiter{};
+}
+
+} // namespace quickDAQ
+
+#endif /* C++20 */
+
+#endif /* quickDAQ.hpp */
@@ -0,0 +1,22 @@
+#pragma once
+#ifndef QUICKDAQ_COMPILER_H
+#define QUICKDAQ_COMPILER_H
+
+/* Compiler keywords shared by the quickDAQ API and its platform layer: cache line alignment,
+* thread-local storage and inline functions. No system headers.
+*/
+
+// Cache line size assumed for padding and alignment of shared data
+#define QD_CACHELINE	64
+
+#if defined(_MSC_VER)
+	#define QD_CACHE_ALIGNED	__declspec(align(QD_CACHELINE))
+	#define QD_THREAD_LOCAL		__declspec(thread)
+	#define QD_INLINE			static __inline
+#else
+	#define QD_CACHE_ALIGNED	__attribute__((aligned(QD_CACHELINE)))
+	#define QD_THREAD_LOCAL		__thread
+	#define QD_INLINE			static inline
+#endif
+
+#endif /* quickDAQ_compiler.h */
@@ -0,0 +1,37 @@
+#pragma once
+#ifndef QUICKDAQ_HIST_H
+#define QUICKDAQ_HIST_H
+
+/* Allocation-free log-linear histogram of the cycle timing recorder. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+//quickDAQ timing histogram constants: 2^SUB_BITS linear sub-buckets per power of two (~3% resolution),
+//values (in ns) are clamped below 2^MAX_BITS (~137 s)
+#define QUICKDAQ_HIST_SUB_BITS		5
+#define QUICKDAQ_HIST_MAX_BITS		37
+#define QUICKDAQ_HIST_BUCKETS		((QUICKDAQ_HIST_MAX_BITS - QUICKDAQ_HIST_SUB_BITS + 1) << QUICKDAQ_HIST_SUB_BITS)
+
+/*!
+* Log-linear (HDR-style) histogram with a fixed bucket array, so recording never allocates.
+*/
+typedef struct _quickDAQhist {
+	uint64_t	count;
+	uint64_t	sum;
+	uint64_t	min;
+	uint64_t	max;
+	uint64_t	bucket[QUICKDAQ_HIST_BUCKETS];
+} quickDAQhist;
+
+void quickDAQhistRecord(quickDAQhist* hist, uint64_t value);
+uint64_t quickDAQhistPercentile(const quickDAQhist* hist, double percentile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* quickDAQ_hist.h */
@@ -0,0 +1,104 @@
+#pragma once
+#ifndef QUICKDAQ_LOGFILE_H
+#define QUICKDAQ_LOGFILE_H
+
+/* On-disk format of the quickDAQ data log. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <quickDAQ_scale.h>
+
+//quickDAQ data log constants: file blocks are multiples of QUICKDAQ_LOG_ALIGN bytes, chunk
+//headers take QUICKDAQ_LOG_CHUNK_HEAD bytes
+#define QUICKDAQ_LOG_MAGIC			"QDLOG001"
+#define QUICKDAQ_LOG_INDEX_MAGIC	"QDLOGIDX"
+#define QUICKDAQ_LOG_VERSION		3
+#define QUICKDAQ_LOG_ALIGN			4096
+#define QUICKDAQ_LOG_CHUNK_HEAD		64
+#define QUICKDAQ_LOG_NAME_LEN		32
+#define QUICKDAQ_LOG_POLL_MS		10
+
+/*!
+* File formats of the data log (see setDataLogFormat).
+*/
+typedef enum _logFormats {
+	/*! quickDAQ columnar chunks, described by quickDAQlogHeader (default).*/
+	LOG_COLUMNAR = 0,
+	/*! NI TDMS 2.0: one group per device, one segment per chunk.*/
+	LOG_TDMS
+} logFormats;
+
+/*!
+* On-disk header of a data log (see setDataLogging). The file holds this header followed by
+* 'columnCount' quickDAQlogColumn descriptors, padded to 'headerBytes', then a sequence of
+* 'chunkBytes' chunks: a quickDAQlogChunk header padded to QUICKDAQ_LOG_CHUNK_HEAD bytes, then one
+* array of 'chunkRows' values per column. Only the first 'rowCount' rows of a chunk are valid.
+* Column 0 holds the cycle number (uInt64); raw analog columns hold int16 counts (see
+* setRawAnalogIn) and all other columns float64. A complete file ends with a block index: one
+* quickDAQlogIndexEntry per chunk plus an end entry, then a quickDAQlogFooter. Little-endian.
+*/
+typedef struct _quickDAQlogHeader {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	headerBytes;
+	uint32_t	columnCount;
+	uint32_t	chunkRows;
+	uint32_t	chunkBytes;
+	int32_t		sampleMode;
+	double		samplingRate;
+	uint64_t	startTime;			// seconds since the Unix epoch at quickDAQstart()
+	uint64_t	startMonotonic;		// qdMonotonicNs() at quickDAQstart()
+} quickDAQlogHeader;
+
+/*!
+* On-disk descriptor of one data log column: the pinMode() configuration it was recorded from.
+*/
+typedef struct _quickDAQlogColumn {
+	uint32_t	devNum;
+	uint32_t	pinNum;
+	int32_t		ioMode;				// INVALID_IO for the cycle number column
+	uint32_t	valueSize;			// bytes per value: 2 for raw analog counts (int16), else 8
+	char		name[QUICKDAQ_LOG_NAME_LEN];
+	// Raw analog counts only: value = scale[0] + scale[1]*x + scale[2]*x^2 + scale[3]*x^3
+	double		scale[QUICKDAQ_SCALE_COEFFS];
+} quickDAQlogColumn;
+
+/*!
+* On-disk header of one data log chunk.
+*/
+typedef struct _quickDAQlogChunk {
+	uint64_t	chunkNum;
+	uint32_t	rowCount;
+	uint32_t	reserved;
+	uint64_t	droppedRows;		// rows lost since quickDAQstart() because the writer fell behind
+	uint64_t	firstTime;			// ns from 'startMonotonic' to the first row (version 3)
+} quickDAQlogChunk;
+
+/*!
+* On-disk block index entry of a data log: where a chunk starts in the file and in time. The end
+* entry after the last chunk holds the row count, the cycle after the last row and its time.
+*/
+typedef struct _quickDAQlogIndexEntry {
+	uint64_t	firstRow;			// rows in the file before this chunk
+	uint64_t	firstCycle;
+	uint64_t	time;				// ns from 'startMonotonic'
+	uint64_t	offset;				// file offset of the chunk
+} quickDAQlogIndexEntry;
+
+/*!
+* On-disk footer of a complete data log, the last bytes of the file.
+*/
+typedef struct _quickDAQlogFooter {
+	uint64_t	entryCount;			// chunks + 1
+	uint64_t	indexOffset;		// file offset of the first quickDAQlogIndexEntry
+	char		magic[8];			// QUICKDAQ_LOG_INDEX_MAGIC
+} quickDAQlogFooter;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* quickDAQ_logfile.h */
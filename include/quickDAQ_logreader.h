@@ -0,0 +1,47 @@
+#pragma once
+#ifndef QUICKDAQ_LOGREADER_H
+#define QUICKDAQ_LOGREADER_H
+
+/* Offline reader of quickDAQ data logs: memory-mapped file, block index, seeking by time and
+* parallel extraction.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <quickDAQ_platform.h>
+#include <quickDAQ_logfile.h>
+#include <quickDAQ_workers.h>
+
+/*!
+* Defines a data log opened for offline reading (see quickDAQlogOpen): the memory-mapped file
+* and its block index. Read-only once opened, so any number of threads may extract from it.
+*/
+typedef struct _quickDAQlogFile {
+	qdFileMap				map;
+	const quickDAQlogHeader	*header;
+	quickDAQlogColumn		*columnInfo;
+	size_t					*columnOffset;	// bytes from the start of the chunk data
+	const quickDAQlogIndexEntry	*index;		// 'chunkCount' + 1 entries
+	quickDAQlogIndexEntry	*indexCopy;		// index rebuilt from the chunk headers, if any
+	uint64_t				chunkCount;
+	uint64_t				rowCount;
+} quickDAQlogFile;
+
+// data log reader functions
+quickDAQlogFile* quickDAQlogOpen(const char* filePath);
+void quickDAQlogClose(quickDAQlogFile* logFile);
+int quickDAQlogFindColumn(const quickDAQlogFile* logFile, unsigned devNum, int ioMode, unsigned pinNum);
+uint64_t quickDAQlogRowAt(const quickDAQlogFile* logFile, double seconds);
+double quickDAQlogTimeOf(const quickDAQlogFile* logFile, uint64_t row);
+uint64_t quickDAQlogExtract(const quickDAQlogFile* logFile, uint64_t firstRow, uint64_t rowCount, const unsigned* columns,
+	unsigned columnCount, double* outputData, unsigned workerCount);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // QUICKDAQ_LOGREADER_H
@@ -0,0 +1,117 @@
+#pragma once
+#ifndef QUICKDAQ_LOGWRITER_H
+#define QUICKDAQ_LOGWRITER_H
+
+/* Streaming data log writer behind setDataLogging(): chunk ring, writer thread, columnar and TDMS
+* encoding.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <quickDAQ_platform.h>
+#include <quickDAQ_logfile.h>
+#include <quickDAQ_tdms.h>
+
+/*!
+* Type of a value in a row of the data log, as the control thread copies it from its frame.
+*/
+typedef enum _logSourceTypes {
+	/*! float64, logged as is.*/
+	LOG_SOURCE_F64 = 0,
+	/*! uint64 (the cycle number), logged as is.*/
+	LOG_SOURCE_U64,
+	/*! int16 raw analog count, logged as is with the column scaling.*/
+	LOG_SOURCE_I16,
+	/*! uint32 digital port, logged as float64.*/
+	LOG_SOURCE_U32
+} logSourceTypes;
+
+/*!
+* Defines where the value of one log column sits in a row.
+*/
+typedef struct _quickDAQlogSource {
+	uint32_t		rowOffset;		// bytes from the start of the row
+	logSourceTypes	type;
+} quickDAQlogSource;
+
+/*!
+* Defines a frame copied whole into every row (one task buffer).
+*/
+typedef struct _quickDAQlogFrame {
+	void		**frame;		// the frame pointer, followed as task buffers are swapped
+	uint32_t	rowOffset;
+	uint32_t	bytes;
+} quickDAQlogFrame;
+
+/*!
+* Defines the data logger: a pool of chunks that the control thread fills one row per cycle and
+* hands to a writer thread in order (single-producer/single-consumer ring, as for quickDAQring).
+* A row is the caller's frames back to back, copied as they are; the writer transposes each chunk
+* into one column after the other, so every file write is a whole, aligned chunk.
+*/
+typedef struct _quickDAQlog {
+	// Control thread cache line: number of chunks handed to the writer
+	volatile uint64_t	head;
+	char				headPad[QD_CACHELINE - sizeof(uint64_t)];
+	// Writer cache line: number of chunks written and free again
+	volatile uint64_t	tail;
+	char				tailPad[QD_CACHELINE - sizeof(uint64_t)];
+
+	// Chunk pool and columns, read-only after creation
+	char				*chunks;		// chunk header, then 'chunkRows' rows of 'rowBytes'
+	unsigned			chunkCount;		// power of two
+	unsigned			chunkRows;
+	unsigned			rowBytes;		// rounded up to a multiple of 8 at start
+	unsigned			slotBytes;		// bytes per chunk of the pool
+	unsigned			chunkBytes;		// bytes per chunk in the file
+	unsigned			columnCount;
+	quickDAQlogColumn	*columnInfo;
+	quickDAQlogSource	*sources;		// where each column is found in a row
+	size_t				*columnOffset;	// bytes from the start of the chunk data in the file
+	quickDAQlogFrame	*frames;		// up to 'columnCount' frames a row is made of, for the caller
+	unsigned			frameCount;
+	logFormats			format;
+	int32_t				sampleMode;
+	double				samplingRate;
+	uint64_t			startTime;
+	uint64_t			startMonotonic;
+
+	// Control thread state
+	unsigned			rowCount;		// rows in the chunk being filled
+	uint64_t			droppedRows;
+
+	// Writer thread state
+	FILE				*file;
+	qdThread			thread;
+	qdEvent				wake;
+	volatile uint64_t	isRunning;
+	volatile int32_t	writeError;
+	char				*fileChunk;		// the chunk being stored, transposed into columns
+	// Block index, built by the writer as chunks are stored (columnar format only)
+	quickDAQlogIndexEntry	*index;
+	uint64_t			indexCount;
+	uint64_t			indexCap;
+	uint64_t			fileOffset;		// where the next chunk goes
+	uint64_t			lastCycle;		// of the last chunk indexed
+	unsigned			lastRows;
+	// TDMS writer state (TDMS format only)
+	tdmsWriter			tdms;
+} quickDAQlog;
+
+quickDAQlog* quickDAQlogCreate(unsigned columnCount, unsigned chunkRows, unsigned chunkCount, logFormats format);
+bool quickDAQlogStart(quickDAQlog* log, const char* filePath, int32_t sampleMode, double samplingRate);
+char* quickDAQlogBeginRow(quickDAQlog* log);
+void quickDAQlogEndRow(quickDAQlog* log);
+void quickDAQlogStop(quickDAQlog* log);
+void quickDAQlogFree(quickDAQlog* log);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* quickDAQ_logwriter.h */
@@ -0,0 +1,425 @@
+#pragma once
+#ifndef QUICKDAQ_PLATFORM_H
+#define QUICKDAQ_PLATFORM_H
+
+/* Thin platform layer used by quickDAQ for threads, atomics, aligned memory and time.
+* Windows builds use the Win32 API and MSVC intrinsics, everything else uses POSIX and
+* the GCC/Clang __atomic builtins. Please add functionality as needed.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <quickDAQ_compiler.h>
+
+// Warning stream of modules built without macrodef.h (see the portable CMake target)
+#ifndef ERRSTREAM
+	#define ERRSTREAM	stderr
+#endif
+
+#if defined(_WIN32) || defined(_WIN64)
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+	#include <intrin.h>
+	#include <malloc.h>
+
+	typedef HANDLE qdThread;
+	#define QD_THREAD_FUNC(fnName, argName)	DWORD WINAPI fnName(LPVOID argName)
+	#define QD_THREAD_RETURN				return 0
+#else
+	#include <pthread.h>
+	#include <sched.h>
+	#include <time.h>
+	#include <unistd.h>
+	#include <errno.h>
+
+	typedef pthread_t qdThread;
+	#define QD_THREAD_FUNC(fnName, argName)	void* fnName(void* argName)
+	#define QD_THREAD_RETURN				return NULL
+#endif
+
+//------------------
+// Atomic operations
+//------------------
+// Loads have acquire and stores have release semantics unless marked 'Relaxed'.
+#if defined(_MSC_VER)
+QD_INLINE uint64_t qdAtomicLoad(volatile uint64_t* ptr)
+{
+#if defined(_WIN64)
+	uint64_t val = *ptr;
+	_ReadWriteBarrier();
+	return val;
+#else
+	return (uint64_t)InterlockedCompareExchange64((volatile LONG64*)ptr, 0, 0);
+#endif
+}
+
+QD_INLINE void qdAtomicStore(volatile uint64_t* ptr, uint64_t val)
+{
+#if defined(_WIN64)
+	_ReadWriteBarrier();
+	*ptr = val;
+#else
+	InterlockedExchange64((volatile LONG64*)ptr, (LONG64)val);
+#endif
+}
+
+// Win32: one 64-bit SSE/x87 move, no locked read-modify-write
+QD_INLINE uint64_t qdAtomicLoadRelaxed(volatile uint64_t* ptr)
+{
+#if defined(_WIN64)
+	return *ptr;
+#else
+	return (uint64_t)__iso_volatile_load64((volatile __int64*)ptr);
+#endif
+}
+
+QD_INLINE void qdAtomicStoreRelaxed(volatile uint64_t* ptr, uint64_t val)
+{
+#if defined(_WIN64)
+	*ptr = val;
+#else
+	__iso_volatile_store64((volatile __int64*)ptr, (__int64)val);
+#endif
+}
+
+QD_INLINE uint64_t qdAtomicFetchAdd(volatile uint64_t* ptr, uint64_t val)
+{
+	return (uint64_t)InterlockedExchangeAdd64((volatile LONG64*)ptr, (LONG64)val);
+}
+
+QD_INLINE int qdAtomicCAS(volatile uint64_t* ptr, uint64_t expected, uint64_t desired)
+{
+	return (uint64_t)InterlockedCompareExchange64((volatile LONG64*)ptr, (LONG64)desired, (LONG64)expected) == expected;
+}
+
+QD_INLINE void qdAtomicFence()
+{
+	MemoryBarrier();
+}
+
+QD_INLINE void qdCpuRelax()
+{
+	YieldProcessor();
+}
+
+// Index of the highest set bit; 'val' must be non-zero
+QD_INLINE unsigned qdLog2u64(uint64_t val)
+{
+	unsigned long idx = 0;
+#if defined(_WIN64)
+	_BitScanReverse64(&idx, val);
+#else
+	if ((val >> 32) != 0) {
+		_BitScanReverse(&idx, (unsigned long)(val >> 32));
+		return (unsigned)idx + 32;
+	}
+	_BitScanReverse(&idx, (unsigned long)val);
+#endif
+	return (unsigned)idx;
+}
+#else
+QD_INLINE uint64_t qdAtomicLoad(volatile uint64_t* ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+QD_INLINE void qdAtomicStore(volatile uint64_t* ptr, uint64_t val)
+{
+	__atomic_store_n(ptr, val, __ATOMIC_RELEASE);
+}
+
+QD_INLINE uint64_t qdAtomicLoadRelaxed(volatile uint64_t* ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_RELAXED);
+}
+
+QD_INLINE void qdAtomicStoreRelaxed(volatile uint64_t* ptr, uint64_t val)
+{
+	__atomic_store_n(ptr, val, __ATOMIC_RELAXED);
+}
+
+QD_INLINE uint64_t qdAtomicFetchAdd(volatile uint64_t* ptr, uint64_t val)
+{
+	return __atomic_fetch_add(ptr, val, __ATOMIC_ACQ_REL);
+}
+
+QD_INLINE int qdAtomicCAS(volatile uint64_t* ptr, uint64_t expected, uint64_t desired)
+{
+	return __atomic_compare_exchange_n(ptr, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+QD_INLINE void qdAtomicFence()
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+QD_INLINE void qdCpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+// Index of the highest set bit; 'val' must be non-zero
+QD_INLINE unsigned qdLog2u64(uint64_t val)
+{
+	return 63u - (unsigned)__builtin_clzll(val);
+}
+#endif
+
+//----------------------
+// Threads and sleeping
+//----------------------
+#if defined(_WIN32) || defined(_WIN64)
+QD_INLINE int qdThreadCreate(qdThread* thread, LPTHREAD_START_ROUTINE threadFunc, void* arg)
+{
+	*thread = CreateThread(NULL, 0, threadFunc, arg, 0, NULL);
+	return (*thread == NULL) ? -1 : 0;
+}
+
+QD_INLINE void qdThreadJoin(qdThread thread)
+{
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+}
+
+QD_INLINE void qdThreadYield()
+{
+	SwitchToThread();
+}
+
+QD_INLINE void qdSleepMs(unsigned ms)
+{
+	Sleep(ms);
+}
+#else
+QD_INLINE int qdThreadCreate(qdThread* thread, void* (*threadFunc)(void*), void* arg)
+{
+	return pthread_create(thread, NULL, threadFunc, arg);
+}
+
+QD_INLINE void qdThreadJoin(qdThread thread)
+{
+	pthread_join(thread, NULL);
+}
+
+QD_INLINE void qdThreadYield()
+{
+	sched_yield();
+}
+
+QD_INLINE void qdSleepMs(unsigned ms)
+{
+	struct timespec ts;
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+	nanosleep(&ts, NULL);
+}
+#endif
+
+//-----------------------------------
+// Auto-reset event (thread wake-up)
+//-----------------------------------
+#if defined(_WIN32) || defined(_WIN64)
+typedef HANDLE qdEvent;
+
+QD_INLINE int qdEventInit(qdEvent* ev)
+{
+	*ev = CreateEvent(NULL, FALSE, FALSE, NULL);
+	return (*ev == NULL) ? -1 : 0;
+}
+
+QD_INLINE void qdEventSignal(qdEvent* ev)
+{
+	SetEvent(*ev);
+}
+
+// Waits until signalled or 'ms' elapse; the event is reset on return
+QD_INLINE void qdEventWait(qdEvent* ev, unsigned ms)
+{
+	WaitForSingleObject(*ev, ms);
+}
+
+QD_INLINE void qdEventDestroy(qdEvent* ev)
+{
+	CloseHandle(*ev);
+}
+#else
+typedef struct _qdEvent {
+	pthread_mutex_t	mutex;
+	pthread_cond_t	cond;
+	int				signalled;
+} qdEvent;
+
+QD_INLINE int qdEventInit(qdEvent* ev)
+{
+	ev->signalled = 0;
+	if (pthread_mutex_init(&(ev->mutex), NULL) != 0)
+		return -1;
+	return (pthread_cond_init(&(ev->cond), NULL) == 0) ? 0 : -1;
+}
+
+QD_INLINE void qdEventSignal(qdEvent* ev)
+{
+	pthread_mutex_lock(&(ev->mutex));
+	ev->signalled = 1;
+	pthread_cond_signal(&(ev->cond));
+	pthread_mutex_unlock(&(ev->mutex));
+}
+
+// Waits until signalled or 'ms' elapse; the event is reset on return
+QD_INLINE void qdEventWait(qdEvent* ev, unsigned ms)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += ms / 1000;
+	ts.tv_nsec += (long)(ms % 1000) * 1000000L;
+	if (ts.tv_nsec >= 1000000000L) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+	pthread_mutex_lock(&(ev->mutex));
+	while (!ev->signalled) {
+		if (pthread_cond_timedwait(&(ev->cond), &(ev->mutex), &ts) != 0)
+			break;
+	}
+	ev->signalled = 0;
+	pthread_mutex_unlock(&(ev->mutex));
+}
+
+QD_INLINE void qdEventDestroy(qdEvent* ev)
+{
+	pthread_cond_destroy(&(ev->cond));
+	pthread_mutex_destroy(&(ev->mutex));
+}
+#endif
+
+//------
+// Files
+//------
+// fopen(): fopen_s on Windows, where fopen is deprecated. Returns NULL on failure.
+QD_INLINE FILE* qdFileOpen(const char* path, const char* mode)
+{
+#if defined(_MSC_VER)
+	FILE* file = NULL;
+	if (fopen_s(&file, path, mode) != 0)
+		return NULL;
+	return file;
+#else
+	return fopen(path, mode);
+#endif
+}
+
+//------------------------------
+// Read-only memory-mapped files
+//------------------------------
+typedef struct _qdFileMap {
+	const void	*data;
+	size_t		size;
+#if defined(_WIN32) || defined(_WIN64)
+	HANDLE		file;
+	HANDLE		mapping;
+#endif
+} qdFileMap;
+
+// Defined in quickDAQ_platform.c
+int qdPinCurrentThread(int cpu);
+int qdSetThreadRealtime(int priority);
+int qdLockMemory();
+void qdPrefault(void* mem, size_t size);
+int qdMapFile(const char* path, qdFileMap* map);
+void qdUnmapFile(qdFileMap* map);
+
+//------------------------
+// Aligned heap allocation
+//------------------------
+QD_INLINE void* qdAlignedAlloc(size_t alignment, size_t size)
+{
+#if defined(_WIN32) || defined(_WIN64)
+	return _aligned_malloc(size, alignment);
+#else
+	void* mem = NULL;
+	if (posix_memalign(&mem, alignment, size) != 0)
+		return NULL;
+	return mem;
+#endif
+}
+
+QD_INLINE void qdAlignedFree(void* mem)
+{
+#if defined(_WIN32) || defined(_WIN64)
+	_aligned_free(mem);
+#else
+	free(mem);
+#endif
+}
+
+//----------------
+// Monotonic clock
+//----------------
+QD_INLINE uint64_t qdMonotonicNs()
+{
+#if defined(_WIN32) || defined(_WIN64)
+	static LARGE_INTEGER freq = { 0 };
+	LARGE_INTEGER now;
+	if (freq.QuadPart == 0)
+		QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	return (uint64_t)((now.QuadPart / freq.QuadPart) * 1000000000ULL
+		+ ((now.QuadPart % freq.QuadPart) * 1000000000ULL) / freq.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+	#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+		#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION	0x00000002
+	#endif
+	// Windows wakes up to this late: sleep until the deadline minus the margin, spin the rest
+	#define QD_HIRES_TIMER_MARGIN_NS	500000ULL
+	#define QD_SLEEP_MARGIN_NS			16000000ULL
+#endif
+
+// Sleeps until the qdMonotonicNs() time 'deadlineNs'. Windows uses a per-thread high-resolution
+// waitable timer (Windows 10 1803 and later, else Sleep() at the default ~15.6 ms tick), sleeps
+// until a margin before the deadline and spins the rest.
+QD_INLINE void qdSleepUntilNs(uint64_t deadlineNs)
+{
+#if defined(_WIN32) || defined(_WIN64)
+	static QD_THREAD_LOCAL HANDLE	timer = NULL;
+	static QD_THREAD_LOCAL int		hasTimer = -1;
+	LARGE_INTEGER	due;
+	uint64_t		now = qdMonotonicNs();
+
+	if (hasTimer < 0) {
+		timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		hasTimer = (timer != NULL) ? 1 : 0;
+	}
+	if (hasTimer && deadlineNs > now + QD_HIRES_TIMER_MARGIN_NS) {
+		// Relative due time in 100 ns units
+		due.QuadPart = -(LONGLONG)((deadlineNs - now - QD_HIRES_TIMER_MARGIN_NS) / 100ULL);
+		if (due.QuadPart < 0 && SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE))
+			WaitForSingleObject(timer, INFINITE);
+	}
+	else if (!hasTimer && deadlineNs > now + QD_SLEEP_MARGIN_NS)
+		Sleep((DWORD)((deadlineNs - now - QD_SLEEP_MARGIN_NS) / 1000000ULL));
+	while (qdMonotonicNs() < deadlineNs)
+		qdCpuRelax();
+#else
+	struct timespec ts;
+	ts.tv_sec = (time_t)(deadlineNs / 1000000000ULL);
+	ts.tv_nsec = (long)(deadlineNs % 1000000000ULL);
+	// Only a signal interrupting the sleep is worth retrying; any other error would repeat forever
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+#endif
+}
+
+#endif /* quickDAQ_platform.h */
@@ -0,0 +1,66 @@
+#pragma once
+#ifndef QUICKDAQ_QUEUE_H
+#define QUICKDAQ_QUEUE_H
+
+/* Lock-free output command queue behind scheduleAnalogOut()/scheduleDigitalOut(). */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <quickDAQ_platform.h>
+
+/*!
+* Defines one scheduled output command: write 'value' at cycle 'tick' to element 'idx' of the
+* output task buffer '*frame' (float64 for an AO channel, uInt32 for a DO port).
+*/
+typedef struct _quickDAQcommand {
+	// Slot sequence number of the MPSC queue
+	volatile uint64_t	seq;
+	uint64_t			tick;
+	// Enqueue order; commands for the same tick are applied in this order
+	uint64_t			ticket;
+	void				**frame;
+	unsigned int		idx;
+	bool				isDigital;
+	union {
+		double			analog;
+		uint32_t		digital;
+	} value;
+} quickDAQcommand;
+
+/*!
+* Defines a bounded, lock-free multi-producer single-consumer queue of output commands. Any
+* thread may schedule; the control thread drains it into a tick-ordered heap every cycle.
+*/
+typedef struct _quickDAQcommandQueue {
+	// Producer-shared cache line: next enqueue position
+	volatile uint64_t	tail;
+	char				tailPad[QD_CACHELINE - sizeof(uint64_t)];
+	// Tick of the next cycle to be written, published by the consumer
+	volatile uint64_t	nextTick;
+	char				nextTickPad[QD_CACHELINE - sizeof(uint64_t)];
+
+	// Consumer state
+	uint64_t			head;
+	unsigned			capacity;		// power of two
+	quickDAQcommand		*slots;
+	quickDAQcommand		*pending;		// min-heap on (tick, ticket)
+	unsigned			pendingCnt;
+	uint64_t			appliedCnt;
+	uint64_t			lateCnt;		// applied after their tick had passed
+} quickDAQcommandQueue;
+
+quickDAQcommandQueue* quickDAQqueueCreate(unsigned capacity);
+void quickDAQqueueDestroy(quickDAQcommandQueue* queue);
+void quickDAQqueueReset(quickDAQcommandQueue* queue);
+bool quickDAQqueuePush(quickDAQcommandQueue* queue, const quickDAQcommand* cmd);
+unsigned quickDAQqueueApply(quickDAQcommandQueue* queue, uint64_t tick);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* quickDAQ_queue.h */
@@ -0,0 +1,23 @@
+#pragma once
+#ifndef QUICKDAQ_SCALE_H
+#define QUICKDAQ_SCALE_H
+
+/* Scaling of raw analog counts to engineering units. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+// Coefficients of a raw analog scaling polynomial (NI device scaling, up to cubic)
+#define QUICKDAQ_SCALE_COEFFS		4
+
+void quickDAQscaleI16(const int16_t* raw, unsigned chanCount, unsigned scans, const double* coeffs, double* outputData);
+int quickDAQscaleHasAVX2();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* quickDAQ_scale.h */
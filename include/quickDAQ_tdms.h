@@ -0,0 +1,62 @@
+#pragma once
+#ifndef QUICKDAQ_TDMS_H
+#define QUICKDAQ_TDMS_H
+
+/* NI TDMS 2.0 encoder of the data log (see setDataLogFormat). */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <quickDAQ_platform.h>
+#include <quickDAQ_logfile.h>
+
+//TDMS constants: table of contents flags, file format version and data types
+#define TDMS_TOC_METADATA			(1 << 1)
+#define TDMS_TOC_NEW_OBJ_LIST		(1 << 2)
+#define TDMS_TOC_RAW_DATA			(1 << 3)
+#define TDMS_VERSION				4713
+#define TDMS_LEAD_IN_LEN			28
+#define TDMS_NO_RAW_DATA			0xFFFFFFFF
+#define TDMS_TYPE_I16				0x02
+#define TDMS_TYPE_I32				0x03
+#define TDMS_TYPE_U32				0x07
+#define TDMS_TYPE_U64				0x08
+#define TDMS_TYPE_DOUBLE			0x0A
+#define TDMS_TYPE_STRING			0x20
+#define TDMS_TYPE_TIMESTAMP			0x44
+//Seconds from the TDMS epoch (1904-01-01 UTC) to the Unix epoch
+#define TDMS_EPOCH_OFFSET			2082844800ULL
+
+/*!
+* Defines the state of a TDMS file being written, one segment per data log chunk. The columns
+* are described as in the columnar format; column 0 is the cycle number.
+*/
+typedef struct _tdmsWriter {
+	FILE					*file;
+	const quickDAQlogColumn	*columnInfo;
+	unsigned				columnCount;
+	uint64_t				startTime;		// seconds since the Unix epoch
+	double					increment;		// seconds between rows
+	// Metadata scratch buffer, segments written, rows of the last segment
+	char					*meta;
+	size_t					metaCap;
+	uint64_t				segments;
+	unsigned				lastRows;
+} tdmsWriter;
+
+bool initTdmsWriter(tdmsWriter* tdms, FILE* file, const quickDAQlogColumn* columnInfo, unsigned columnCount,
+	unsigned maxRows, uint64_t startTime, double samplingRate);
+void freeTdmsWriter(tdmsWriter* tdms);
+size_t tdmsLeadIn(char* buf, uint32_t toc, uint64_t metaLen, uint64_t rawLen);
+size_t tdmsMetadata(char* buf, const tdmsWriter* tdms, unsigned rowCount, bool withProperties);
+bool tdmsWriteChunk(tdmsWriter* tdms, char* chunk, unsigned chunkRows, const size_t* columnOffset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* quickDAQ_tdms.h */
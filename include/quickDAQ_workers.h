@@ -0,0 +1,77 @@
+#pragma once
+#ifndef QUICKDAQ_WORKERS_H
+#define QUICKDAQ_WORKERS_H
+
+/* Spin-then-park worker pool used by the cycle engine, the counter reads and the data log reader. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <quickDAQ_platform.h>
+
+//quickDAQ worker pool constants
+#define QUICKDAQ_MAX_WORKERS		16
+// Idle time a worker spins for before parking on its wake event, and the longest park
+#define QUICKDAQ_WORKER_SPIN_NS		2000000
+#define QUICKDAQ_WORKER_PARK_MS		100
+
+/*!
+* Job run by a worker pool: called once for each job number in [0, jobCount).
+*/
+typedef void (*quickDAQjob)(unsigned jobNum, void* jobArg);
+
+/*!
+* Called by each worker thread of a pool once, before its first job (see quickDAQpoolCreateEx).
+*/
+typedef void (*quickDAQworkerInit)(void* initArg);
+
+/*!
+* Defines one pinned worker thread of a worker pool.
+*/
+typedef struct _quickDAQworker {
+	struct _quickDAQworkerPool	*pool;
+	unsigned					workerNum;
+	int							cpu;
+	qdThread					thread;
+	// Set while the worker waits on 'wake' instead of spinning
+	volatile uint64_t			isParked;
+	qdEvent						wake;
+} quickDAQworker;
+
+/*!
+* Defines a small pool of optionally CPU-pinned worker threads. Idle workers spin for
+* QUICKDAQ_WORKER_SPIN_NS, so back-to-back runs (one per cycle) start without a wake-up, then park
+* until the next run. The dispatching thread takes part in every run and returns once all jobs are
+* done (spin barrier).
+*/
+typedef struct _quickDAQworkerPool {
+	// Bumped by the dispatcher to release the workers
+	volatile uint64_t	generation;
+	char				generationPad[QD_CACHELINE - sizeof(uint64_t)];
+	// Workers still busy with the current generation
+	volatile uint64_t	pending;
+	char				pendingPad[QD_CACHELINE - sizeof(uint64_t)];
+
+	quickDAQjob			job;
+	void				*jobArg;
+	unsigned			jobCount;
+	unsigned			workerCount;
+	volatile uint64_t	isRunning;
+	// Run by each worker when it starts, e.g. to bind it to a session
+	quickDAQworkerInit	threadInit;
+	void				*initArg;
+	quickDAQworker		workers[QUICKDAQ_MAX_WORKERS];
+} quickDAQworkerPool;
+
+// worker pool functions
+quickDAQworkerPool* quickDAQpoolCreateEx(unsigned workerCount, const int* cpuList, quickDAQworkerInit threadInit, void* initArg);
+void quickDAQpoolDestroy(quickDAQworkerPool* pool);
+void quickDAQpoolRun(quickDAQworkerPool* pool, unsigned jobCount, quickDAQjob job, void* jobArg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // QUICKDAQ_WORKERS_H
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <quickDAQ_hist.h>
+#include "quickDAQ_tests.h"
+
+//------------------------------------------
+// Timing histogram percentiles
+//------------------------------------------
+// Percentiles are compared to the exact ones of the sorted values: the histogram reports the top
+// of the bucket holding the exact percentile, so it may be high by at most the bucket width
+// (1/2^QUICKDAQ_HIST_SUB_BITS of the value) and never low.
+
+#define TEST_VALUES		20000
+
+static quickDAQhist hist;
+static uint64_t values[TEST_VALUES];
+
+static uint64_t nextRandom(uint64_t* state)
+{
+	// xorshift64*
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 2685821657736338717ULL;
+}
+
+static int compareU64(const void* a, const void* b)
+{
+	const uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+	return (x > y) - (x < y);
+}
+
+// Exact percentile, with the rank rounding quickDAQhistPercentile() uses
+static uint64_t exactPercentile(const uint64_t* sorted, size_t count, double percentile)
+{
+	uint64_t rank = (uint64_t)((percentile / 100.0) * (double)count + 0.5);
+
+	if (rank < 1)
+		rank = 1;
+	return sorted[rank - 1];
+}
+
+static void checkPercentiles(const uint64_t* sorted, size_t count)
+{
+	static const double	percentiles[] = { 0.1, 1.0, 10.0, 50.0, 90.0, 99.0, 99.9 };
+	uint64_t			exact, reported;
+	unsigned			k;
+
+	for (k = 0; k < sizeof(percentiles) / sizeof(percentiles[0]); k++) {
+		exact = exactPercentile(sorted, count, percentiles[k]);
+		reported = quickDAQhistPercentile(&hist, percentiles[k]);
+		QD_CHECK(reported >= exact);
+		QD_CHECK(reported - exact <= (exact >> QUICKDAQ_HIST_SUB_BITS));
+		if (reported < exact || reported - exact > (exact >> QUICKDAQ_HIST_SUB_BITS))
+			fprintf(stderr, "  p%g: exact %llu, reported %llu\n", percentiles[k], (unsigned long long)exact, (unsigned long long)reported);
+	}
+	QD_CHECK(quickDAQhistPercentile(&hist, 100.0) == sorted[count - 1]);
+}
+
+static void testEmpty()
+{
+	memset(&hist, 0, sizeof(hist));
+	QD_CHECK(quickDAQhistPercentile(&hist, 50.0) == 0);
+	QD_CHECK(quickDAQhistPercentile(&hist, 100.0) == 0);
+}
+
+// Below 2^(SUB_BITS+1) every value has its own bucket: percentiles are exact
+static void testSmallValuesExact()
+{
+	uint64_t v;
+
+	memset(&hist, 0, sizeof(hist));
+	for (v = 1; v <= 60; v++)
+		quickDAQhistRecord(&hist, v);
+	QD_CHECK(hist.count == 60 && hist.min == 1 && hist.max == 60 && hist.sum == 60 * 61 / 2);
+	QD_CHECK(quickDAQhistPercentile(&hist, 50.0) == 30);
+	QD_CHECK(quickDAQhistPercentile(&hist, 90.0) == 54);
+	QD_CHECK(quickDAQhistPercentile(&hist, 0.0) == 1);
+	QD_CHECK(quickDAQhistPercentile(&hist, 100.0) == 60);
+}
+
+// Log-uniform values from 100 ns to 100 ms, as cycle timings spread
+static void testWideRange()
+{
+	uint64_t	state = 0x9E3779B97F4A7C15ULL, r;
+	unsigned	k;
+
+	memset(&hist, 0, sizeof(hist));
+	for (k = 0; k < TEST_VALUES; k++) {
+		r = nextRandom(&state);
+		values[k] = (uint64_t)100 << (r % 20);
+		values[k] += (r >> 20) % values[k];
+		quickDAQhistRecord(&hist, values[k]);
+	}
+	qsort(values, TEST_VALUES, sizeof(values[0]), compareU64);
+	QD_CHECK(hist.min == values[0] && hist.max == values[TEST_VALUES - 1]);
+	checkPercentiles(values, TEST_VALUES);
+}
+
+// A tight cluster with rare outliers: the tail percentiles must see the outliers
+static void testOutliers()
+{
+	unsigned k;
+
+	memset(&hist, 0, sizeof(hist));
+	for (k = 0; k < 1000; k++) {
+		values[k] = (k % 100 == 99) ? 5000000 + k : 1000000 + (k % 7) * 1000;
+		quickDAQhistRecord(&hist, values[k]);
+	}
+	qsort(values, 1000, sizeof(values[0]), compareU64);
+	checkPercentiles(values, 1000);
+	QD_CHECK(quickDAQhistPercentile(&hist, 50.0) < 1100000);
+	QD_CHECK(quickDAQhistPercentile(&hist, 99.9) >= 5000000);
+}
+
+// Values past 2^MAX_BITS share the last bucket; min and max stay exact
+static void testClamp()
+{
+	const uint64_t huge = (uint64_t)1 << (QUICKDAQ_HIST_MAX_BITS + 3);
+
+	memset(&hist, 0, sizeof(hist));
+	quickDAQhistRecord(&hist, 10);
+	quickDAQhistRecord(&hist, huge);
+	QD_CHECK(hist.min == 10 && hist.max == huge);
+	QD_CHECK(quickDAQhistPercentile(&hist, 50.0) == 10);
+	QD_CHECK(quickDAQhistPercentile(&hist, 99.0) == ((uint64_t)1 << QUICKDAQ_HIST_MAX_BITS) - 1);
+	QD_CHECK(quickDAQhistPercentile(&hist, 100.0) == huge);
+	QD_CHECK(hist.bucket[QUICKDAQ_HIST_BUCKETS - 1] == 1);
+}
+
+int main()
+{
+	testEmpty();
+	testSmallValuesExact();
+	testWideRange();
+	testOutliers();
+	testClamp();
+	return QD_TEST_RESULT();
+}
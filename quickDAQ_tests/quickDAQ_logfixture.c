@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "quickDAQ_logfixture.h"
+
+//------------------------------------------
+// Shared data log fixture
+//------------------------------------------
+
+const double testScale[QUICKDAQ_SCALE_COEFFS] = { -10.0, 0.0003, 0.0, 0.0 };
+
+uint64_t cycleOf(uint64_t row) { return TEST_FIRST_CYCLE + TEST_CYCLE_STEP * row; }
+int16_t rawOf(uint64_t cycle) { return (int16_t)((int)(cycle * 37) % 60000 - 30000); }
+double analogOf(uint64_t cycle) { return (double)cycle / 8.0; }
+uint32_t portOf(uint64_t cycle) { return (uint32_t)(cycle & 0xFF); }
+
+// Describes the columns and their place in a row; start the log next
+quickDAQlog* createTestLog(logFormats format)
+{
+	quickDAQlog			*log = quickDAQlogCreate(TEST_COLUMNS, TEST_CHUNK_ROWS, TEST_CHUNKS, format);
+	quickDAQlogColumn	*col = NULL;
+
+	if (log == NULL)
+		return NULL;
+	col = &(log->columnInfo[TEST_COL_CYCLE]);
+	snprintf(col->name, QUICKDAQ_LOG_NAME_LEN, "cycle");
+	col->ioMode = TEST_IO_CYCLE;
+	col->valueSize = sizeof(uint64_t);
+	col = &(log->columnInfo[TEST_COL_RAW]);
+	snprintf(col->name, QUICKDAQ_LOG_NAME_LEN, "PXI1Slot%d/ai%d", TEST_AI_DEV, TEST_AI_RAW_PIN);
+	col->devNum = TEST_AI_DEV;
+	col->pinNum = TEST_AI_RAW_PIN;
+	col->ioMode = TEST_IO_ANALOG_IN;
+	col->valueSize = sizeof(int16_t);
+	memcpy(col->scale, testScale, sizeof(testScale));
+	col = &(log->columnInfo[TEST_COL_ANALOG]);
+	snprintf(col->name, QUICKDAQ_LOG_NAME_LEN, "PXI1Slot%d/ai%d", TEST_AI_DEV, TEST_AI_PIN);
+	col->devNum = TEST_AI_DEV;
+	col->pinNum = TEST_AI_PIN;
+	col->ioMode = TEST_IO_ANALOG_IN;
+	col->valueSize = sizeof(double);
+	col = &(log->columnInfo[TEST_COL_DIGITAL]);
+	snprintf(col->name, QUICKDAQ_LOG_NAME_LEN, "PXI1Slot%d/port%d", TEST_DO_DEV, TEST_DO_PORT);
+	col->devNum = TEST_DO_DEV;
+	col->pinNum = TEST_DO_PORT;
+	col->ioMode = TEST_IO_DIGITAL_OUT;
+	col->valueSize = sizeof(double);
+
+	log->rowBytes = TEST_ROW_BYTES;
+	log->sources[TEST_COL_CYCLE].rowOffset = TEST_ROW_CYCLE;
+	log->sources[TEST_COL_CYCLE].type = LOG_SOURCE_U64;
+	log->sources[TEST_COL_RAW].rowOffset = TEST_ROW_RAW;
+	log->sources[TEST_COL_RAW].type = LOG_SOURCE_I16;
+	log->sources[TEST_COL_ANALOG].rowOffset = TEST_ROW_ANALOG;
+	log->sources[TEST_COL_ANALOG].type = LOG_SOURCE_F64;
+	log->sources[TEST_COL_DIGITAL].rowOffset = TEST_ROW_DIGITAL;
+	log->sources[TEST_COL_DIGITAL].type = LOG_SOURCE_U32;
+	return log;
+}
+
+// Logs rows 0 to 'rows' - 1 as logFrame() does. Waits for the writer instead of dropping rows, so
+// the file content is known.
+bool logTestRows(quickDAQlog* log, unsigned rows)
+{
+	char		*row = NULL;
+	uint64_t	cycle;
+	uint32_t	port;
+	int16_t		raw;
+	double		analog;
+	unsigned	r;
+
+	for (r = 0; r < rows; r++) {
+		while (log->rowCount == 0 && log->head - qdAtomicLoad(&log->tail) >= log->chunkCount)
+			qdSleepMs(1);
+		row = quickDAQlogBeginRow(log);
+		if (row == NULL)
+			return false;
+		cycle = cycleOf(r);
+		raw = rawOf(cycle);
+		analog = analogOf(cycle);
+		port = portOf(cycle);
+		memcpy(row + TEST_ROW_CYCLE, &cycle, sizeof(cycle));
+		memcpy(row + TEST_ROW_RAW, &raw, sizeof(raw));
+		memcpy(row + TEST_ROW_ANALOG, &analog, sizeof(analog));
+		memcpy(row + TEST_ROW_DIGITAL, &port, sizeof(port));
+		quickDAQlogEndRow(log);
+	}
+	return true;
+}
+
+// Logs TEST_ROWS rows to 'path' from start to stop
+bool writeTestLog(const char* path, logFormats format)
+{
+	quickDAQlog	*log = createTestLog(format);
+	bool		isWritten = false;
+
+	if (log == NULL)
+		return false;
+	if (quickDAQlogStart(log, path, TEST_SAMPLE_MODE, TEST_RATE)) {
+		isWritten = logTestRows(log, TEST_ROWS);
+		quickDAQlogStop(log);
+		isWritten = isWritten && log->writeError == 0 && log->droppedRows == 0;
+	}
+	quickDAQlogFree(log);
+	return isWritten;
+}
+
+// Whole file in a malloc'd buffer, or NULL
+unsigned char* readTestFile(const char* path, size_t* size)
+{
+	FILE			*file = qdFileOpen(path, "rb");
+	unsigned char	*data = NULL;
+
+	*size = 0;
+	if (file == NULL)
+		return NULL;
+	fseek(file, 0, SEEK_END);
+	*size = (size_t)ftell(file);
+	rewind(file);
+	data = (unsigned char*)malloc(*size + 1);
+	if (data != NULL && fread(data, 1, *size, file) != *size) {
+		free(data);
+		data = NULL;
+	}
+	fclose(file);
+	return data;
+}
+
+bool writeTestFile(const char* path, const unsigned char* data, size_t size)
+{
+	FILE	*file = qdFileOpen(path, "wb");
+	bool	isWritten = false;
+
+	if (file == NULL)
+		return false;
+	isWritten = (fwrite(data, 1, size, file) == size);
+	fclose(file);
+	return isWritten;
+}
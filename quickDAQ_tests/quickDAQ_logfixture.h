@@ -0,0 +1,67 @@
+#pragma once
+#ifndef QUICKDAQ_LOGFIXTURE_H
+#define QUICKDAQ_LOGFIXTURE_H
+
+/* Data log shared by the writer and reader tests: four columns as startDataLog() lays them out for
+* one raw AI pin, one AI pin and one DO port, with row values derived from the row number.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <quickDAQ_logwriter.h>
+
+// IOmodes values of quickDAQ.h, which needs NI-DAQmx
+#define TEST_IO_CYCLE		32767	// INVALID_IO: the cycle column
+#define TEST_IO_ANALOG_IN	0		// ANALOG_IN
+#define TEST_IO_DIGITAL_OUT	3		// DIGITAL_OUT
+
+// Columns and the devices and pins they log
+#define TEST_COL_CYCLE		0
+#define TEST_COL_RAW		1		// raw AI counts
+#define TEST_COL_ANALOG		2		// AI value
+#define TEST_COL_DIGITAL	3		// DO port
+#define TEST_COLUMNS		4
+#define TEST_AI_DEV			2
+#define TEST_AI_RAW_PIN		0
+#define TEST_AI_PIN			1
+#define TEST_DO_DEV			3
+#define TEST_DO_PORT		0
+
+// Row layout, as logFrame() copies the frames: cycle, raw AI frame, AI frame, DO frame
+#define TEST_ROW_CYCLE		0
+#define TEST_ROW_RAW		8
+#define TEST_ROW_ANALOG		16
+#define TEST_ROW_DIGITAL	24
+#define TEST_ROW_BYTES		28
+// Bytes of one row in the file: cycle, raw count, AI value, DO port as float64
+#define TEST_FILE_ROW_BYTES	(8 + 2 + 8 + 8)
+
+// 5 full chunks and a partial one
+#define TEST_CHUNK_ROWS		16
+#define TEST_CHUNKS			4
+#define TEST_ROWS			(5 * TEST_CHUNK_ROWS + 5)
+#define TEST_FULL_CHUNKS	(TEST_ROWS / TEST_CHUNK_ROWS)
+#define TEST_LAST_ROWS		(TEST_ROWS % TEST_CHUNK_ROWS)
+#define TEST_SAMPLE_MODE	10123	// DAQmx_Val_ContSamps
+#define TEST_RATE			500.0
+#define TEST_PERIOD_NS		2000000
+// Cycles are not contiguous, as after missed edges
+#define TEST_FIRST_CYCLE	1000
+#define TEST_CYCLE_STEP		3
+
+extern const double testScale[QUICKDAQ_SCALE_COEFFS];
+
+// Values logged at one row or cycle
+uint64_t cycleOf(uint64_t row);
+int16_t rawOf(uint64_t cycle);
+double analogOf(uint64_t cycle);
+uint32_t portOf(uint64_t cycle);
+
+quickDAQlog* createTestLog(logFormats format);
+bool logTestRows(quickDAQlog* log, unsigned rows);
+bool writeTestLog(const char* path, logFormats format);
+unsigned char* readTestFile(const char* path, size_t* size);
+bool writeTestFile(const char* path, const unsigned char* data, size_t size);
+
+#endif /* quickDAQ_logfixture.h */
@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <quickDAQ_logreader.h>
+#include "quickDAQ_logfixture.h"
+#include "quickDAQ_tests.h"
+
+//------------------------------------------
+// Data log round trip: writer, then reader
+//------------------------------------------
+// Logs 5 full chunks and a partial one, then reads them back through the block index, through an
+// index rebuilt from the chunk headers (corrupt footer, no index, log cut short) and in parallel.
+// Chunk times are rewritten to one sampling period per cycle once logged, so that seeking by time
+// has exact answers: row r is at TEST_CYCLE_STEP * r periods.
+
+#define TEST_LOG		"quickDAQ_logreader_test.qdlog"
+#define TEST_COPY		"quickDAQ_logreader_test_copy.qdlog"
+
+static double secondsOf(uint64_t row) { return (double)(cycleOf(row) - TEST_FIRST_CYCLE) * TEST_PERIOD_NS / 1e9; }
+
+static unsigned char	*logData = NULL;
+static size_t			logSize = 0;
+
+// Sets the chunk and index times to one sampling period per cycle, end entry included
+static void retimeLog()
+{
+	quickDAQlogFooter		footer;
+	quickDAQlogIndexEntry	entry;
+	uint64_t				t;
+	unsigned				k;
+
+	memcpy(&footer, logData + logSize - sizeof(footer), sizeof(footer));
+	for (k = 0; k < footer.entryCount; k++) {
+		memcpy(&entry, logData + footer.indexOffset + k * sizeof(entry), sizeof(entry));
+		entry.time = (entry.firstCycle - TEST_FIRST_CYCLE) * TEST_PERIOD_NS;
+		memcpy(logData + footer.indexOffset + k * sizeof(entry), &entry, sizeof(entry));
+		if (k + 1 < footer.entryCount) {
+			t = entry.time;
+			memcpy(logData + entry.offset + offsetof(quickDAQlogChunk, firstTime), &t, sizeof(t));
+		}
+	}
+}
+
+static void checkRows(const double* output, uint64_t stride, uint64_t firstRow, uint64_t rowCount)
+{
+	uint64_t	r, cycle;
+	double		expected;
+
+	for (r = 0; r < rowCount; r++) {
+		cycle = cycleOf(firstRow + r);
+		expected = testScale[0] + testScale[1] * rawOf(cycle);
+		QD_CHECK(output[TEST_COL_CYCLE * stride + r] == (double)cycle);
+		QD_CHECK(fabs(output[TEST_COL_RAW * stride + r] - expected) < 1e-9);
+		QD_CHECK(output[TEST_COL_ANALOG * stride + r] == analogOf(cycle));
+		QD_CHECK(output[TEST_COL_DIGITAL * stride + r] == (double)portOf(cycle));
+	}
+}
+
+static void checkExtract(const quickDAQlogFile* logFile, uint64_t rowCount)
+{
+	static const unsigned	columns[TEST_COLUMNS] = { TEST_COL_CYCLE, TEST_COL_RAW, TEST_COL_ANALOG, TEST_COL_DIGITAL };
+	static const unsigned	swapped[2] = { TEST_COL_DIGITAL, TEST_COL_CYCLE };
+	static const unsigned	missing[1] = { TEST_COLUMNS };
+	double					*output = (double*)malloc(TEST_COLUMNS * TEST_ROWS * sizeof(double));
+	unsigned				workers;
+
+	QD_REQUIRE(output != NULL);
+	// Whole log, by the calling thread alone and by pools of 1 and 3 workers
+	for (workers = 0; workers <= 3; workers += (workers == 0) ? 1 : 2) {
+		memset(output, 0, TEST_COLUMNS * TEST_ROWS * sizeof(double));
+		QD_CHECK(quickDAQlogExtract(logFile, 0, rowCount, columns, TEST_COLUMNS, output, workers) == rowCount);
+		checkRows(output, rowCount, 0, rowCount);
+	}
+	// A range across chunk boundaries, columns in the requested order
+	QD_CHECK(quickDAQlogExtract(logFile, 10, 30, swapped, 2, output, 2) == 30);
+	QD_CHECK(output[0] == (double)portOf(cycleOf(10)) && output[29] == (double)portOf(cycleOf(39)));
+	QD_CHECK(output[30] == (double)cycleOf(10) && output[59] == (double)cycleOf(39));
+	// Past the end: the rows that exist, the rest left as is; columns keep the requested stride
+	output[4] = -1.0;
+	QD_CHECK(quickDAQlogExtract(logFile, rowCount - 4, 8, columns, TEST_COLUMNS, output, 2) == 4);
+	QD_CHECK(output[3] == (double)cycleOf(rowCount - 1) && output[4] == -1.0);
+	QD_CHECK(output[TEST_COL_ANALOG * 8] == analogOf(cycleOf(rowCount - 4)));
+	QD_CHECK(quickDAQlogExtract(logFile, rowCount, 1, columns, TEST_COLUMNS, output, 0) == 0);
+	QD_CHECK(quickDAQlogExtract(logFile, 0, 1, missing, 1, output, 0) == 0);
+	free(output);
+}
+
+static void checkSeek(const quickDAQlogFile* logFile, uint64_t rowCount)
+{
+	const double	period = TEST_PERIOD_NS / 1e9;
+	uint64_t		r;
+
+	QD_CHECK(quickDAQlogRowAt(logFile, -1.0) == 0);
+	QD_CHECK(quickDAQlogRowAt(logFile, 0.0) == 0);
+	for (r = 0; r < rowCount; r++) {
+		QD_CHECK(fabs(quickDAQlogTimeOf(logFile, r) - secondsOf(r)) < 1e-9);
+		QD_CHECK(quickDAQlogRowAt(logFile, secondsOf(r)) == r);
+		// Between rows: the next one
+		if (r > 0)
+			QD_CHECK(quickDAQlogRowAt(logFile, secondsOf(r) - 1.5 * period) == r);
+		QD_CHECK(quickDAQlogRowAt(logFile, secondsOf(r) + 0.5 * period) == r + 1);
+	}
+	QD_CHECK(quickDAQlogRowAt(logFile, secondsOf(rowCount - 1) + 1.5 * period) == rowCount);
+	QD_CHECK(quickDAQlogRowAt(logFile, 1e6) == rowCount);
+	QD_CHECK(quickDAQlogTimeOf(logFile, rowCount) == logFile->index[logFile->chunkCount].time / 1e9);
+}
+
+static void checkIndex(const quickDAQlogFile* logFile, uint64_t chunkCount, uint64_t rowCount)
+{
+	const quickDAQlogHeader	*header = logFile->header;
+	uint64_t				k;
+
+	QD_REQUIRE(logFile->chunkCount == chunkCount);
+	QD_CHECK(logFile->rowCount == rowCount);
+	for (k = 0; k < chunkCount; k++) {
+		QD_CHECK(logFile->index[k].firstRow == k * TEST_CHUNK_ROWS);
+		QD_CHECK(logFile->index[k].firstCycle == cycleOf(k * TEST_CHUNK_ROWS));
+		QD_CHECK(logFile->index[k].time == (cycleOf(k * TEST_CHUNK_ROWS) - TEST_FIRST_CYCLE) * TEST_PERIOD_NS);
+		QD_CHECK(logFile->index[k].offset == header->headerBytes + k * header->chunkBytes);
+	}
+	QD_CHECK(logFile->index[chunkCount].firstRow == rowCount);
+	QD_CHECK(logFile->index[chunkCount].firstCycle == cycleOf(rowCount - 1) + 1);
+}
+
+// Complete log: the block index is used in place
+static void testIndexedLog()
+{
+	quickDAQlog		*expected = createTestLog(LOG_COLUMNAR);
+	quickDAQlogFile	*logFile = NULL;
+
+	QD_REQUIRE(expected != NULL);
+	QD_REQUIRE(writeTestFile(TEST_COPY, logData, logSize));
+	logFile = quickDAQlogOpen(TEST_COPY);
+	QD_REQUIRE(logFile != NULL);
+	QD_CHECK(logFile->indexCopy == NULL);
+	QD_CHECK(logFile->header->columnCount == TEST_COLUMNS && logFile->header->samplingRate == TEST_RATE);
+	QD_CHECK(memcmp(logFile->columnInfo, expected->columnInfo, TEST_COLUMNS * sizeof(quickDAQlogColumn)) == 0);
+	QD_CHECK(quickDAQlogFindColumn(logFile, TEST_AI_DEV, TEST_IO_ANALOG_IN, TEST_AI_PIN) == TEST_COL_ANALOG);
+	QD_CHECK(quickDAQlogFindColumn(logFile, TEST_DO_DEV, TEST_IO_DIGITAL_OUT, TEST_DO_PORT) == TEST_COL_DIGITAL);
+	QD_CHECK(quickDAQlogFindColumn(logFile, TEST_DO_DEV, TEST_IO_ANALOG_IN, TEST_DO_PORT) == -1);
+	quickDAQlogFree(expected);
+	checkIndex(logFile, TEST_FULL_CHUNKS + 1, TEST_ROWS);
+	QD_CHECK(logFile->index[TEST_FULL_CHUNKS + 1].time == (cycleOf(TEST_ROWS - 1) + 1 - TEST_FIRST_CYCLE) * TEST_PERIOD_NS);
+	checkSeek(logFile, TEST_ROWS);
+	checkExtract(logFile, TEST_ROWS);
+	quickDAQlogClose(logFile);
+}
+
+// Index that fails validation, or no index: rebuilt from the chunk headers, the end entry timed
+// at the sampling rate
+static void testRebuiltIndex()
+{
+	const quickDAQlogHeader	*header = (const quickDAQlogHeader*)logData;
+	const size_t			indexOffset = header->headerBytes + (size_t)(TEST_FULL_CHUNKS + 1) * header->chunkBytes;
+	quickDAQlogFooter		footer;
+	quickDAQlogFile			*logFile = NULL;
+	unsigned char			*copy = (unsigned char*)malloc(logSize);
+	unsigned				k;
+
+	QD_REQUIRE(copy != NULL);
+	// Bad magic, index not after the chunks, index not up to the footer
+	for (k = 0; k < 4; k++) {
+		memcpy(copy, logData, logSize);
+		memcpy(&footer, copy + logSize - sizeof(footer), sizeof(footer));
+		if (k == 0)
+			footer.magic[0] ^= 1;
+		else if (k == 1) {
+			footer.indexOffset += sizeof(quickDAQlogIndexEntry);
+			footer.entryCount--;
+		}
+		else if (k == 2)
+			footer.indexOffset += header->chunkBytes;
+		else
+			footer.entryCount++;
+		memcpy(copy + logSize - sizeof(footer), &footer, sizeof(footer));
+		QD_REQUIRE(writeTestFile(TEST_COPY, copy, logSize));
+		logFile = quickDAQlogOpen(TEST_COPY);
+		QD_REQUIRE(logFile != NULL);
+		QD_CHECK(logFile->indexCopy != NULL);
+		checkIndex(logFile, TEST_FULL_CHUNKS + 1, TEST_ROWS);
+		QD_CHECK(logFile->index[TEST_FULL_CHUNKS + 1].time == logFile->index[TEST_FULL_CHUNKS].time + TEST_LAST_ROWS * TEST_PERIOD_NS);
+		checkExtract(logFile, TEST_ROWS);
+		quickDAQlogClose(logFile);
+	}
+
+	// Writer stopped before the index
+	QD_REQUIRE(writeTestFile(TEST_COPY, logData, indexOffset));
+	logFile = quickDAQlogOpen(TEST_COPY);
+	QD_REQUIRE(logFile != NULL);
+	QD_CHECK(logFile->indexCopy != NULL);
+	checkIndex(logFile, TEST_FULL_CHUNKS + 1, TEST_ROWS);
+	quickDAQlogClose(logFile);
+
+	// Cut in the middle of chunk 3: the whole chunks before it
+	QD_REQUIRE(writeTestFile(TEST_COPY, logData, header->headerBytes + 3 * (size_t)header->chunkBytes + header->chunkBytes / 2));
+	logFile = quickDAQlogOpen(TEST_COPY);
+	QD_REQUIRE(logFile != NULL);
+	checkIndex(logFile, 3, 3 * TEST_CHUNK_ROWS);
+	QD_CHECK(logFile->index[3].time == logFile->index[2].time + TEST_CHUNK_ROWS * TEST_PERIOD_NS);
+	checkExtract(logFile, 3 * TEST_CHUNK_ROWS);
+	quickDAQlogClose(logFile);
+
+	// Header only
+	QD_REQUIRE(writeTestFile(TEST_COPY, logData, header->headerBytes));
+	logFile = quickDAQlogOpen(TEST_COPY);
+	QD_REQUIRE(logFile != NULL);
+	QD_CHECK(logFile->chunkCount == 0 && logFile->rowCount == 0);
+	QD_CHECK(quickDAQlogRowAt(logFile, 1.0) == 0);
+	quickDAQlogClose(logFile);
+	free(copy);
+}
+
+// Files that are not data logs are refused
+static void testNotALog()
+{
+	unsigned char *copy = (unsigned char*)malloc(logSize);
+
+	QD_REQUIRE(copy != NULL);
+	QD_CHECK(quickDAQlogOpen("quickDAQ_logreader_test_missing.qdlog") == NULL);
+	memcpy(copy, logData, logSize);
+	copy[0] ^= 1;
+	QD_REQUIRE(writeTestFile(TEST_COPY, copy, logSize));
+	QD_CHECK(quickDAQlogOpen(TEST_COPY) == NULL);
+	memcpy(copy, logData, logSize);
+	((quickDAQlogHeader*)copy)->version = QUICKDAQ_LOG_VERSION + 1;
+	QD_REQUIRE(writeTestFile(TEST_COPY, copy, logSize));
+	QD_CHECK(quickDAQlogOpen(TEST_COPY) == NULL);
+	QD_REQUIRE(writeTestFile(TEST_COPY, copy, sizeof(quickDAQlogHeader) - 1));
+	QD_CHECK(quickDAQlogOpen(TEST_COPY) == NULL);
+	free(copy);
+}
+
+int main()
+{
+	QD_CHECK(writeTestLog(TEST_LOG, LOG_COLUMNAR));
+	logData = readTestFile(TEST_LOG, &logSize);
+	QD_CHECK(logData != NULL);
+	if (logData != NULL) {
+		retimeLog();
+		testIndexedLog();
+		testRebuiltIndex();
+		testNotALog();
+		free(logData);
+	}
+	remove(TEST_LOG);
+	remove(TEST_COPY);
+	return QD_TEST_RESULT();
+}
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "quickDAQ_logfixture.h"
+#include "quickDAQ_tests.h"
+
+//------------------------------------------
+// Columnar data log encode and flush
+//------------------------------------------
+// Logs 5 full chunks and a partial one through the writer thread, then reads the file back byte
+// by byte: header, column descriptors, chunk headers and columns, block index and footer.
+
+#define TEST_LOG		"quickDAQ_logwriter_test.qdlog"
+#define TEST_TDMS		"quickDAQ_logwriter_test.tdms"
+
+static void checkChunkData(const unsigned char* chunk, const quickDAQlogHeader* header, unsigned firstRow, unsigned rows)
+{
+	const unsigned char	*data = chunk + QUICKDAQ_LOG_CHUNK_HEAD;
+	uint64_t			cycle, u64;
+	int16_t				i16;
+	double				f64;
+	unsigned			r;
+
+	// Columns one after the other, 'chunkRows' values each: cycle, raw count, AI value, DO port
+	for (r = 0; r < rows; r++) {
+		cycle = cycleOf(firstRow + r);
+		memcpy(&u64, data + r * 8, 8);
+		QD_CHECK(u64 == cycle);
+		memcpy(&i16, data + header->chunkRows * 8 + r * 2, 2);
+		QD_CHECK(i16 == rawOf(cycle));
+		memcpy(&f64, data + header->chunkRows * 10 + r * 8, 8);
+		QD_CHECK(f64 == analogOf(cycle));
+		memcpy(&f64, data + header->chunkRows * 18 + r * 8, 8);
+		QD_CHECK(f64 == (double)portOf(cycle));
+	}
+}
+
+static void testColumnar()
+{
+	const unsigned			chunkTotal = TEST_FULL_CHUNKS + 1;
+	quickDAQlog				*log = createTestLog(LOG_COLUMNAR);
+	quickDAQlogColumn		expectedColumns[TEST_COLUMNS];
+	quickDAQlogHeader		header;
+	quickDAQlogChunk		info;
+	quickDAQlogIndexEntry	entry, prevEntry;
+	quickDAQlogFooter		footer;
+	unsigned char			*file = NULL;
+	size_t					size = 0, indexOffset = 0;
+	uint64_t				timeBefore = (uint64_t)time(NULL), timeAfter, lastFirstTime = 0;
+	unsigned				k, rows;
+
+	QD_REQUIRE(log != NULL);
+	memcpy(expectedColumns, log->columnInfo, sizeof(expectedColumns));
+	QD_REQUIRE(quickDAQlogStart(log, TEST_LOG, TEST_SAMPLE_MODE, TEST_RATE));
+	QD_CHECK(logTestRows(log, TEST_ROWS));
+	quickDAQlogStop(log);
+	timeAfter = (uint64_t)time(NULL);
+	QD_CHECK(log->writeError == 0 && log->droppedRows == 0);
+	quickDAQlogFree(log);
+
+	file = readTestFile(TEST_LOG, &size);
+	QD_REQUIRE(file != NULL && size >= sizeof(header));
+	memcpy(&header, file, sizeof(header));
+	QD_CHECK(memcmp(header.magic, QUICKDAQ_LOG_MAGIC, 8) == 0);
+	QD_CHECK(header.version == QUICKDAQ_LOG_VERSION);
+	QD_CHECK(header.headerBytes % QUICKDAQ_LOG_ALIGN == 0);
+	QD_CHECK(header.headerBytes >= sizeof(header) + TEST_COLUMNS * sizeof(quickDAQlogColumn));
+	QD_CHECK(header.columnCount == TEST_COLUMNS && header.chunkRows == TEST_CHUNK_ROWS);
+	QD_CHECK(header.chunkBytes % QUICKDAQ_LOG_ALIGN == 0 && header.chunkBytes >= QUICKDAQ_LOG_CHUNK_HEAD + TEST_CHUNK_ROWS * TEST_FILE_ROW_BYTES);
+	QD_CHECK(header.sampleMode == TEST_SAMPLE_MODE && header.samplingRate == TEST_RATE);
+	QD_CHECK(header.startTime >= timeBefore && header.startTime <= timeAfter);
+	QD_CHECK(memcmp(file + sizeof(header), expectedColumns, sizeof(expectedColumns)) == 0);
+
+	// Chunks, then one index entry per chunk plus the end entry, then the footer
+	indexOffset = header.headerBytes + (size_t)chunkTotal * header.chunkBytes;
+	QD_REQUIRE(size == indexOffset + (chunkTotal + 1) * sizeof(quickDAQlogIndexEntry) + sizeof(footer));
+	for (k = 0; k < chunkTotal; k++) {
+		rows = (k + 1 < chunkTotal) ? TEST_CHUNK_ROWS : TEST_ROWS - k * TEST_CHUNK_ROWS;
+		memcpy(&info, file + header.headerBytes + (size_t)k * header.chunkBytes, sizeof(info));
+		QD_CHECK(info.chunkNum == k && info.rowCount == rows && info.droppedRows == 0);
+		QD_CHECK(info.firstTime >= lastFirstTime);
+		lastFirstTime = info.firstTime;
+		checkChunkData(file + header.headerBytes + (size_t)k * header.chunkBytes, &header, k * TEST_CHUNK_ROWS, rows);
+
+		memcpy(&entry, file + indexOffset + k * sizeof(entry), sizeof(entry));
+		QD_CHECK(entry.firstRow == (uint64_t)k * TEST_CHUNK_ROWS);
+		QD_CHECK(entry.firstCycle == cycleOf(k * TEST_CHUNK_ROWS));
+		QD_CHECK(entry.time == info.firstTime);
+		QD_CHECK(entry.offset == header.headerBytes + (uint64_t)k * header.chunkBytes);
+		prevEntry = entry;
+	}
+	// End entry: one row past the last, timed at the sampling rate
+	memcpy(&entry, file + indexOffset + chunkTotal * sizeof(entry), sizeof(entry));
+	QD_CHECK(entry.firstRow == TEST_ROWS);
+	QD_CHECK(entry.firstCycle == cycleOf(TEST_ROWS - 1) + 1);
+	QD_CHECK(entry.time == prevEntry.time + (uint64_t)(TEST_LAST_ROWS * 1e9 / TEST_RATE));
+	QD_CHECK(entry.offset == indexOffset);
+	memcpy(&footer, file + size - sizeof(footer), sizeof(footer));
+	QD_CHECK(footer.entryCount == chunkTotal + 1 && footer.indexOffset == indexOffset);
+	QD_CHECK(memcmp(footer.magic, QUICKDAQ_LOG_INDEX_MAGIC, 8) == 0);
+	free(file);
+	remove(TEST_LOG);
+}
+
+// A log stopped before its first row holds the header only, and no index
+static void testEmptyLog()
+{
+	quickDAQlog			*log = createTestLog(LOG_COLUMNAR);
+	quickDAQlogHeader	header;
+	unsigned char		*file = NULL;
+	size_t				size = 0;
+
+	QD_REQUIRE(log != NULL);
+	QD_REQUIRE(quickDAQlogStart(log, TEST_LOG, TEST_SAMPLE_MODE, TEST_RATE));
+	quickDAQlogStop(log);
+	QD_CHECK(log->writeError == 0);
+	quickDAQlogFree(log);
+	file = readTestFile(TEST_LOG, &size);
+	QD_REQUIRE(file != NULL && size >= sizeof(header));
+	memcpy(&header, file, sizeof(header));
+	QD_CHECK(size == header.headerBytes);
+	free(file);
+	remove(TEST_LOG);
+}
+
+// TDMS: one segment per chunk, chained by their lead-ins up to the end of the file
+static void testTdms()
+{
+	static const uint32_t	fullToc = TDMS_TOC_METADATA | TDMS_TOC_NEW_OBJ_LIST | TDMS_TOC_RAW_DATA;
+	const unsigned			chunkTotal = TEST_FULL_CHUNKS + 1;
+	quickDAQlog				*log = createTestLog(LOG_TDMS);
+	unsigned char			*file = NULL;
+	size_t					size = 0, pos = 0, rawLen = 0;
+	uint64_t				nextSegment, metaLen;
+	uint32_t				toc;
+	unsigned				seg = 0, rows;
+
+	QD_REQUIRE(log != NULL);
+	QD_REQUIRE(quickDAQlogStart(log, TEST_TDMS, TEST_SAMPLE_MODE, TEST_RATE));
+	QD_CHECK(logTestRows(log, TEST_ROWS));
+	quickDAQlogStop(log);
+	QD_CHECK(log->writeError == 0 && log->droppedRows == 0);
+	quickDAQlogFree(log);
+
+	file = readTestFile(TEST_TDMS, &size);
+	QD_REQUIRE(file != NULL);
+	while (pos + TDMS_LEAD_IN_LEN <= size && seg < chunkTotal) {
+		rows = (seg + 1 < chunkTotal) ? TEST_CHUNK_ROWS : TEST_ROWS - seg * TEST_CHUNK_ROWS;
+		rawLen = (size_t)rows * TEST_FILE_ROW_BYTES;
+		memcpy(&toc, file + pos + 4, 4);
+		memcpy(&nextSegment, file + pos + 12, 8);
+		memcpy(&metaLen, file + pos + 20, 8);
+		QD_CHECK(memcmp(file + pos, "TDSm", 4) == 0);
+		// Full chunks after the first repeat its object list; the partial last one does not
+		QD_CHECK(toc == ((seg == 0 || rows != TEST_CHUNK_ROWS) ? fullToc : (uint32_t)TDMS_TOC_RAW_DATA));
+		QD_CHECK(nextSegment - metaLen == rawLen);
+		QD_CHECK(toc == fullToc || metaLen == 0);
+		pos += TDMS_LEAD_IN_LEN + (size_t)nextSegment;
+		seg++;
+	}
+	QD_CHECK(seg == chunkTotal);
+	QD_CHECK(pos == size);
+	free(file);
+	remove(TEST_TDMS);
+}
+
+int main()
+{
+	testColumnar();
+	testEmptyLog();
+	testTdms();
+	return QD_TEST_RESULT();
+}
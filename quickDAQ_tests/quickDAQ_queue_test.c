@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <quickDAQ_queue.h>
+#include "quickDAQ_tests.h"
+
+//------------------------------------------
+// Output command queue under concurrent producers
+//------------------------------------------
+// Each producer owns one DO port and writes an increasing counter to it, 4 commands per tick, and
+// also writes the tick to a shared AO channel. Commands are applied in tick then enqueue order, so:
+// - a producer's port is the value of its last command due, and never goes back;
+// - the shared channel holds the last enqueued command of the latest tick due.
+
+#define TEST_PRODUCERS		4
+#define TEST_PER_TICK		4
+#define TEST_TICKS			2000
+#define TEST_COMMANDS		(TEST_TICKS * TEST_PER_TICK)
+
+typedef struct _producerArg {
+	quickDAQcommandQueue	*queue;
+	unsigned				producer;
+	void					**digitalFrame;
+	void					**analogFrame;
+	volatile uint64_t		*start;
+	uint64_t				rejected;		// pushes refused because the queue was full
+} producerArg;
+
+static uint32_t	ports[TEST_PRODUCERS];
+static double	shared[1];
+static void		*portFrame = ports;
+static void		*sharedFrame = shared;
+
+static void pushOrRetry(producerArg* arg, const quickDAQcommand* cmd)
+{
+	while (!quickDAQqueuePush(arg->queue, cmd)) {
+		arg->rejected++;
+		qdThreadYield();
+	}
+}
+
+static QD_THREAD_FUNC(producerThread, param)
+{
+	producerArg		*arg = (producerArg*)param;
+	quickDAQcommand	cmd;
+	unsigned		k;
+
+	while (qdAtomicLoad(arg->start) == 0)
+		qdCpuRelax();
+	memset(&cmd, 0, sizeof(cmd));
+	for (k = 0; k < TEST_COMMANDS; k++) {
+		cmd.tick = k / TEST_PER_TICK;
+		cmd.frame = arg->digitalFrame;
+		cmd.idx = arg->producer;
+		cmd.isDigital = true;
+		cmd.value.digital = k + 1;
+		pushOrRetry(arg, &cmd);
+		if (k % TEST_PER_TICK == 0) {
+			cmd.frame = arg->analogFrame;
+			cmd.idx = 0;
+			cmd.isDigital = false;
+			cmd.value.analog = (double)cmd.tick + (double)arg->producer / 16.0;
+			pushOrRetry(arg, &cmd);
+		}
+	}
+	QD_THREAD_RETURN;
+}
+
+static void startProducers(quickDAQcommandQueue* queue, producerArg* args, qdThread* threads, volatile uint64_t* start)
+{
+	unsigned p;
+
+	qdAtomicStore(start, 0);
+	for (p = 0; p < TEST_PRODUCERS; p++) {
+		args[p].queue = queue;
+		args[p].producer = p;
+		args[p].digitalFrame = &portFrame;
+		args[p].analogFrame = &sharedFrame;
+		args[p].start = start;
+		args[p].rejected = 0;
+		qdThreadCreate(&(threads[p]), producerThread, &(args[p]));
+	}
+	qdAtomicStore(start, 1);
+}
+
+// Expected shared value after applying 'tick': the command for 'tick' enqueued last. The queue
+// slots still hold every command with its ticket, since nothing has been drained yet.
+static double lastSharedCommand(const quickDAQcommandQueue* queue, uint64_t tick)
+{
+	const quickDAQcommand	*cmd = NULL;
+	uint64_t				bestTicket = 0;
+	double					value = -1.0;
+	unsigned				k;
+
+	for (k = 0; k < queue->capacity; k++) {
+		cmd = &(queue->slots[k]);
+		if (cmd->seq == cmd->ticket + 1 && !cmd->isDigital && cmd->tick == tick && (value < 0 || cmd->ticket > bestTicket)) {
+			bestTicket = cmd->ticket;
+			value = cmd->value.analog;
+		}
+	}
+	return value;
+}
+
+// Producers fill the queue concurrently; then ticks are applied one by one
+static void testOrderAfterConcurrentPush()
+{
+	const unsigned			total = TEST_PRODUCERS * (TEST_COMMANDS + TEST_TICKS);
+	quickDAQcommandQueue	*queue = quickDAQqueueCreate(total);
+	producerArg				args[TEST_PRODUCERS];
+	qdThread				threads[TEST_PRODUCERS];
+	volatile uint64_t		start = 0;
+	double					*expectedShared = NULL;
+	uint64_t				tick;
+	unsigned				p, applied = 0;
+
+	QD_REQUIRE(queue != NULL);
+	memset(ports, 0, sizeof(ports));
+	shared[0] = -1.0;
+	startProducers(queue, args, threads, &start);
+	for (p = 0; p < TEST_PRODUCERS; p++)
+		qdThreadJoin(threads[p]);
+	for (p = 0; p < TEST_PRODUCERS; p++)
+		QD_CHECK(args[p].rejected == 0);
+	QD_CHECK(qdAtomicLoad(&queue->tail) == total);
+
+	expectedShared = (double*)malloc(TEST_TICKS * sizeof(double));
+	QD_REQUIRE(expectedShared != NULL);
+	for (tick = 0; tick < TEST_TICKS; tick++)
+		expectedShared[tick] = lastSharedCommand(queue, tick);
+
+	for (tick = 0; tick < TEST_TICKS; tick++) {
+		applied += quickDAQqueueApply(queue, tick);
+		QD_CHECK(qdAtomicLoad(&queue->nextTick) == tick + 1);
+		for (p = 0; p < TEST_PRODUCERS; p++)
+			QD_CHECK(ports[p] == (tick + 1) * TEST_PER_TICK);
+		QD_CHECK(shared[0] == expectedShared[tick]);
+		QD_CHECK((uint64_t)shared[0] == tick);
+	}
+	QD_CHECK(applied == total);
+	QD_CHECK(queue->appliedCnt == total && queue->lateCnt == 0 && queue->pendingCnt == 0);
+	free(expectedShared);
+	quickDAQqueueDestroy(queue);
+}
+
+// The consumer applies ticks while producers push into a small queue: every command is applied
+// exactly once and each producer's commands in order, late ones at the next tick. Producers run
+// at different ticks, so the shared channel may go back when a slower one catches up.
+static void testOrderWhileConsuming()
+{
+	const unsigned			total = TEST_PRODUCERS * (TEST_COMMANDS + TEST_TICKS);
+	quickDAQcommandQueue	*queue = quickDAQqueueCreate(64);
+	producerArg				args[TEST_PRODUCERS];
+	qdThread				threads[TEST_PRODUCERS];
+	volatile uint64_t		start = 0;
+	uint32_t				lastPorts[TEST_PRODUCERS];
+	uint64_t				tick = 0, applied = 0, rejected = 0;
+	unsigned				p, n;
+	bool					isMonotonic = true;
+
+	QD_REQUIRE(queue != NULL);
+	memset(ports, 0, sizeof(ports));
+	memset(lastPorts, 0, sizeof(lastPorts));
+	shared[0] = -1.0;
+	startProducers(queue, args, threads, &start);
+	// First half: the tick advances once nothing pending is due, so commands are late only if their
+	// producer fell behind the others. Second half: it overtakes the producers, commands are late.
+	while (applied < total) {
+		n = quickDAQqueueApply(queue, tick);
+		applied += n;
+		for (p = 0; p < TEST_PRODUCERS; p++) {
+			if (ports[p] < lastPorts[p])
+				isMonotonic = false;
+			lastPorts[p] = ports[p];
+		}
+		if (applied >= total / 2)
+			tick += 8;
+		else if (n == 0 && queue->pendingCnt > 0)
+			tick++;
+	}
+	for (p = 0; p < TEST_PRODUCERS; p++) {
+		qdThreadJoin(threads[p]);
+		rejected += args[p].rejected;
+	}
+	QD_CHECK(isMonotonic);
+	QD_CHECK(applied == total);
+	QD_CHECK(quickDAQqueueApply(queue, tick + TEST_TICKS) == 0);
+	QD_CHECK(queue->appliedCnt == total && queue->pendingCnt == 0);
+	for (p = 0; p < TEST_PRODUCERS; p++)
+		QD_CHECK(ports[p] == TEST_COMMANDS);
+	QD_CHECK(queue->lateCnt > 0 && queue->lateCnt < total);
+	fprintf(stderr, "  %llu pushes refused while full, %llu commands late\n", (unsigned long long)rejected,
+		(unsigned long long)queue->lateCnt);
+	quickDAQqueueDestroy(queue);
+}
+
+// A full queue refuses pushes until the consumer drains it; reset empties it
+static void testFullAndReset()
+{
+	quickDAQcommandQueue	*queue = quickDAQqueueCreate(5);
+	quickDAQcommand			cmd;
+	unsigned				k;
+
+	QD_REQUIRE(queue != NULL);
+	QD_CHECK(queue->capacity == 8);
+	memset(&cmd, 0, sizeof(cmd));
+	memset(ports, 0, sizeof(ports));
+	cmd.frame = &portFrame;
+	cmd.isDigital = true;
+	cmd.tick = 3;
+	for (k = 0; k < 8; k++) {
+		cmd.value.digital = k;
+		QD_CHECK(quickDAQqueuePush(queue, &cmd));
+	}
+	QD_CHECK(!quickDAQqueuePush(queue, &cmd));
+	// Drained into the heap but not due: the slots are free again
+	QD_CHECK(quickDAQqueueApply(queue, 2) == 0);
+	QD_CHECK(queue->pendingCnt == 8);
+	QD_CHECK(quickDAQqueuePush(queue, &cmd));
+	QD_CHECK(quickDAQqueueApply(queue, 3) == 8);
+	QD_CHECK(ports[0] == 7);
+
+	quickDAQqueueReset(queue);
+	QD_CHECK(queue->pendingCnt == 0 && queue->appliedCnt == 0 && qdAtomicLoad(&queue->nextTick) == 0);
+	QD_CHECK(quickDAQqueueApply(queue, 100) == 0);
+	quickDAQqueueDestroy(queue);
+}
+
+int main()
+{
+	testOrderAfterConcurrentPush();
+	testOrderWhileConsuming();
+	testFullAndReset();
+	return QD_TEST_RESULT();
+}
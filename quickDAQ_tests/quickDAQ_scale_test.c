@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <quickDAQ_scale.h>
+#include "quickDAQ_tests.h"
+
+//------------------------------------------
+// Raw analog scaling kernels
+//------------------------------------------
+// quickDAQscaleI16() runs its AVX2 or NEON kernel on the first multiples of 4 channels of a scan
+// and the scalar polynomial on the rest. Every channel count from 1 to 9 covers the vector kernel
+// alone, the scalar tail alone and both, over several scans and from unaligned buffers. The
+// kernels may fuse multiply-adds, so values are compared to the polynomial within a few rounding
+// errors of its terms.
+
+#define TEST_MAX_CHANNELS	9
+#define TEST_SCANS			7
+#define TEST_VALUES			(TEST_MAX_CHANNELS * TEST_SCANS)
+#define TEST_SENTINEL		-12345.0
+
+static uint64_t nextRandom(uint64_t* state)
+{
+	// xorshift64*
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 2685821657736338717ULL;
+}
+
+// Cubic per channel, each channel with its own coefficients so that swapped lanes show
+static void makeCoeffs(unsigned chanCount, double* coeffs)
+{
+	unsigned ch;
+
+	for (ch = 0; ch < chanCount; ch++) {
+		coeffs[ch] = -10.0 + 0.5 * ch;
+		coeffs[chanCount + ch] = 3.0e-4 * (ch + 1);
+		coeffs[2 * chanCount + ch] = -1.0e-9 * (ch + 2);
+		coeffs[3 * chanCount + ch] = 2.0e-14 * (ch + 3);
+	}
+}
+
+// Full scale, zero and random counts
+static void makeRaw(unsigned count, int16_t* raw, uint64_t* state)
+{
+	unsigned k;
+
+	for (k = 0; k < count; k++)
+		raw[k] = (int16_t)(nextRandom(state) >> 48);
+	raw[0] = INT16_MIN;
+	if (count > 1)
+		raw[count - 1] = INT16_MAX;
+	if (count > 2)
+		raw[count / 2] = 0;
+}
+
+static void checkChannels(unsigned chanCount, uint64_t* state)
+{
+	// One element of slack in front of each buffer, so the kernels also see unaligned ones
+	int16_t			rawBuffer[TEST_VALUES + 1];
+	double			outputBuffer[TEST_VALUES + 2], coeffs[QUICKDAQ_SCALE_COEFFS * TEST_MAX_CHANNELS];
+	int16_t			*raw = rawBuffer + 1;
+	double			*output = outputBuffer + 1;
+	const unsigned	count = chanCount * TEST_SCANS;
+	double			x, c0, c1, c2, c3, expected, tolerance;
+	unsigned		k, ch;
+
+	makeCoeffs(chanCount, coeffs);
+	makeRaw(count, raw, state);
+	for (k = 0; k < TEST_VALUES + 2; k++)
+		outputBuffer[k] = TEST_SENTINEL;
+	quickDAQscaleI16(raw, chanCount, TEST_SCANS, coeffs, output);
+
+	for (k = 0; k < count; k++) {
+		ch = k % chanCount;
+		x = (double)raw[k];
+		c0 = coeffs[ch];
+		c1 = coeffs[chanCount + ch];
+		c2 = coeffs[2 * chanCount + ch];
+		c3 = coeffs[3 * chanCount + ch];
+		expected = c0 + x * (c1 + x * (c2 + x * c3));
+		tolerance = 8.0 * 2.220446049250313e-16 * (fabs(c0) + fabs(c1 * x) + fabs(c2 * x * x) + fabs(c3 * x * x * x));
+		if (!(fabs(output[k] - expected) <= tolerance)) {
+			fprintf(stderr, "  %u channels, scan %u, channel %u: raw %d, expected %.17g, got %.17g\n",
+				chanCount, k / chanCount, ch, raw[k], expected, output[k]);
+			qdTestFailures++;
+		}
+	}
+	// Nothing written outside the frames
+	QD_CHECK(outputBuffer[0] == TEST_SENTINEL);
+	QD_CHECK(output[count] == TEST_SENTINEL);
+}
+
+int main()
+{
+	uint64_t	state = 0x9E3779B97F4A7C15ULL;
+	unsigned	chanCount;
+
+	fprintf(stderr, "AVX2 kernel: %s\n", quickDAQscaleHasAVX2() ? "yes" : "no");
+	for (chanCount = 1; chanCount <= TEST_MAX_CHANNELS; chanCount++)
+		checkChannels(chanCount, &state);
+	return QD_TEST_RESULT();
+}
@@ -0,0 +1,348 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <quickDAQ_tdms.h>
+#include "quickDAQ_tests.h"
+
+//------------------------------------------
+// TDMS encoder round trip
+//------------------------------------------
+// Writes three chunks (full, full, partial) and parses the file back with the reader below, which
+// follows the TDMS 2.0 file format description and shares no code with the encoder.
+
+#define TEST_COLUMNS	4
+#define TEST_ROWS		8
+#define TEST_RATE		1000.0
+#define TEST_START		1700000000ULL
+#define TEST_MAX_OBJ	16
+
+static const char* expectedPaths[] = { "/", "/'quickDAQ'", "/'quickDAQ'/'cycle'", "/'PXI1Slot2'", "/'PXI1Slot2'/'ai0'",
+	"/'PXI1Slot2'/'ai1'", "/'PXI1Slot3'", "/'PXI1Slot3'/'ao0'" };
+static const double testScale[QUICKDAQ_SCALE_COEFFS] = { 0.5, 0.001, 1e-7, 2e-12 };
+
+// Values logged for one cycle, by column
+static int16_t ai0Of(uint64_t cycle) { return (int16_t)(100 * (int)cycle - 3000); }
+static double ai1Of(uint64_t cycle) { return 0.25 * (double)cycle; }
+static double ao0Of(uint64_t cycle) { return -(double)cycle; }
+
+static void buildColumns(quickDAQlogColumn* cols, size_t* offsets)
+{
+	size_t		dataBytes = 0;
+	unsigned	k;
+
+	memset(cols, 0, TEST_COLUMNS * sizeof(quickDAQlogColumn));
+	snprintf(cols[0].name, QUICKDAQ_LOG_NAME_LEN, "cycle");
+	cols[0].valueSize = sizeof(uint64_t);
+	snprintf(cols[1].name, QUICKDAQ_LOG_NAME_LEN, "PXI1Slot2/ai0");
+	cols[1].valueSize = sizeof(int16_t);
+	memcpy(cols[1].scale, testScale, sizeof(testScale));
+	snprintf(cols[2].name, QUICKDAQ_LOG_NAME_LEN, "PXI1Slot2/ai1");
+	cols[2].valueSize = sizeof(double);
+	snprintf(cols[3].name, QUICKDAQ_LOG_NAME_LEN, "PXI1Slot3/ao0");
+	cols[3].valueSize = sizeof(double);
+	for (k = 0; k < TEST_COLUMNS; k++) {
+		offsets[k] = dataBytes;
+		dataBytes += (size_t)cols[k].valueSize * TEST_ROWS;
+	}
+}
+
+// Fills a chunk laid out as the data logger does: header area, then one array per column
+static void fillChunk(char* chunk, const size_t* offsets, uint64_t chunkNum, unsigned rows, uint64_t firstCycle)
+{
+	quickDAQlogChunk	*info = (quickDAQlogChunk*)chunk;
+	char				*data = chunk + QUICKDAQ_LOG_CHUNK_HEAD;
+	unsigned			r;
+
+	memset(chunk, 0, QUICKDAQ_LOG_CHUNK_HEAD);
+	info->chunkNum = chunkNum;
+	info->rowCount = rows;
+	for (r = 0; r < rows; r++) {
+		((uint64_t*)(data + offsets[0]))[r] = firstCycle + r;
+		((int16_t*)(data + offsets[1]))[r] = ai0Of(firstCycle + r);
+		((double*)(data + offsets[2]))[r] = ai1Of(firstCycle + r);
+		((double*)(data + offsets[3]))[r] = ao0Of(firstCycle + r);
+	}
+}
+
+//------------------------------------------
+// Independent TDMS reader
+//------------------------------------------
+typedef struct _tdmsObject {
+	char		path[64];
+	uint32_t	dataType;		// 0 for objects without raw data
+	uint64_t	valueCount;
+} tdmsObject;
+
+typedef struct _tdmsReader {
+	const unsigned char	*data;
+	size_t				size;
+	size_t				pos;
+	int					isBad;
+	// Object list of the current segment
+	tdmsObject			objects[TEST_MAX_OBJ];
+	unsigned			objectCount;
+	// Properties of the first segment
+	double				increment;
+	uint64_t			startSeconds;
+	uint64_t			startFraction;
+	double				scale[QUICKDAQ_SCALE_COEFFS];
+	uint32_t			scaleInputSource;
+	unsigned			scaledChannels;
+} tdmsReader;
+
+static void readBytes(tdmsReader* rd, void* out, size_t size)
+{
+	if (rd->pos + size > rd->size) {
+		rd->isBad = 1;
+		memset(out, 0, size);
+		return;
+	}
+	memcpy(out, rd->data + rd->pos, size);
+	rd->pos += size;
+}
+
+static uint32_t readU32(tdmsReader* rd) { uint32_t v; readBytes(rd, &v, sizeof(v)); return v; }
+static uint64_t readU64(tdmsReader* rd) { uint64_t v; readBytes(rd, &v, sizeof(v)); return v; }
+static double readF64(tdmsReader* rd) { double v; readBytes(rd, &v, sizeof(v)); return v; }
+
+static void readString(tdmsReader* rd, char* out, size_t outSize)
+{
+	uint32_t len = readU32(rd);
+
+	if (len >= outSize || rd->pos + len > rd->size) {
+		rd->isBad = 1;
+		out[0] = '\0';
+		return;
+	}
+	memcpy(out, rd->data + rd->pos, len);
+	out[len] = '\0';
+	rd->pos += len;
+}
+
+static void readProperty(tdmsReader* rd, const char* path)
+{
+	char		name[64], str[64];
+	uint32_t	type = 0;
+	unsigned	c;
+
+	readString(rd, name, sizeof(name));
+	type = readU32(rd);
+	switch (type) {
+	case TDMS_TYPE_STRING:
+		readString(rd, str, sizeof(str));
+		break;
+	case TDMS_TYPE_U32:
+		if (strcmp(name, "NI_Scale[0]_Polynomial_Input_Source") == 0)
+			rd->scaleInputSource = readU32(rd);
+		else
+			readU32(rd);
+		break;
+	case TDMS_TYPE_DOUBLE:
+		if (strcmp(name, "wf_increment") == 0)
+			rd->increment = readF64(rd);
+		else if (strcmp(path, "/'PXI1Slot2'/'ai0'") == 0 && sscanf(name, "NI_Scale[0]_Polynomial_Coefficients[%u]", &c) == 1
+			&& c < QUICKDAQ_SCALE_COEFFS)
+			rd->scale[c] = readF64(rd);
+		else
+			readF64(rd);
+		break;
+	case TDMS_TYPE_TIMESTAMP:
+		rd->startFraction = readU64(rd);
+		rd->startSeconds = readU64(rd);
+		break;
+	default:
+		rd->isBad = 1;
+	}
+	if (strcmp(name, "NI_Scaling_Status") == 0)
+		rd->scaledChannels++;
+}
+
+static void readMetadata(tdmsReader* rd)
+{
+	tdmsObject	*obj = NULL;
+	uint32_t	rawIndex = 0, propCount = 0, dim = 0, k, p;
+
+	rd->objectCount = readU32(rd);
+	if (rd->objectCount > TEST_MAX_OBJ) {
+		rd->isBad = 1;
+		return;
+	}
+	for (k = 0; k < rd->objectCount && !rd->isBad; k++) {
+		obj = &(rd->objects[k]);
+		readString(rd, obj->path, sizeof(obj->path));
+		rawIndex = readU32(rd);
+		obj->dataType = 0;
+		obj->valueCount = 0;
+		if (rawIndex == 20) {
+			obj->dataType = readU32(rd);
+			dim = readU32(rd);
+			obj->valueCount = readU64(rd);
+			if (dim != 1)
+				rd->isBad = 1;
+		}
+		else if (rawIndex != TDMS_NO_RAW_DATA)
+			rd->isBad = 1;
+		propCount = readU32(rd);
+		for (p = 0; p < propCount && !rd->isBad; p++)
+			readProperty(rd, obj->path);
+	}
+}
+
+static size_t typeSize(uint32_t dataType)
+{
+	return (dataType == TDMS_TYPE_I16) ? 2 : 8;
+}
+
+// Checks the raw data of a segment against the values logged from 'firstCycle' on
+static void checkRawData(tdmsReader* rd, size_t rawLen, uint64_t firstCycle)
+{
+	const unsigned char	*raw = rd->data + rd->pos;
+	const tdmsObject	*obj = NULL;
+	size_t				expectedLen = 0;
+	uint64_t			r, cycle, u64;
+	int16_t				i16;
+	double				f64;
+	unsigned			k;
+
+	for (k = 0; k < rd->objectCount; k++)
+		expectedLen += typeSize(rd->objects[k].dataType) * rd->objects[k].valueCount * (rd->objects[k].dataType != 0);
+	QD_CHECK(expectedLen == rawLen);
+	if (expectedLen != rawLen || rd->pos + rawLen > rd->size)
+		return;
+
+	for (k = 0; k < rd->objectCount; k++) {
+		obj = &(rd->objects[k]);
+		if (obj->dataType == 0)
+			continue;
+		for (r = 0; r < obj->valueCount; r++, raw += typeSize(obj->dataType)) {
+			cycle = firstCycle + r;
+			if (strcmp(obj->path, "/'quickDAQ'/'cycle'") == 0) {
+				memcpy(&u64, raw, sizeof(u64));
+				QD_CHECK(obj->dataType == TDMS_TYPE_U64 && u64 == cycle);
+			}
+			else if (strcmp(obj->path, "/'PXI1Slot2'/'ai0'") == 0) {
+				memcpy(&i16, raw, sizeof(i16));
+				QD_CHECK(obj->dataType == TDMS_TYPE_I16 && i16 == ai0Of(cycle));
+			}
+			else {
+				memcpy(&f64, raw, sizeof(f64));
+				QD_CHECK(obj->dataType == TDMS_TYPE_DOUBLE);
+				QD_CHECK(f64 == ((strcmp(obj->path, "/'PXI1Slot2'/'ai1'") == 0) ? ai1Of(cycle) : ao0Of(cycle)));
+			}
+		}
+	}
+	rd->pos += rawLen;
+}
+
+static void testRoundTrip()
+{
+	static const uint32_t	fullToc = TDMS_TOC_METADATA | TDMS_TOC_NEW_OBJ_LIST | TDMS_TOC_RAW_DATA;
+	static const uint32_t	expectedToc[3] = { TDMS_TOC_METADATA | TDMS_TOC_NEW_OBJ_LIST | TDMS_TOC_RAW_DATA,
+		TDMS_TOC_RAW_DATA, TDMS_TOC_METADATA | TDMS_TOC_NEW_OBJ_LIST | TDMS_TOC_RAW_DATA };
+	static const unsigned	segmentRows[3] = { TEST_ROWS, TEST_ROWS, 3 };
+	quickDAQlogColumn		cols[TEST_COLUMNS];
+	size_t					offsets[TEST_COLUMNS], fileSize = 0, metaStart = 0;
+	uint64_t				chunkMem[(QUICKDAQ_LOG_CHUNK_HEAD + TEST_COLUMNS * 8 * TEST_ROWS) / 8];
+	unsigned char			*fileData = NULL;
+	tdmsWriter				tdms;
+	tdmsReader				rd;
+	FILE					*file = tmpfile();
+	uint64_t				cycle = 0, nextSegment = 0, metaLen = 0;
+	uint32_t				toc = 0, version = 0;
+	unsigned				seg, k;
+	char					tag[4];
+
+	QD_REQUIRE(file != NULL);
+	buildColumns(cols, offsets);
+	QD_REQUIRE(initTdmsWriter(&tdms, file, cols, TEST_COLUMNS, TEST_ROWS, TEST_START, TEST_RATE));
+	for (seg = 0; seg < 3; seg++) {
+		fillChunk((char*)chunkMem, offsets, seg, segmentRows[seg], cycle);
+		QD_CHECK(tdmsWriteChunk(&tdms, (char*)chunkMem, TEST_ROWS, offsets));
+		cycle += segmentRows[seg];
+	}
+	freeTdmsWriter(&tdms);
+
+	fflush(file);
+	fseek(file, 0, SEEK_END);
+	fileSize = (size_t)ftell(file);
+	rewind(file);
+	fileData = (unsigned char*)malloc(fileSize);
+	QD_REQUIRE(fileData != NULL);
+	QD_REQUIRE(fread(fileData, 1, fileSize, file) == fileSize);
+	fclose(file);
+
+	memset(&rd, 0, sizeof(rd));
+	rd.data = fileData;
+	rd.size = fileSize;
+	for (seg = 0, cycle = 0; seg < 3 && !rd.isBad; cycle += segmentRows[seg], seg++) {
+		// Lead-in
+		readBytes(&rd, tag, sizeof(tag));
+		toc = readU32(&rd);
+		version = readU32(&rd);
+		nextSegment = readU64(&rd);
+		metaLen = readU64(&rd);
+		metaStart = rd.pos;
+		QD_CHECK(memcmp(tag, "TDSm", 4) == 0);
+		QD_CHECK(toc == expectedToc[seg]);
+		QD_CHECK(version == TDMS_VERSION);
+		QD_CHECK(metaStart + nextSegment <= fileSize);
+		if (toc == fullToc) {
+			readMetadata(&rd);
+			QD_CHECK(rd.pos - metaStart == metaLen);
+			QD_CHECK(rd.objectCount == sizeof(expectedPaths) / sizeof(expectedPaths[0]));
+			for (k = 0; k < rd.objectCount && k < sizeof(expectedPaths) / sizeof(expectedPaths[0]); k++) {
+				QD_CHECK(strcmp(rd.objects[k].path, expectedPaths[k]) == 0);
+				QD_CHECK(rd.objects[k].dataType == 0 || rd.objects[k].valueCount == segmentRows[seg]);
+			}
+		}
+		else
+			QD_CHECK(metaLen == 0);
+		// Raw data: right after the metadata, up to the next segment
+		rd.pos = metaStart + (size_t)metaLen;
+		checkRawData(&rd, (size_t)(nextSegment - metaLen), cycle);
+		QD_CHECK(rd.pos == metaStart + nextSegment);
+
+		if (seg == 0) {
+			// Waveform and scaling properties come with the first segment only
+			QD_CHECK(rd.increment == 1.0 / TEST_RATE);
+			QD_CHECK(rd.startSeconds == TEST_START + TDMS_EPOCH_OFFSET && rd.startFraction == 0);
+			QD_CHECK(memcmp(rd.scale, testScale, sizeof(testScale)) == 0);
+			QD_CHECK(rd.scaleInputSource == 0xFFFFFFFF);
+			QD_CHECK(rd.scaledChannels == 1);
+			rd.increment = 0;
+			rd.scaledChannels = 0;
+		}
+		else {
+			QD_CHECK(rd.increment == 0);
+			QD_CHECK(rd.scaledChannels == 0);
+		}
+	}
+	QD_CHECK(!rd.isBad);
+	QD_CHECK(rd.pos == fileSize);
+	free(fileData);
+}
+
+// The metadata length computed without a buffer matches the one written
+static void testMetadataLength()
+{
+	quickDAQlogColumn	cols[TEST_COLUMNS];
+	size_t				offsets[TEST_COLUMNS], len = 0;
+	tdmsWriter			tdms;
+
+	buildColumns(cols, offsets);
+	QD_REQUIRE(initTdmsWriter(&tdms, NULL, cols, TEST_COLUMNS, TEST_ROWS, TEST_START, 0.0));
+	len = tdmsMetadata(tdms.meta + TDMS_LEAD_IN_LEN, &tdms, TEST_ROWS, true);
+	QD_CHECK(len == tdms.metaCap - TDMS_LEAD_IN_LEN);
+	QD_CHECK(tdmsMetadata(NULL, &tdms, TEST_ROWS, false) < len);
+	// No sampling rate: one row per second
+	QD_CHECK(tdms.increment == 1.0);
+	freeTdmsWriter(&tdms);
+}
+
+int main()
+{
+	testRoundTrip();
+	testMetadataLength();
+	return QD_TEST_RESULT();
+}
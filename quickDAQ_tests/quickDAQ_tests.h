@@ -0,0 +1,34 @@
+#pragma once
+#ifndef QUICKDAQ_TESTS_H
+#define QUICKDAQ_TESTS_H
+
+/* Minimal test harness of the portable unit tests: QD_CHECK reports a failed condition and
+* counts it, QD_TEST_RESULT ends main() with the exit status ctest expects.
+*/
+
+#include <stdio.h>
+
+static int qdTestFailures = 0;
+
+#define QD_CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			qdTestFailures++; \
+		} \
+	} while (0)
+
+// Stops the current test function on failure, for checks later ones depend on
+#define QD_REQUIRE(cond) \
+	do { \
+		if (!(cond)) { \
+			fprintf(stderr, "%s:%d: requirement failed: %s\n", __FILE__, __LINE__, #cond); \
+			qdTestFailures++; \
+			return; \
+		} \
+	} while (0)
+
+#define QD_TEST_RESULT() \
+	(fprintf(stderr, "%s: %d failure(s)\n", __FILE__, qdTestFailures), (qdTestFailures == 0) ? 0 : 1)
+
+#endif /* quickDAQ_tests.h */
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <quickDAQ_workers.h>
+#include "quickDAQ_tests.h"
+
+//------------------------------------------
+// Worker pool runs, parking and wake-up
+//------------------------------------------
+// Every job of a run executes exactly once, whatever the job count. Workers idle for longer than
+// QUICKDAQ_WORKER_SPIN_NS park, and the next run wakes them well before their park times out.
+
+#define TEST_WORKERS	3
+#define TEST_MAX_JOBS	100
+
+static volatile uint64_t	jobRuns[TEST_MAX_JOBS];
+static volatile uint64_t	initCalls = 0;
+
+static void countJob(unsigned jobNum, void* jobArg)
+{
+	(void)jobArg;
+	qdAtomicFetchAdd(&jobRuns[jobNum], 1);
+}
+
+static void countInit(void* initArg)
+{
+	qdAtomicFetchAdd((volatile uint64_t*)initArg, 1);
+}
+
+static void checkRun(quickDAQworkerPool* pool, unsigned jobCount)
+{
+	unsigned jobNum;
+
+	memset((void*)jobRuns, 0, sizeof(jobRuns));
+	quickDAQpoolRun(pool, jobCount, countJob, NULL);
+	for (jobNum = 0; jobNum < TEST_MAX_JOBS; jobNum++)
+		QD_CHECK(jobRuns[jobNum] == ((jobNum < jobCount) ? 1u : 0u));
+}
+
+static bool allParked(quickDAQworkerPool* pool)
+{
+	unsigned workerNum;
+
+	for (workerNum = 0; workerNum < pool->workerCount; workerNum++) {
+		if (!qdAtomicLoad(&pool->workers[workerNum].isParked))
+			return false;
+	}
+	return true;
+}
+
+static void testRuns()
+{
+	static const unsigned	jobCounts[] = { 0, 1, 2, TEST_WORKERS + 1, 9, TEST_MAX_JOBS };
+	quickDAQworkerPool		*pool = quickDAQpoolCreateEx(TEST_WORKERS, NULL, countInit, (void*)&initCalls);
+	unsigned				k, round;
+
+	QD_REQUIRE(pool != NULL);
+	QD_CHECK(pool->workerCount == TEST_WORKERS);
+	for (round = 0; round < 10; round++) {
+		for (k = 0; k < sizeof(jobCounts) / sizeof(jobCounts[0]); k++)
+			checkRun(pool, jobCounts[k]);
+	}
+	quickDAQpoolDestroy(pool);
+	QD_CHECK(initCalls == TEST_WORKERS);
+}
+
+static void testParking()
+{
+	quickDAQworkerPool	*pool = quickDAQpoolCreateEx(TEST_WORKERS, NULL, NULL, NULL);
+	uint64_t			start;
+	unsigned			waitedMs;
+
+	QD_REQUIRE(pool != NULL);
+	checkRun(pool, TEST_MAX_JOBS);
+	// Idle workers park once their spin budget is spent
+	for (waitedMs = 0; waitedMs < 2000 && !allParked(pool); waitedMs++)
+		qdSleepMs(1);
+	QD_CHECK(allParked(pool));
+
+	// A run wakes them instead of waiting for the park to time out
+	start = qdMonotonicNs();
+	checkRun(pool, TEST_MAX_JOBS);
+	QD_CHECK(qdMonotonicNs() - start < QUICKDAQ_WORKER_PARK_MS * 1000000ULL / 2);
+
+	// Destroying a parked pool returns
+	for (waitedMs = 0; waitedMs < 2000 && !allParked(pool); waitedMs++)
+		qdSleepMs(1);
+	quickDAQpoolDestroy(pool);
+}
+
+int main()
+{
+	testRuns();
+	testParking();
+	return QD_TEST_RESULT();
+}
@@ -3,7 +3,7 @@
 #include <cLinkedList.h>
 #include <NIDAQmx.h>
 #include <ansi_c.h>
-#include <quickDAQ.h>
+#include "quickDAQ_internal.h"
 #include <macrodef.h>
 #include <string.h>
 #include <stdlib.h>
@@ -16,14 +16,46 @@ extern "C" {
 //------------------------------
 // QuickDAQmx Glabal Definitions
 //------------------------------
-quickDAQErrorCodes			quickDAQErrorCode	= 0;
-int32						NIDAQmxErrorCode	= 0;
-quickDAQStatusModes			quickDAQStatus		= STATUS_NASCENT;
-bool32						lateSampleWarning	= 0;
+// Initial state of a session: default sampling settings, everything else empty
+#define QUICKDAQ_SESSION_DEFAULTS {																	\
+	.info = {																						\
+		.errorCode			= 0,																	\
+		.NIerrorCode		= 0,																	\
+		.status				= STATUS_NASCENT,														\
+		.sampleLate			= 0,																	\
+		.devPrefix			= DAQMX_DEF_DEV_PREFIX,													\
+		.devEnumerated		= 0,																	\
+		.triggerEdge		= DAQmx_Val_Rising,						/* DAQmxDefaults.NItriggerEdge */	\
+		.sampleMode			= (samplingModes)DAQmx_Val_HWTimedSinglePoint,	/* DAQmxDefaults.NIsamplingMode */	\
+		.sampleModeString	= "",																	\
+		.samplingRate		= 1000.0,								/* DAQmxDefaults.NIsamplingRate */	\
+		.pointsPerSample	= 1,									/* DAQmxDefaults.NIsamplesPerCh */	\
+		.clockSource		= DAQMX_SAMPLE_CLK_SRC_HW_CLOCKED,										\
+		.clockSourceTask	= INVALID_IO,															\
+		.clockSourceDev		= -1,																	\
+		.clockSourcePin		= -1,																	\
+	},																								\
+	.taskMaster			= -1,																		\
+	.bgReadEnable		= FALSE,																	\
+	.bgBlockScans		= 1000,																		\
+	.bgRingBlocks		= 64,																		\
+	.waitMode			= WAIT_BLOCKING,															\
+	.waitSpinNs			= 100000,																	\
+	.missPolicy			= MISS_IGNORE,																\
+	.missLimit			= 1,																		\
+	.logChunkRows		= 1024,																		\
+	.logChunkCount		= 8,																		\
+	.safeState			= FALSE																		\
+}
+
+quickDAQSession						quickDAQdefaultSession = QUICKDAQ_SESSION_DEFAULTS;
+QD_THREAD_LOCAL quickDAQSession		*quickDAQactiveSession = &quickDAQdefaultSession;
+
+// Per-session scratch arrays of the grouped counter reads and of the parallel cycle phases
+#define CIreadErrors		(quickDAQactiveSession->ctrReadErrors)
+#define cycleStepErrors		(quickDAQactiveSession->ioStepErrors)
 
 // NI-DAQmx specific declarations
-char						DAQmxDevPrefix[DAQMX_MAX_DEV_STR_LEN] = DAQMX_DEF_DEV_PREFIX;
-unsigned int				DAQmxEnumerated = 0;
 long						DAQmxErrorCode = 0;
 
 const NIdefaults			DAQmxDefaults = {
@@ -82,29 +114,82 @@ const NIdefaults			DAQmxDefaults = {
 	.plsHiTick			= 1
 };
 
-deviceInfo					*DAQmxDevList = NULL;
-unsigned int				DAQmxDevCount = 0;
-unsigned int				DAQmxMaxCount = 0;
-int32						DAQmxTriggerEdge					= DAQmx_Val_Rising; // DAQmxDefaults.NItriggerEdge;
-samplingModes				DAQmxSampleMode						= (samplingModes) DAQmx_Val_HWTimedSinglePoint;// DAQmxDefaults.NIsamplingMode;
-char						DAQmxSampleModeString[20]			= "";
-float64						DAQmxSamplingRate					= 1000.0;// DAQmxDefaults.NIsamplingRate;
-uInt64						DAQmxNumDataPointsPerSample			= 1;// DAQmxDefaults.NIsamplesPerCh;
-char						DAQmxClockSource[DAQMX_MAX_STR_LEN] = /*DAQMX_SAMPLE_CLK_SRC_FINITE;*/DAQMX_SAMPLE_CLK_SRC_HW_CLOCKED;//((DAQmxSampleMode == DAQmx_Val_HWTimedSinglePoint) ? DAQMX_SAMPLE_CLK_SRC_HW_CLOCKED : DAQMX_SAMPLE_CLK_SRC_FINITE);
-IOmodes						DAQmxClockSourceTask = INVALID_IO;
-int							DAQmxClockSourceDev = -1, DAQmxClockSourcePin = -1;
-
-// NI-DAQmx subsystem tasks
-cLinkedList *NItaskList = NULL;
-// TaskHandle *AItaskHandle = NULL, *AOtaskHandle = NULL, *DItaskHandle = NULL, *DOtaskHandle = NULL;
-cLinkedList *CItaskList = NULL, * COtaskList = NULL;
-// unsigned	AIpinCount = 0, AOpinCount = 0, DIpinCount = 0, DOpinCount = 0, CIpinCount = 0, COpinCount = 0;
-
-NItask *AItask = NULL, *AOtask = NULL, *DItask = NULL, *DOtask = NULL;
 
 //-------------------------------
 // quickDAQ Function Definitions
 //-------------------------------
+// session functions
+/*!
+ * \fn quickDAQSession* quickDAQnewSession()
+ * Creates a session with the default settings and no devices. Bind it to a thread with
+ * quickDAQsetSession() and configure it as usual (quickDAQinit(), pinMode(), ...). Sessions
+ * must use disjoint devices; each one may be driven by its own thread.
+ *
+ * \return Returns the new session, or NULL if out of memory.
+ */
+quickDAQSession* quickDAQnewSession()
+{
+	static const quickDAQSession sessionDefaults = QUICKDAQ_SESSION_DEFAULTS;
+	quickDAQSession* session = (quickDAQSession*)qdAlignedAlloc(QD_CACHELINE, sizeof(quickDAQSession));
+
+	if (session == NULL)
+		return NULL;
+	memcpy(session, &sessionDefaults, sizeof(quickDAQSession));
+	return session;
+}
+
+/*!
+ * \fn void quickDAQfreeSession(quickDAQSession* session)
+ * Stops and terminates the session if needed, then frees it. Threads still bound to it must
+ * not call quickDAQ functions afterwards. The default session cannot be freed.
+ */
+void quickDAQfreeSession(quickDAQSession* session)
+{
+	quickDAQSession* caller = quickDAQactiveSession;
+
+	if (session == NULL || session == &quickDAQdefaultSession)
+		return;
+
+	quickDAQactiveSession = session;
+	if (quickDAQStatus == STATUS_RUNNING)
+		quickDAQstop();
+	if (DAQmxDevList != NULL)
+		quickDAQTerminate();
+	quickDAQactiveSession = (caller == session) ? &quickDAQdefaultSession : caller;
+	qdAlignedFree(session);
+}
+
+/*!
+ * \fn void quickDAQsetSession(quickDAQSession* session)
+ * Binds 'session' to the calling thread: all quickDAQ calls from this thread use it from now on.
+ * Pass NULL to go back to the default session.
+ */
+void quickDAQsetSession(quickDAQSession* session)
+{
+	quickDAQactiveSession = (session != NULL) ? session : &quickDAQdefaultSession;
+}
+
+/*inline*/ quickDAQSession* quickDAQgetSession()
+{
+	return quickDAQactiveSession;
+}
+
+// Worker pool thread start: bind the worker to the session that created the pool
+static void bindWorkerSession(void* session)
+{
+	quickDAQsetSession((quickDAQSession*)session);
+}
+
+/*!
+ * \fn quickDAQworkerPool* quickDAQpoolCreate(unsigned workerCount, const int* cpuList)
+ * Creates a worker pool (see quickDAQpoolCreateEx) whose workers run in the calling thread's
+ * session.
+ */
+quickDAQworkerPool* quickDAQpoolCreate(unsigned workerCount, const int* cpuList)
+{
+	return quickDAQpoolCreateEx(workerCount, cpuList, bindWorkerSession, quickDAQactiveSession);
+}
+
 // support functions
 void DAQmxErrChk(int32 errCode)
 {
@@ -163,6 +248,9 @@ char* pin2string(char* strbuf, unsigned int devNum, IOmodes ioMode, unsigned int
 {
 	switch (newError)
 	{
+	case ERROR_REPLAYEND:
+		if (printFlag != 0) fprintf(ERRSTREAM, "QuickDAQ library: ERROR %d: The replay source has no more recorded samples.\n", (int)newError);
+		break;
 	case ERROR_NOTREADY: 
 		if (printFlag != 0) fprintf(ERRSTREAM, "QuickDAQ library: ERROR %d: Library is not ready to run. Configure library, sample clock and pin mode first!\n", (int)newError);
 		break;
@@ -239,6 +327,21 @@ int quickDAQgetStatus()
 	return (int)quickDAQStatus;
 }
 
+/*inline*/ void swapTaskBuffers(NItask* task)
+{
+	void* frontBuffer = task->backBuffer;
+	task->backBuffer = task->dataBuffer;
+	task->dataBuffer = frontBuffer;
+	if (task->published != NULL)
+		publishFrame(task);
+}
+
+// Size of one channel's sample in the task buffers
+/*inline*/ size_t taskSampleSize(NItask* task)
+{
+	return (task->taskType == ANALOG_IN || task->taskType == ANALOG_OUT || task->taskType == CTR_ANGLE_IN) ? sizeof(float64) : sizeof(uInt32);
+}
+
 long quickDAQGetSamplingMode(char* sampleModeString)
 {
 	switch (DAQmxSampleMode)
@@ -581,15 +684,22 @@ void initDevTaskFlags()
 		if ((DAQmxDevList[i]).isDevValid == TRUE) {
 			// AI task
 			(DAQmxDevList[i]).AItask = NULL;
+			(DAQmxDevList[i]).AIchanCnt = 0;
+			(DAQmxDevList[i]).AIchanIdx = NULL;
+			(DAQmxDevList[i]).AIframeSeq = 0;
 			
 			// AO task
 			(DAQmxDevList[i]).AOtask = NULL;
+			(DAQmxDevList[i]).AOchanCnt = 0;
+			(DAQmxDevList[i]).AOchanIdx = NULL;
 						
 			// DI task
 			(DAQmxDevList[i]).DItask = NULL;
 						
 			// DO task
 			(DAQmxDevList[i]).DOtask = NULL;
+			(DAQmxDevList[i]).DOchanCnt = 0;
+			(DAQmxDevList[i]).DOchanIdx = NULL;
 						
 			// CI tasks
 			(DAQmxDevList[i]).CItask = (NItask**)malloc(((DAQmxDevList[i]).CIcnt) * sizeof(NItask*));
@@ -606,6 +716,132 @@ void initDevTaskFlags()
 	}
 }
 
+/*!
+ * \fn void initTaskTable()
+ * Allocates the contiguous, cache-line aligned NI-DAQmx task table for the enumerated devices.
+ * Slots are grouped by I/O mode in 'IOmodes' order: one shared slot each for AI, AO, DI and DO,
+ * followed by one slot per counter channel of every valid device. Tasks never move once created,
+ * so the task pointers held by devices, pins and channel handles stay valid until termination.
+ */
+void initTaskTable()
+{
+	unsigned int i = 0, slot = 0;
+	unsigned int groupCap[NITASK_GROUP_CNT] = { 1, 1, 1, 1, 0, 0 };
+
+	for (i = 0; i <= DAQmxMaxCount; i++) {
+		if ((DAQmxDevList[i]).isDevValid == TRUE) {
+			groupCap[CTR_ANGLE_IN] += (DAQmxDevList[i]).CIcnt;
+			groupCap[CTR_TICK_OUT] += (DAQmxDevList[i]).COcnt;
+		}
+	}
+
+	for (i = 0; i < NITASK_GROUP_CNT; i++) {
+		NItaskGroups[i].first = slot;
+		NItaskGroups[i].count = 0;
+		NItaskGroups[i].capacity = groupCap[i];
+		slot += groupCap[i];
+	}
+	NItaskCapacity = slot;
+	NItaskCount = 0;
+	NItaskMaster = -1;
+
+	NItaskTable = (NItask*)qdAlignedAlloc(QD_CACHELINE, NItaskCapacity * sizeof(NItask));
+	if (NItaskTable == NULL) {
+		fprintf(ERRSTREAM, "QuickDAQ library: FATAL: Unable to allocate the NI-DAQmx task table.\n");
+		quickDAQSetStatus(STATUS_UNKNOWN, FALSE);
+		quickDAQSetError(ERROR_UNKNOWN, TRUE);
+		exit(quickDAQErrorCode);
+	}
+	memset(NItaskTable, 0, NItaskCapacity * sizeof(NItask));
+}
+
+void freeTaskTable()
+{
+	unsigned int i = 0;
+
+	if (NItaskTable != NULL)
+		qdAlignedFree(NItaskTable);
+	NItaskTable = NULL;
+	NItaskCapacity = 0;
+	NItaskCount = 0;
+	NItaskMaster = -1;
+	for (i = 0; i < NITASK_GROUP_CNT; i++) {
+		NItaskGroups[i].first = 0;
+		NItaskGroups[i].count = 0;
+		NItaskGroups[i].capacity = 0;
+	}
+}
+
+/*!
+ * \fn NItask* newNItask(IOmodes ioMode)
+ * Claims the next free slot of the 'ioMode' group in the task table and creates its NI-DAQmx task.
+ */
+NItask* newNItask(IOmodes ioMode)
+{
+	NItaskGroup* group = &(NItaskGroups[ioMode]);
+	NItask* newTask = NULL;
+
+	if (NItaskTable == NULL || group->count >= group->capacity) {
+		fprintf(ERRSTREAM, "QuickDAQ library: FATAL: NI-DAQmx task table is full for IO mode %d.\n", ioMode);
+		quickDAQTerminate();
+		quickDAQSetStatus(STATUS_SHUTDOWN, TRUE);
+		quickDAQSetError(ERROR_UNKNOWN, TRUE);
+		exit(quickDAQErrorCode);
+	}
+
+	newTask = &(NItaskTable[group->first + group->count]);
+	newTask->taskType = ioMode;
+	newTask->pinCount = 0;
+	newTask->dataBuffer = NULL;
+	newTask->backBuffer = NULL;
+	newTask->frameSeq = 0;
+	newTask->frameStale = FALSE;
+	newTask->ring = NULL;
+	newTask->faultCode = 0;
+	newTask->safeBuffer = NULL;
+	newTask->eventDriven = FALSE;
+	newTask->published = NULL;
+	newTask->rawBuffer = NULL;
+	newTask->scaleCoeffs = NULL;
+	DAQmxErrChk(DAQmxCreateTask("", &(newTask->taskHandler)));
+
+	group->count++;
+	NItaskCount++;
+	return newTask;
+}
+
+/*!
+ * \fn NItask* firstNItask()
+ * Returns the first created task in table order, or NULL if there is none. Use with nextNItask()
+ * to walk all tasks: AI, AO, DI, DO, then the counter tasks.
+ */
+NItask* firstNItask()
+{
+	unsigned int i = 0;
+
+	if (NItaskTable == NULL)
+		return NULL;
+	for (i = 0; i < NITASK_GROUP_CNT; i++) {
+		if (NItaskGroups[i].count > 0)
+			return &(NItaskTable[NItaskGroups[i].first]);
+	}
+	return NULL;
+}
+
+NItask* nextNItask(NItask* task)
+{
+	unsigned int i = (unsigned int)task->taskType;
+	unsigned int slot = (unsigned int)(task - NItaskTable) + 1;
+
+	if (slot < NItaskGroups[i].first + NItaskGroups[i].count)
+		return &(NItaskTable[slot]);
+	for (i++; i < NITASK_GROUP_CNT; i++) {
+		if (NItaskGroups[i].count > 0)
+			return &(NItaskTable[NItaskGroups[i].first]);
+	}
+	return NULL;
+}
+
 void quickDAQinit()
 {
 	char newPrefix[] = DAQMX_DEF_DEV_PREFIX;
@@ -615,9 +851,7 @@ void quickDAQinit()
 	setDAQmxDevPrefix(newPrefix);
 	enumerateNIDevices();
 	initDevTaskFlags();
-
-	NItaskList = (cLinkedList*)malloc(sizeof(cLinkedList));
-	cListInit(NItaskList);
+	initTaskTable();
 	
 	quickDAQSetStatus(STATUS_INIT, TRUE);
 }
@@ -649,17 +883,15 @@ void setSampleClockTiming(samplingModes sampleMode, float64 samplingRate, char *
 		fprintf(ERRSTREAM, "\tClock source is '%s'.\n", DAQmxClockSource);
 
 		NItask* myTask = NULL;
-		cListElem* myElem = NULL;
-		unsigned isFirstTask = 1;
 
-		for (myElem = cListFirstElem(NItaskList); myElem != NULL; myElem = cListNextElem(NItaskList, myElem)) {
-			myTask = (NItask*)myElem->obj;
-			if (myTask != DItask && myTask != DOtask) {
-				if (isFirstTask == 1) {
+		selectClockMaster();
+		for (myTask = firstNItask(); myTask != NULL; myTask = nextNItask(myTask)) {
+			// On-demand tasks keep the default (software) timing; syncSampling() paces them
+			if (myTask != NItaskDI && myTask != NItaskDO && sampleMode != ON_DEMAND) {
+				if ((int)(myTask - NItaskTable) == NItaskMaster) {
 					DAQmxErrChk(DAQmxCfgSampClkTiming(myTask->taskHandler, "", DAQmxSamplingRate,
 						DAQmxTriggerEdge, DAQmxSampleMode, DAQmxNumDataPointsPerSample));
 					fprintf(ERRSTREAM, "First task: ");
-					isFirstTask = 0;
 				}
 				else {
 					DAQmxErrChk(DAQmxCfgSampClkTiming(myTask->taskHandler, DAQmxClockSource, DAQmxSamplingRate,
@@ -671,7 +903,7 @@ void setSampleClockTiming(samplingModes sampleMode, float64 samplingRate, char *
 			fprintf(ERRSTREAM, "Sample clock source and timing have been set.\n\n");
 		}
 
-		if(!cListEmpty(NItaskList))
+		if(NItaskCount > 0)
 			quickDAQSetStatus(STATUS_READY, TRUE);
 
 		if (printFlag) fprintf(ERRSTREAM, "\n");
@@ -679,6 +911,24 @@ void setSampleClockTiming(samplingModes sampleMode, float64 samplingRate, char *
 	}
 }
 
+/*!
+ * \fn void selectClockMaster()
+ * Picks the clock master task: the first hardware-timed (AI, AO or counter) task in table order,
+ * which is the same task setClockSource() derives the shared sample clock from.
+ */
+void selectClockMaster()
+{
+	NItask* myTask = NULL;
+
+	NItaskMaster = -1;
+	for (myTask = firstNItask(); myTask != NULL; myTask = nextNItask(myTask)) {
+		if (myTask != NItaskDI && myTask != NItaskDO) {
+			NItaskMaster = (int)(myTask - NItaskTable);
+			return;
+		}
+	}
+}
+
 bool setClockSource(unsigned devNum, int pinNum, IOmodes ioMode)
 {
 	// setup clock source now
@@ -761,23 +1011,19 @@ void pinMode(unsigned int devNum, IOmodes ioMode, unsigned int pinNum)
 			case ANALOG_IN:
 				if (thisDev->AIcnt != 0 && pinNum >= 0 && pinNum < thisDev->AIcnt) {
 					// I/O Task configuration
-					if (AItask == NULL) {
-						AItask = (NItask*)malloc(sizeof(NItask));
-						AItask->taskType = ANALOG_IN;
-						AItask->pinCount = 0;
-						AItask->dataBuffer = NULL;
-						DAQmxErrChk(DAQmxCreateTask("", &(AItask->taskHandler)));
-						clkSourceTask = AItask;
+					if (NItaskAI == NULL) {
+						NItaskAI = newNItask(ANALOG_IN);
+						clkSourceTask = NItaskAI;
 					}
 							
 					if (thisDev->AIpins[pinNum].isPinValid == FALSE) {
-						AItask->pinCount++;
+						NItaskAI->pinCount++;
 
 						// Device+Pin configuration
-						thisDev->AItask = AItask;
+						thisDev->AItask = NItaskAI;
 						thisDev->AIpins[pinNum].isPinValid = TRUE;
 						thisDev->AIpins[pinNum].pinIOMode = ioMode;
-						thisDev->AIpins[pinNum].pinID = AItask->pinCount - 1;
+						thisDev->AIpins[pinNum].pinID = NItaskAI->pinCount - 1;
 						thisDev->AIpins[pinNum].pinTask = thisDev->AItask;
 
 						// DAQmx configuration
@@ -794,23 +1040,19 @@ void pinMode(unsigned int devNum, IOmodes ioMode, unsigned int pinNum)
 			case ANALOG_OUT:
 				if (thisDev->AOcnt != 0 && pinNum >= 0 && pinNum < thisDev->AOcnt) {
 					// I/O Task configuration
-					if (AOtask == NULL) {
-						AOtask = (NItask*)malloc(sizeof(NItask));
-						AOtask->taskType = ANALOG_OUT;
-						AOtask->pinCount = 0;
-						AOtask->dataBuffer = NULL;
-						DAQmxErrChk(DAQmxCreateTask("", &(AOtask->taskHandler)));
-						clkSourceTask = AOtask;
+					if (NItaskAO == NULL) {
+						NItaskAO = newNItask(ANALOG_OUT);
+						clkSourceTask = NItaskAO;
 					}
 					
 					if (thisDev->AOpins[pinNum].isPinValid == FALSE) {
-						AOtask->pinCount++;
+						NItaskAO->pinCount++;
 
 					// Device+Pin configuration
-						thisDev->AOtask = AOtask;
+						thisDev->AOtask = NItaskAO;
 						thisDev->AOpins[pinNum].isPinValid = TRUE;
 						thisDev->AOpins[pinNum].pinIOMode = ioMode;
-						thisDev->AOpins[pinNum].pinID = AOtask->pinCount - 1;
+						thisDev->AOpins[pinNum].pinID = NItaskAO->pinCount - 1;
 						thisDev->AOpins[pinNum].pinTask = thisDev->AOtask;
 
 					// DAQmx configuration
@@ -831,23 +1073,19 @@ void pinMode(unsigned int devNum, IOmodes ioMode, unsigned int pinNum)
 			case DIGITAL_OUT:
 				if (thisDev->DOcnt != 0 && pinNum >= 0 && pinNum < thisDev->DOcnt) {
 					// I/O Task configuration
-					if (DOtask == NULL) {
-						DOtask = (NItask*)malloc(sizeof(NItask));
-						DOtask->taskType = DIGITAL_OUT;
-						DOtask->pinCount = 0;
-						DOtask->dataBuffer = NULL;
-						DAQmxErrChk(DAQmxCreateTask("", &(DOtask->taskHandler)));
-						clkSourceTask = DOtask;
+					if (NItaskDO == NULL) {
+						NItaskDO = newNItask(DIGITAL_OUT);
+						clkSourceTask = NItaskDO;
 					}
 					
 					if (thisDev->DOpins[pinNum].isPinValid == FALSE) {
-						DOtask->pinCount++;
+						NItaskDO->pinCount++;
 
 					// Device+Pin configuration
-						thisDev->DOtask = DOtask;
+						thisDev->DOtask = NItaskDO;
 						thisDev->DOpins[pinNum].isPinValid = TRUE;
 						thisDev->DOpins[pinNum].pinIOMode = ioMode;
-						thisDev->DOpins[pinNum].pinID = DOtask->pinCount - 1;
+						thisDev->DOpins[pinNum].pinID = NItaskDO->pinCount - 1;
 						thisDev->DOpins[pinNum].pinTask = thisDev->DOtask;
 
 					// DAQmx configuration
@@ -863,17 +1101,8 @@ void pinMode(unsigned int devNum, IOmodes ioMode, unsigned int pinNum)
 			case CTR_ANGLE_IN:
 				if (thisDev->CIcnt != 0 && pinNum >= 0 && pinNum < thisDev->CIcnt) {
 					// I/O Task configuration
-					if (CItaskList == NULL) {
-						CItaskList = (cLinkedList*)malloc(sizeof(cLinkedList));
-						cListInit(CItaskList);
-					}
-					
 					if (thisDev->CIpins[pinNum].isPinValid == FALSE) {
-						clkSourceTask = (NItask*)malloc(sizeof(NItask));
-						clkSourceTask->taskType = CTR_ANGLE_IN;
-						clkSourceTask->dataBuffer = NULL;
-						DAQmxErrChk(DAQmxCreateTask("", &(clkSourceTask->taskHandler)));
-						cListAppend(CItaskList, (void*)clkSourceTask);
+						clkSourceTask = newNItask(CTR_ANGLE_IN);
 						clkSourceTask->pinCount = 1;
 
 					// Device+Pin configuration
@@ -906,13 +1135,8 @@ void pinMode(unsigned int devNum, IOmodes ioMode, unsigned int pinNum)
 			} // end IO mode switch block
 
 			// Auto-set sample clock source using setClockSource function
-			if (clkSourceTask != NULL) {
-				if (setClockSource(devNum, pinNum, ioMode) == TRUE) {
-					cListPrepend(NItaskList, (void *)clkSourceTask);
-				}
-				else
-					cListAppend(NItaskList, (void *)clkSourceTask);
-			}
+			if (clkSourceTask != NULL)
+				setClockSource(devNum, pinNum, ioMode);
 
 			fprintf(ERRSTREAM, "Set pin mode: %s [%s]\n", pinName, pinModeStr);
 		} // end device validity check if block
@@ -920,6 +1144,86 @@ void pinMode(unsigned int devNum, IOmodes ioMode, unsigned int pinNum)
 }
 
 // library run function definitions
+/*!
+ * \fn unsigned int* buildPinIndex(pinInfo* pins, unsigned int pinCnt, unsigned int* activeCnt)
+ * Lists the task buffer positions ('pinID') of the active pins in a device pin array, in pin order.
+ *
+ * \return Returns a malloc'd index array (NULL if no pin is active), its length is set in 'activeCnt'.
+ */
+unsigned int* buildPinIndex(pinInfo* pins, unsigned int pinCnt, unsigned int* activeCnt)
+{
+	unsigned pinNum, k;
+	unsigned* pinIdx = NULL;
+
+	*activeCnt = 0;
+	for (pinNum = 0; pinNum < pinCnt; pinNum++) {
+		if (pins[pinNum].isPinValid == TRUE)
+			(*activeCnt)++;
+	}
+	if (*activeCnt == 0)
+		return NULL;
+
+	pinIdx = (unsigned*)malloc((*activeCnt) * sizeof(unsigned));
+	for (pinNum = 0, k = 0; pinNum < pinCnt; pinNum++) {
+		if (pins[pinNum].isPinValid == TRUE)
+			pinIdx[k++] = pins[pinNum].pinID;
+	}
+	return pinIdx;
+}
+
+/*!
+ * \fn void buildDevChannelIndex()
+ * Builds the per-device channel index tables into the shared multi-device tasks.
+ * Each device records where its active pins sit in the task 'dataBuffer', so a
+ * per-device read can be served from one task-wide hardware read per cycle, and
+ * per-device writes only touch that device's channels.
+ */
+void buildDevChannelIndex()
+{
+	unsigned devID;
+	deviceInfo* thisDev = NULL;
+
+	for (devID = 0; devID <= DAQmxMaxCount; devID++) {
+		thisDev = &(DAQmxDevList[devID]);
+		if (thisDev->isDevValid != TRUE)
+			continue;
+
+		if (thisDev->AItask != NULL)
+			thisDev->AIchanIdx = buildPinIndex(thisDev->AIpins, thisDev->AIcnt, &(thisDev->AIchanCnt));
+		if (thisDev->AOtask != NULL)
+			thisDev->AOchanIdx = buildPinIndex(thisDev->AOpins, thisDev->AOcnt, &(thisDev->AOchanCnt));
+		if (thisDev->DOtask != NULL)
+			thisDev->DOchanIdx = buildPinIndex(thisDev->DOpins, thisDev->DOcnt, &(thisDev->DOchanCnt));
+		thisDev->AIframeSeq = 0;
+	}
+	if (NItaskAI != NULL) {
+		NItaskAI->frameSeq = 0;
+		NItaskAI->frameStale = TRUE;
+	}
+}
+
+void freeDevChannelIndex()
+{
+	unsigned devID;
+	deviceInfo* thisDev = NULL;
+
+	for (devID = 0; devID <= DAQmxMaxCount; devID++) {
+		thisDev = &(DAQmxDevList[devID]);
+		if (thisDev->isDevValid != TRUE)
+			continue;
+
+		if (thisDev->AIchanIdx != NULL) free(thisDev->AIchanIdx);
+		if (thisDev->AOchanIdx != NULL) free(thisDev->AOchanIdx);
+		if (thisDev->DOchanIdx != NULL) free(thisDev->DOchanIdx);
+		thisDev->AIchanIdx = NULL;
+		thisDev->AOchanIdx = NULL;
+		thisDev->DOchanIdx = NULL;
+		thisDev->AIchanCnt = 0;
+		thisDev->AOchanCnt = 0;
+		thisDev->DOchanCnt = 0;
+	}
+}
+
 void quickDAQstart()
 {
 
@@ -927,27 +1231,36 @@ void quickDAQstart()
 	const uInt32	zeroDigital_32b = 0x00000000;
 
 	if (quickDAQStatus == STATUS_READY) {
-		fprintf(ERRSTREAM, "Starting %d NI-DAQmx tasks...\n", cListLength(NItaskList));
+		fprintf(ERRSTREAM, "Starting %d NI-DAQmx tasks...\n", NItaskCount);
 		
-		cListElem	*myElem = NULL;
 		NItask		*myTask = NULL;
 		unsigned	ii = 0;
-		for (myElem = cListFirstElem(NItaskList); myElem != NULL; myElem = cListNextElem(NItaskList, myElem)) {
-			myTask = (NItask*)myElem->obj;
+		startReplay();
+		for (myTask = firstNItask(); myTask != NULL; myTask = nextNItask(myTask)) {
 			switch (myTask->taskType)
 			{
 			case ANALOG_IN:
 				fprintf(ERRSTREAM, "Starting DAQmx 'ANALOG IN' task with %d active pins\n", myTask->pinCount);
 				myTask->dataBuffer = (void*)malloc(myTask->pinCount * sizeof(float64));
+				myTask->backBuffer = (void*)malloc(myTask->pinCount * sizeof(float64));
 				for (ii = 0; ii < myTask->pinCount; ii++) {
 					((float64*)myTask->dataBuffer)[ii] = zeroAnalog;
+					((float64*)myTask->backBuffer)[ii] = zeroAnalog;
 				}
+				if (quickDAQframePublish)
+					myTask->published = quickDAQframeCreate(myTask->pinCount);
+				if (quickDAQrawAnalogIn && quickDAQreplay == NULL)
+					captureAnalogScaling(myTask);
 				break;
 			case ANALOG_OUT:
 				fprintf(ERRSTREAM, "Starting DAQmx 'ANALOG OUT' task with %d active pins\n", myTask->pinCount);
 				myTask->dataBuffer = (void*)malloc(myTask->pinCount * sizeof(float64));
+				myTask->backBuffer = (void*)malloc(myTask->pinCount * sizeof(float64));
+				myTask->safeBuffer = (void*)malloc(myTask->pinCount * sizeof(float64));
 				for (ii = 0; ii < myTask->pinCount; ii++) {
 					((float64*)myTask->dataBuffer)[ii] = zeroAnalog;
+					((float64*)myTask->backBuffer)[ii] = zeroAnalog;
+					((float64*)myTask->safeBuffer)[ii] = zeroAnalog;
 				}
 				break;
 			case DIGITAL_IN:
@@ -960,16 +1273,24 @@ void quickDAQstart()
 			case DIGITAL_OUT:
 				fprintf(ERRSTREAM, "Starting DAQmx 'DIGITAL OUT' task with %d active ports\n", myTask->pinCount);
 				myTask->dataBuffer = (void*)malloc(myTask->pinCount * sizeof(uInt32));
+				myTask->backBuffer = (void*)malloc(myTask->pinCount * sizeof(uInt32));
+				myTask->safeBuffer = (void*)malloc(myTask->pinCount * sizeof(uInt32));
 				for (ii = 0; ii < myTask->pinCount; ii++) {
 					((uInt32*)myTask->dataBuffer)[ii] = zeroDigital_32b;
+					((uInt32*)myTask->backBuffer)[ii] = zeroDigital_32b;
+					((uInt32*)myTask->safeBuffer)[ii] = zeroDigital_32b;
 				}
 				break;
 			case CTR_ANGLE_IN:
 				fprintf(ERRSTREAM, "Starting DAQmx 'COUNTER ANGLE IN' task with %d active counters\n", myTask->pinCount);
 				myTask->dataBuffer = (void*)malloc(myTask->pinCount * sizeof(float64));
+				myTask->backBuffer = (void*)malloc(myTask->pinCount * sizeof(float64));
 				for (ii = 0; ii < myTask->pinCount; ii++) {
 					((float64*)myTask->dataBuffer)[ii] = zeroAnalog;
+					((float64*)myTask->backBuffer)[ii] = zeroAnalog;
 				}
+				if (quickDAQframePublish)
+					myTask->published = quickDAQframeCreate(myTask->pinCount);
 				break;
 			case CTR_TICK_OUT:
 				fprintf(ERRSTREAM, "Starting DAQmx 'COUNTER TICK OUT' task with %d active counters\n", myTask->pinCount);
@@ -986,24 +1307,158 @@ void quickDAQstart()
 				exit(quickDAQErrorCode);
 				break;
 			}
-			DAQmxErrChk(DAQmxStartTask(myTask->taskHandler));
 		}
+
+		startEventSources();
+
+		// Commit all tasks so that a stop/start during recovery keeps their reserved resources
+		for (myTask = firstNItask(); myTask != NULL; myTask = nextNItask(myTask)) {
+			if (quickDAQreplay == NULL)
+				DAQmxErrChk(DAQmxTaskControl(myTask->taskHandler, DAQmx_Val_Task_Commit));
+			myTask->faultCode = 0;
+		}
+
+		// Start the clock master task first, then all others. A replay never starts the hardware.
+		if (NItaskMaster >= 0 && quickDAQreplay == NULL)
+			DAQmxErrChk(DAQmxStartTask(NItaskTable[NItaskMaster].taskHandler));
+		for (myTask = firstNItask(); myTask != NULL && quickDAQreplay == NULL; myTask = nextNItask(myTask)) {
+			if ((int)(myTask - NItaskTable) != NItaskMaster)
+				DAQmxErrChk(DAQmxStartTask(myTask->taskHandler));
+		}
+		buildDevChannelIndex();
+		startBackgroundReaders();
+		buildCounterTable();
+		buildCyclePlan();
+		resetCommandQueue();
+		initSampleClockWait();
+		clearSafeState();
+		startDataLog();
+		startWatchdog();
 		
 		quickDAQSetStatus(STATUS_RUNNING, TRUE);
 	}
 }
 
+// Touches a stack region large enough for the cycle so that it is resident before the loop starts
+static void prefaultStack()
+{
+	volatile char stackPages[QUICKDAQ_STACK_PREFAULT];
+	unsigned k;
+	for (k = 0; k < sizeof(stackPages); k += 4096)
+		stackPages[k] = 0;
+}
+
+/*!
+ * \fn void prefaultRunBuffers()
+ * Touches every buffer the running loop uses: task buffers, background rings, the cycle plan,
+ * grouped counter tables, the error ring, the timing recorder and a slice of the stack.
+ */
+void prefaultRunBuffers()
+{
+	NItask	*myTask = NULL;
+	size_t	sampleSize = 0;
+
+	for (myTask = firstNItask(); myTask != NULL; myTask = nextNItask(myTask)) {
+		sampleSize = taskSampleSize(myTask);
+		qdPrefault(myTask->dataBuffer, myTask->pinCount * sampleSize);
+		qdPrefault(myTask->backBuffer, myTask->pinCount * sampleSize);
+		qdPrefault(myTask->safeBuffer, myTask->pinCount * sampleSize);
+		qdPrefault(myTask->rawBuffer, 2 * myTask->pinCount * sizeof(int16));
+		qdPrefault(myTask->scaleCoeffs, QUICKDAQ_SCALE_COEFFS * myTask->pinCount * sizeof(float64));
+		if (myTask->ring != NULL) {
+			qdPrefault(myTask->ring, sizeof(quickDAQring));
+			qdPrefault(myTask->ring->blocks, (size_t)myTask->ring->blockStride * myTask->ring->blockCount * sizeof(float64));
+			qdPrefault(myTask->ring->scratch, (size_t)myTask->ring->blockStride * sizeof(float64));
+			qdPrefault(myTask->ring->rawBlocks, (size_t)myTask->ring->blockStride * myTask->ring->blockCount * sizeof(int16));
+			qdPrefault(myTask->ring->rawScratch, (size_t)myTask->ring->blockStride * sizeof(int16));
+			qdPrefault(myTask->ring->scaled, (size_t)myTask->ring->blockStride * sizeof(float64));
+			qdPrefault(myTask->ring->latest, (size_t)myTask->ring->chanCount * sizeof(float64));
+			qdPrefault(myTask->ring->rawLatest, (size_t)myTask->ring->chanCount * sizeof(int16));
+		}
+		if (myTask->published != NULL) {
+			qdPrefault(myTask->published, sizeof(quickDAQframePub));
+			qdPrefault(myTask->published->data, myTask->published->chanCount * sizeof(float64));
+		}
+	}
+	qdPrefault(NItaskTable, NItaskCapacity * sizeof(NItask));
+	qdPrefault(quickDAQcyclePlan, quickDAQcycleLen * sizeof(cycleStep));
+	qdPrefault(cycleStepErrors, quickDAQcycleLen * sizeof(int32));
+	qdPrefault(CIreadList, CIreadCnt * sizeof(NItask*));
+	qdPrefault(CIangles, CIreadCnt * sizeof(float64));
+	qdPrefault(CIreadErrors, CIreadCnt * sizeof(int32));
+	qdPrefault(quickDAQerrorRing, quickDAQerrorCap * sizeof(quickDAQerror));
+	qdPrefault(quickDAQactiveSession, sizeof(quickDAQSession));
+	prefaultStack();
+}
+
+/*!
+ * \fn int quickDAQstartRT(int cpu, int priority)
+ * Starts quickDAQ like quickDAQstart() and prepares the calling thread to run the control loop:
+ * locks process memory, prefaults all run-time buffers and then moves the thread to real-time
+ * scheduling (SCHED_FIFO at 'priority' on POSIX, TIME_CRITICAL on Windows) pinned to 'cpu'
+ * (pass a negative 'cpu' to leave affinity alone). Helper threads are spawned before the policy
+ * change, so they do not inherit it. Failing real-time steps only produce warnings.
+ *
+ * \return Returns ERROR_NONE if every step succeeded, ERROR_UNSUPPORTED if quickDAQ runs without
+ * some of the real-time settings, or ERROR_NOTREADY if quickDAQ could not be started.
+ */
+int quickDAQstartRT(int cpu, int priority)
+{
+	int status = ERROR_NONE;
+
+	quickDAQstart();
+	if (quickDAQStatus != STATUS_RUNNING)
+		return quickDAQSetError(ERROR_NOTREADY, FALSE);
+
+	if (qdLockMemory() != 0) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Unable to lock process memory.\n");
+		status = ERROR_UNSUPPORTED;
+	}
+	prefaultRunBuffers();
+
+	if (cpu >= 0 && qdPinCurrentThread(cpu) != 0) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Unable to pin the control thread to CPU %d.\n", cpu);
+		status = ERROR_UNSUPPORTED;
+	}
+	if (qdSetThreadRealtime(priority) != 0) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Unable to set real-time priority %d for the control thread.\n", priority);
+		status = ERROR_UNSUPPORTED;
+	}
+	fprintf(ERRSTREAM, "Control thread prepared for real-time operation (CPU %d, priority %d).\n", cpu, priority);
+	return (status == ERROR_NONE) ? ERROR_NONE : quickDAQSetError(status, FALSE);
+}
+
 void quickDAQstop()
 {
 	if (quickDAQStatus == STATUS_RUNNING) {
 		
-		cListElem *myElem = NULL;
 		NItask* myTask = NULL;
-		for (myElem = cListFirstElem(NItaskList); myElem != NULL; myElem = cListNextElem(NItaskList, myElem)) {
-			myTask = (NItask*)myElem->obj;
+		stopWatchdog();
+		stopDataLog();
+		stopEventSources();
+		stopBackgroundReaders();
+		stopReplay();
+		for (myTask = firstNItask(); myTask != NULL; myTask = nextNItask(myTask)) {
 			DAQmxErrChk(DAQmxStopTask(myTask->taskHandler));
 			if (myTask->dataBuffer != NULL) {
 				free(myTask->dataBuffer);
+				myTask->dataBuffer = NULL;
+			}
+			if (myTask->backBuffer != NULL) {
+				free(myTask->backBuffer);
+				myTask->backBuffer = NULL;
+			}
+			if (myTask->safeBuffer != NULL) {
+				free(myTask->safeBuffer);
+				myTask->safeBuffer = NULL;
+			}
+			quickDAQframeDestroy(myTask->published);
+			myTask->published = NULL;
+			if (myTask->rawBuffer != NULL) {
+				qdAlignedFree(myTask->rawBuffer);
+				qdAlignedFree(myTask->scaleCoeffs);
+				myTask->rawBuffer = NULL;
+				myTask->scaleCoeffs = NULL;
 			}
 			//fprintf(ERRSTREAM, "Stopped a DAQmx task\n");
 			switch (myTask->taskType)
@@ -1035,6 +1490,9 @@ void quickDAQstop()
 				break;
 			}
 		}
+		freeDevChannelIndex();
+		freeCounterTable();
+		freeCyclePlan();
 		quickDAQSetStatus(STATUS_READY, TRUE);
 	}
 }
@@ -1045,20 +1503,54 @@ void quickDAQstop()
 //---------------------------------
 
 // functions to read analog pin values
-void readAnalog_intBuf(unsigned devNum)
+	// The AI task is shared by all devices. The first device read after a cycle boundary (see
+	// syncSampling) reads the hardware and the other devices reuse that frame, so reading N devices
+	// per cycle costs one read. A device reading twice within a cycle gets a new frame.
+int readAnalog_intBuf(unsigned devNum)
 {
+	int status = ERROR_NONE;
 	if (quickDAQStatus == STATUS_RUNNING) {
-		DAQmxErrChk(DAQmxReadAnalogF64(DAQmxDevList[devNum].AItask->taskHandler, DAQmxDefaults.NIAIsampsPerCh, DAQmxDefaults.IOtimeout ,
-									   DAQmxDefaults.AIdataLayout, (float64*)DAQmxDevList[devNum].AItask->dataBuffer, DAQmxDevList[devNum].AItask->pinCount, NULL, NULL));
+		deviceInfo* thisDev = &(DAQmxDevList[devNum]);
+		NItask* thisTask = thisDev->AItask;
+		if (thisTask->frameStale || thisDev->AIframeSeq == thisTask->frameSeq) {
+			if (quickDAQreplay != NULL)
+				replayReadTask(thisTask);
+			else if (missExtrapolates())
+				extrapolateInputs(thisTask);
+			else if (thisTask->rawBuffer != NULL)
+				status = taskErrChk(readAnalogRaw(thisTask), thisTask);
+			else if (thisTask->ring != NULL)
+				quickDAQringLatestFrame(thisTask->ring, (float64*)thisTask->backBuffer);
+			else
+				status = taskErrChk(DAQmxReadAnalogF64(thisTask->taskHandler, DAQmxDefaults.NIAIsampsPerCh, DAQmxDefaults.IOtimeout ,
+											   DAQmxDefaults.AIdataLayout, (float64*)thisTask->backBuffer, thisTask->pinCount, NULL, NULL), thisTask);
+			if (status != ERROR_NONE)
+				return status;
+			swapTaskBuffers(thisTask);
+			thisTask->frameSeq++;
+			thisTask->frameStale = FALSE;
+		}
+		thisDev->AIframeSeq = thisTask->frameSeq;
+		return status;
 	}
+	return quickDAQSetError(ERROR_NOTREADY, FALSE);
 }
 
-void readAnalog_extBuf(unsigned devNum, float64 *outputData)
+int readAnalog_extBuf(unsigned devNum, float64 *outputData)
 {
+	int status = ERROR_NOTREADY;
 	if (quickDAQStatus == STATUS_RUNNING) {
-		readAnalog_intBuf(devNum);
-		memcpy(outputData, DAQmxDevList[devNum].AItask->dataBuffer, DAQmxDevList[devNum].AItask->pinCount * sizeof(float64));
+		status = readAnalog_intBuf(devNum);
+		
+		// copy only this device's slice of the shared frame, in pin order
+		deviceInfo* thisDev = &(DAQmxDevList[devNum]);
+		float64* frame = (float64*)thisDev->AItask->dataBuffer;
+		unsigned k;
+		for (k = 0; k < thisDev->AIchanCnt; k++) {
+			outputData[k] = frame[thisDev->AIchanIdx[k]];
+		}
 	}
+	return status;
 }
 
 /*inline*/ float64 getAnalogInPin(unsigned devNum, unsigned pinNum)
@@ -1071,20 +1563,37 @@ void readAnalog_extBuf(unsigned devNum, float64 *outputData)
 }
 
 // functions to write analog pin values
-void writeAnalog_intBuf(unsigned devNum)
+int writeAnalog_intBuf(unsigned devNum)
 {
+	void* outFrame = NULL;
 	if (quickDAQStatus == STATUS_RUNNING) {
-		DAQmxErrChk(DAQmxWriteAnalogF64(DAQmxDevList[devNum].AOtask->taskHandler, DAQmxDefaults.NIsamplesPerCh, DAQmxDefaults.AnalogAutoStart,
-										DAQmxDefaults.IOtimeout, DAQmxDefaults.dataLayout, (float64*)DAQmxDevList[devNum].AOtask->dataBuffer, NULL, NULL));
+		// A replay keeps the outputs in the task buffer (and the data log)
+		if (quickDAQreplay != NULL)
+			return ERROR_NONE;
+		// The deadline-miss policy picks the frame, as in quickDAQcycle()
+		outFrame = missOutputFrame(DAQmxDevList[devNum].AOtask, (quickDAQmissRun > 0) ? TRUE : FALSE);
+		if (outFrame == NULL)
+			return ERROR_NONE;
+		return taskErrChk(DAQmxWriteAnalogF64(DAQmxDevList[devNum].AOtask->taskHandler, DAQmxDefaults.NIsamplesPerCh, DAQmxDefaults.AnalogAutoStart,
+										DAQmxDefaults.IOtimeout, DAQmxDefaults.dataLayout, (float64*)outFrame, NULL, NULL),
+						  DAQmxDevList[devNum].AOtask);
 	}
+	return quickDAQSetError(ERROR_NOTREADY, FALSE);
 }
 
-void writeAnalog_extBuf(unsigned devNum, float64 *inputData)
+int writeAnalog_extBuf(unsigned devNum, float64 *inputData)
 {
 	if (quickDAQStatus == STATUS_RUNNING) {
-		memcpy(DAQmxDevList[devNum].AOtask->dataBuffer, inputData, DAQmxDevList[devNum].AOtask->pinCount * sizeof(float64));
-		writeAnalog_intBuf(devNum);
+		// scatter into this device's slice of the shared AO task buffer, in pin order
+		deviceInfo* thisDev = &(DAQmxDevList[devNum]);
+		float64* frame = (float64*)thisDev->AOtask->dataBuffer;
+		unsigned k;
+		for (k = 0; k < thisDev->AOchanCnt; k++) {
+			frame[thisDev->AOchanIdx[k]] = inputData[k];
+		}
+		return writeAnalog_intBuf(devNum);
 	}
+	return quickDAQSetError(ERROR_NOTREADY, FALSE);
 }
 
 void setAnalogOutPin(unsigned devNum, unsigned pinNum, float64 pinValue)
@@ -1096,21 +1605,35 @@ void setAnalogOutPin(unsigned devNum, unsigned pinNum, float64 pinValue)
 }
 
 // functions to write digital port state
-void writeDigital_intBuf(unsigned devNum)
+int writeDigital_intBuf(unsigned devNum)
 {
+	void* outFrame = NULL;
 	if (quickDAQStatus == STATUS_RUNNING) {
-		DAQmxErrChk(DAQmxWriteDigitalU32(DAQmxDevList[devNum].DOtask->taskHandler, DAQmxDefaults.NIsamplesPerCh, DAQmxDefaults.DigiAutoStart,
-										 DAQmxDefaults.IOtimeout, DAQmxDefaults.dataLayout, (uInt32*)DAQmxDevList[devNum].DOtask->dataBuffer, NULL, NULL));
+		if (quickDAQreplay != NULL)
+			return ERROR_NONE;
+		outFrame = missOutputFrame(DAQmxDevList[devNum].DOtask, (quickDAQmissRun > 0) ? TRUE : FALSE);
+		if (outFrame == NULL)
+			return ERROR_NONE;
+		return taskErrChk(DAQmxWriteDigitalU32(DAQmxDevList[devNum].DOtask->taskHandler, DAQmxDefaults.NIsamplesPerCh, DAQmxDefaults.DigiAutoStart,
+										 DAQmxDefaults.IOtimeout, DAQmxDefaults.dataLayout, (uInt32*)outFrame, NULL, NULL),
+						  DAQmxDevList[devNum].DOtask);
 	}
+	return quickDAQSetError(ERROR_NOTREADY, FALSE);
 }
 
-void writeDigital_extBuf(unsigned devNum, uInt32 *inputData)
+int writeDigital_extBuf(unsigned devNum, uInt32 *inputData)
 {
 	if (quickDAQStatus == STATUS_RUNNING) {
-		memcpy(DAQmxDevList[devNum].DOtask->dataBuffer, inputData, DAQmxDevList[devNum].DOtask->pinCount * sizeof(uInt32));
-		writeDigital_intBuf(devNum);
+		// scatter into this device's slice of the shared DO task buffer, in port order
+		deviceInfo* thisDev = &(DAQmxDevList[devNum]);
+		uInt32* frame = (uInt32*)thisDev->DOtask->dataBuffer;
+		unsigned k;
+		for (k = 0; k < thisDev->DOchanCnt; k++) {
+			frame[thisDev->DOchanIdx[k]] = inputData[k];
+		}
+		return writeDigital_intBuf(devNum);
 	}
-
+	return quickDAQSetError(ERROR_NOTREADY, FALSE);
 }
 
 void setDigitalOutPort(unsigned devNum, unsigned portNum, uInt32 portValue)
@@ -1122,12 +1645,13 @@ void setDigitalOutPort(unsigned devNum, unsigned portNum, uInt32 portValue)
 }
 
 // functions to write a particular digital pin
-void writeDigitalPin(unsigned devNum, unsigned portNum, unsigned pinNum, bool bitState)
+int writeDigitalPin(unsigned devNum, unsigned portNum, unsigned pinNum, bool bitState)
 {
 	if (quickDAQStatus == STATUS_RUNNING) {
 		setDigitalOutPin(devNum, portNum, pinNum, bitState);
-		writeDigital_intBuf(devNum);
+		return writeDigital_intBuf(devNum);
 	}
+	return quickDAQSetError(ERROR_NOTREADY, FALSE);
 }
 
 void setDigitalOutPin(unsigned devNum, unsigned portNum, unsigned pinNum, bool bitState)
@@ -1143,21 +1667,35 @@ void setDigitalOutPin(unsigned devNum, unsigned portNum, unsigned pinNum, bool b
 }
 
 // functions to read counter angle
-void readCounterAngle_intBuf(unsigned devNum, unsigned ctrNum)
+int readCounterAngle_intBuf(unsigned devNum, unsigned ctrNum)
 {
+	int status = ERROR_NONE;
 	if (quickDAQStatus == STATUS_RUNNING) {
-		DAQmxErrChk(DAQmxReadCounterF64(DAQmxDevList[devNum].CItask[ctrNum]->taskHandler, DAQmxDefaults.NIsamplesPerCh,
-			DAQmxDefaults.IOtimeout, (float64*)DAQmxDevList[devNum].CItask[ctrNum]->dataBuffer, DAQmxDevList[devNum].CItask[ctrNum]->pinCount, NULL, NULL));
+		NItask* ctrTask = DAQmxDevList[devNum].CItask[ctrNum];
+		if (quickDAQreplay != NULL)
+			replayReadTask(ctrTask);
+		else if (missExtrapolates())
+			extrapolateInputs(ctrTask);
+		else if (ctrTask->ring != NULL)
+			quickDAQringLatestFrame(ctrTask->ring, (float64*)ctrTask->backBuffer);
+		else
+			status = taskErrChk(DAQmxReadCounterF64(ctrTask->taskHandler, DAQmxDefaults.NIsamplesPerCh,
+				DAQmxDefaults.IOtimeout, (float64*)ctrTask->backBuffer, ctrTask->pinCount, NULL, NULL), ctrTask);
+		if (status == ERROR_NONE)
+			swapTaskBuffers(ctrTask);
+		return status;
 	}
+	return quickDAQSetError(ERROR_NOTREADY, FALSE);
 }
 
-void readCounterAngle_extBuf(unsigned devNum, unsigned ctrNum, float64 *outputData)
+int readCounterAngle_extBuf(unsigned devNum, unsigned ctrNum, float64 *outputData)
 {
+	int status = ERROR_NOTREADY;
 	if (quickDAQStatus == STATUS_RUNNING) {
-		readCounterAngle_intBuf(devNum, ctrNum);
+		status = readCounterAngle_intBuf(devNum, ctrNum);
 		memcpy(outputData, DAQmxDevList[devNum].CItask[ctrNum]->dataBuffer, DAQmxDevList[devNum].CItask[ctrNum]->pinCount * sizeof(float64));
 	}
-
+	return status;
 }
 
 float64 getCounterAngle(unsigned devNum, unsigned ctrNum)
@@ -1169,50 +1707,649 @@ float64 getCounterAngle(unsigned devNum, unsigned ctrNum)
 	return NAN;
 }
 
-void syncSampling()
+// grouped counter read functions
+/*!
+ * \fn void setCounterWorkers(unsigned workerCount, const int* cpuList)
+ * Configures the worker pool used by readAllCounters(). With 'workerCount' workers plus the
+ * calling thread, up to workerCount+1 counters are read concurrently. Worker 'n' is pinned to
+ * cpuList[n] (pass NULL or -1 entries to leave workers unpinned). 0 workers reads serially.
+ * Between reads each worker spins, using a full core, for up to QUICKDAQ_WORKER_SPIN_NS and then
+ * parks. Above 500 Hz (1/QUICKDAQ_WORKER_SPIN_NS) the workers never park.
+ * Must be called before quickDAQstart().
+ */
+void setCounterWorkers(unsigned workerCount, const int* cpuList)
+{
+	unsigned workerNum;
+	if (quickDAQStatus != STATUS_INIT && quickDAQStatus != STATUS_READY) {
+		quickDAQSetError(ERROR_NOTCONFIG, TRUE);
+		return;
+	}
+	CIworkerCount = (workerCount > QUICKDAQ_MAX_WORKERS) ? QUICKDAQ_MAX_WORKERS : workerCount;
+	for (workerNum = 0; workerNum < QUICKDAQ_MAX_WORKERS; workerNum++) {
+		CIworkerCpus[workerNum] = (cpuList != NULL && workerNum < CIworkerCount) ? cpuList[workerNum] : -1;
+	}
+}
+
+/*!
+ * \fn void buildCounterTable()
+ * Lists all active counter input tasks, ordered by device and then counter number, allocates the
+ * contiguous angle array filled by readAllCounters() and starts the counter worker pool.
+ */
+void buildCounterTable()
+{
+	unsigned devID, ctrNum;
+
+	freeCounterTable();
+	for (devID = 0; devID <= DAQmxMaxCount; devID++) {
+		if (DAQmxDevList[devID].isDevValid != TRUE) continue;
+		for (ctrNum = 0; ctrNum < DAQmxDevList[devID].CIcnt; ctrNum++) {
+			if (DAQmxDevList[devID].CItask[ctrNum] != NULL) CIreadCnt++;
+		}
+	}
+	if (CIreadCnt == 0)
+		return;
+
+	CIreadList = (NItask**)malloc(CIreadCnt * sizeof(NItask*));
+	CIangles = (float64*)qdAlignedAlloc(QD_CACHELINE, CIreadCnt * sizeof(float64));
+	CIreadErrors = (int32*)malloc(CIreadCnt * sizeof(int32));
+	CIreadCnt = 0;
+	for (devID = 0; devID <= DAQmxMaxCount; devID++) {
+		if (DAQmxDevList[devID].isDevValid != TRUE) continue;
+		for (ctrNum = 0; ctrNum < DAQmxDevList[devID].CIcnt; ctrNum++) {
+			if (DAQmxDevList[devID].CItask[ctrNum] != NULL) {
+				CIangles[CIreadCnt] = 0.0;
+				CIreadErrors[CIreadCnt] = 0;
+				CIreadList[CIreadCnt++] = DAQmxDevList[devID].CItask[ctrNum];
+			}
+		}
+	}
+
+	if (CIworkerCount > 0 && CIreadCnt > 1) {
+		CIworkerPool = quickDAQpoolCreate(min(CIworkerCount, CIreadCnt - 1), CIworkerCpus);
+		if (CIworkerPool == NULL)
+			fprintf(ERRSTREAM, "QuickDAQ library: Warning: Unable to start counter read workers. Counters are read serially.\n");
+		else
+			fprintf(ERRSTREAM, "Started %u counter read worker(s) for %u counters\n", CIworkerPool->workerCount, CIreadCnt);
+	}
+}
+
+void freeCounterTable()
+{
+	if (CIworkerPool != NULL) quickDAQpoolDestroy(CIworkerPool);
+	if (CIreadList != NULL) free(CIreadList);
+	if (CIangles != NULL) qdAlignedFree(CIangles);
+	if (CIreadErrors != NULL) free(CIreadErrors);
+	CIworkerPool = NULL;
+	CIreadList = NULL;
+	CIangles = NULL;
+	CIreadErrors = NULL;
+	CIreadCnt = 0;
+}
+
+/*!
+ * \fn int getCounterIndex(unsigned devNum, unsigned ctrNum)
+ * Returns the position of a counter in the array returned by readAllCounters(), or -1.
+ */
+int getCounterIndex(unsigned devNum, unsigned ctrNum)
+{
+	unsigned k;
+	for (k = 0; k < CIreadCnt; k++) {
+		if (CIreadList[k] == DAQmxDevList[devNum].CItask[ctrNum])
+			return (int)k;
+	}
+	return -1;
+}
+
+static void readCounterJob(unsigned jobNum, void* jobArg)
+{
+	NItask*	ctrTask = CIreadList[jobNum];
+	int32	error = 0;
+
+	// Faulted tasks keep their last angle until quickDAQrecover() restarts them
+	if (ctrTask->faultCode != 0) {
+		CIangles[jobNum] = ((float64*)ctrTask->dataBuffer)[0];
+		((int32*)jobArg)[jobNum] = 0;
+		return;
+	}
+	if (quickDAQreplay != NULL)
+		replayReadTask(ctrTask);
+	else if (missExtrapolates())
+		extrapolateInputs(ctrTask);
+	else if (ctrTask->ring != NULL)
+		quickDAQringLatestFrame(ctrTask->ring, (float64*)ctrTask->backBuffer);
+	else
+		error = DAQmxReadCounterF64(ctrTask->taskHandler, DAQmxDefaults.NIsamplesPerCh, DAQmxDefaults.IOtimeout,
+			(float64*)ctrTask->backBuffer, ctrTask->pinCount, NULL, NULL);
+	if (!DAQmxFailed(error))
+		swapTaskBuffers(ctrTask);
+	CIangles[jobNum] = ((float64*)ctrTask->dataBuffer)[0];
+	((int32*)jobArg)[jobNum] = error;
+}
+
+/*!
+ * \fn const float64* readAllCounters()
+ * Reads every active counter input task in one call. The reads are spread across the counter
+ * worker pool (see setCounterWorkers) so that the call takes about as long as a single counter
+ * read. Internal counter buffers are updated too, so getCounterAngle() keeps working.
+ *
+ * \return Returns the contiguous angle array, ordered by device and then counter number
+ * (see getCounterIndex), or NULL if quickDAQ is not running.
+ */
+const float64* readAllCounters()
+{
+	unsigned k;
+	if (quickDAQStatus != STATUS_RUNNING)
+		return NULL;
+
+	if (CIworkerPool != NULL)
+		quickDAQpoolRun(CIworkerPool, CIreadCnt, readCounterJob, (void*)CIreadErrors);
+	else
+		for (k = 0; k < CIreadCnt; k++) readCounterJob(k, (void*)CIreadErrors);
+
+	// Errors are checked on the calling thread, so the error ring keeps a single producer
+	for (k = 0; k < CIreadCnt; k++) {
+		if (DAQmxFailed(CIreadErrors[k]))
+			taskErrChk(CIreadErrors[k], CIreadList[k]);
+	}
+	return CIangles;
+}
+
+// channel handle functions
+/*!
+ * \fn quickDAQchan getChannelHandle(unsigned devNum, IOmodes ioMode, unsigned pinNum)
+ * Resolves a configured pin (or DO port, or counter) into a channel handle for the inline
+ * get*Chan/set*Chan accessors. Call after pinMode(); the handle can be used once quickDAQ runs
+ * and stays valid until quickDAQTerminate().
+ *
+ * \return Returns the handle, or a handle with a NULL 'frame' if the pin is not configured.
+ */
+quickDAQchan getChannelHandle(unsigned devNum, IOmodes ioMode, unsigned pinNum)
+{
+	quickDAQchan chan = { NULL, 0, ioMode, NULL };
+	deviceInfo* thisDev = NULL;
+	pinInfo* thisPin = NULL;
+
+	if (quickDAQStatus < STATUS_INIT || devNum > DAQmxMaxCount || DAQmxDevList[devNum].isDevValid != TRUE) {
+		quickDAQSetError(ERROR_INVIO, TRUE);
+		return chan;
+	}
+	thisDev = &(DAQmxDevList[devNum]);
+
+	switch (ioMode)
+	{
+	case ANALOG_IN:
+		thisPin = (pinNum < thisDev->AIcnt) ? &(thisDev->AIpins[pinNum]) : NULL;
+		break;
+	case ANALOG_OUT:
+		thisPin = (pinNum < thisDev->AOcnt) ? &(thisDev->AOpins[pinNum]) : NULL;
+		break;
+	case DIGITAL_OUT:
+		thisPin = (pinNum < thisDev->DOcnt) ? &(thisDev->DOpins[pinNum]) : NULL;
+		break;
+	case CTR_ANGLE_IN:
+		thisPin = (pinNum < thisDev->CIcnt) ? &(thisDev->CIpins[pinNum]) : NULL;
+		break;
+	default:
+		break;
+	}
+
+	if (thisPin == NULL || thisPin->isPinValid != TRUE) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Unconfigured channel handle requested: Dev %d | IO mode %d | pin %d.\n", devNum, ioMode, pinNum);
+		quickDAQSetError(ERROR_INVIO, TRUE);
+		return chan;
+	}
+	chan.task = thisPin->pinTask;
+	chan.frame = &(thisPin->pinTask->dataBuffer);
+	chan.idx = thisPin->pinID;
+	return chan;
+}
+
+/*!
+ * \fn bool quickDAQchanValid(quickDAQchan chan, IOmodes ioMode)
+ * Checked counterpart of the inline channel accessors, used by them in debug builds.
+ */
+bool quickDAQchanValid(quickDAQchan chan, IOmodes ioMode)
+{
+	if (quickDAQStatus != STATUS_RUNNING) {
+		quickDAQSetError(ERROR_NOTREADY, TRUE);
+		return FALSE;
+	}
+	if (chan.frame == NULL || *chan.frame == NULL || chan.ioMode != ioMode || chan.idx >= chan.task->pinCount) {
+		quickDAQSetError(ERROR_INVIO, TRUE);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+// zero-copy view functions
+/*!
+ * \fn quickDAQreadView readAnalogView(unsigned devNum)
+ * Reads the device's analog inputs (see readAnalog) and returns a view of its channels in the
+ * AI task's front buffer instead of copying them out.
+ */
+quickDAQreadView readAnalogView(unsigned devNum)
 {
-	if (DAQmxSampleMode == DAQmx_Val_HWTimedSinglePoint) {
-		DAQmxErrChk(DAQmxWaitForNextSampleClock( ((NItask*)cListFirstData(NItaskList))->taskHandler, DAQmxDefaults.IOtimeout, &lateSampleWarning));
+	quickDAQreadView view = { NULL, NULL, 0 };
+	if (quickDAQStatus == STATUS_RUNNING) {
+		readAnalog_intBuf(devNum);
+		view.data = (const float64*)DAQmxDevList[devNum].AItask->dataBuffer;
+		view.chanIdx = DAQmxDevList[devNum].AIchanIdx;
+		view.len = DAQmxDevList[devNum].AIchanCnt;
 	}
+	return view;
+}
+
+quickDAQreadView readCounterAngleView(unsigned devNum, unsigned ctrNum)
+{
+	quickDAQreadView view = { NULL, NULL, 0 };
+	if (quickDAQStatus == STATUS_RUNNING) {
+		readCounterAngle_intBuf(devNum, ctrNum);
+		view.data = (const float64*)DAQmxDevList[devNum].CItask[ctrNum]->dataBuffer;
+		view.len = DAQmxDevList[devNum].CItask[ctrNum]->pinCount;
+	}
+	return view;
+}
+
+/*!
+ * \fn quickDAQanalogWriteView writeAnalogView(unsigned devNum)
+ * Returns a writable view of the device's channels in the AO task buffer. Values written through
+ * the view are flushed as they are by the next writeAnalog(devNum) or quickDAQcycle().
+ */
+quickDAQanalogWriteView writeAnalogView(unsigned devNum)
+{
+	quickDAQanalogWriteView view = { NULL, NULL, 0 };
+	if (quickDAQStatus == STATUS_RUNNING) {
+		view.data = (float64*)DAQmxDevList[devNum].AOtask->dataBuffer;
+		view.chanIdx = DAQmxDevList[devNum].AOchanIdx;
+		view.len = DAQmxDevList[devNum].AOchanCnt;
+	}
+	return view;
+}
+
+quickDAQdigitalWriteView writeDigitalView(unsigned devNum)
+{
+	quickDAQdigitalWriteView view = { NULL, NULL, 0 };
+	if (quickDAQStatus == STATUS_RUNNING) {
+		view.data = (uInt32*)DAQmxDevList[devNum].DOtask->dataBuffer;
+		view.chanIdx = DAQmxDevList[devNum].DOchanIdx;
+		view.len = DAQmxDevList[devNum].DOchanCnt;
+	}
+	return view;
+}
+
+int syncSampling()
+{
+	int		status = ERROR_NONE;
+	uInt64	waitBegin = 0;
+	bool32	waited = FALSE;
+
+	if (quickDAQreplay != NULL) {
+		if (quickDAQcycleTiming.enabled)
+			waitBegin = qdMonotonicNs();
+		replayTick();
+		if (quickDAQcycleTiming.enabled)
+			recordWaitTiming(waitBegin, qdMonotonicNs(), lateSampleWarning);
+		if (quickDAQreplay->isDone)
+			status = quickDAQSetError(ERROR_REPLAYEND, FALSE);
+		waited = TRUE;
+	}
+	else if (DAQmxSampleMode == DAQmx_Val_HWTimedSinglePoint) {
+		// Same rule as quickDAQcycle(): no clock edge, no new cycle
+		if (NItaskTable[NItaskMaster].faultCode != 0)
+			return ERROR_NIDAQMX;
+		if (quickDAQcycleTiming.enabled)
+			waitBegin = qdMonotonicNs();
+		status = taskErrChk(waitForSampleClock(NItaskTable[NItaskMaster].taskHandler), &(NItaskTable[NItaskMaster]));
+		if (quickDAQcycleTiming.enabled)
+			recordWaitTiming(waitBegin, qdMonotonicNs(), lateSampleWarning);
+		if (status != ERROR_NONE)
+			return status;
+		waited = TRUE;
+	}
+	else if (DAQmxSampleMode == ON_DEMAND && DAQmxSamplingRate > 0.0) {
+		if (quickDAQcycleTiming.enabled)
+			waitBegin = qdMonotonicNs();
+		waitForSoftClock();
+		if (quickDAQcycleTiming.enabled)
+			recordWaitTiming(waitBegin, qdMonotonicNs(), lateSampleWarning);
+		waited = TRUE;
+	}
+	// The read and write functions apply the input and output miss policies until the next edge
+	if (waited)
+		recordMiss(lateSampleWarning);
+	else
+		quickDAQclockTick++;
+	// New cycle: the shared AI frame is refreshed by the first device read
+	if (NItaskAI != NULL)
+		NItaskAI->frameStale = TRUE;
+	quickDAQcycleCount++;
+	quickDAQbeat();
+	return status;
+}
+
+//------------------------------------
+// cycle engine function definitions
+//------------------------------------
+
+/*!
+ * \fn void setCycleWorkers(unsigned workerCount, const int* cpuList)
+ * Configures the worker pool used by quickDAQcycle() to issue the I/O calls of different tasks
+ * in parallel. The output flushes run concurrently, then the sample clock wait runs on the calling
+ * thread, then the input reads run concurrently; each phase ends when all of its calls returned.
+ * Worker 'n' is pinned to cpuList[n] (pass NULL or -1 entries to leave workers unpinned).
+ * Between phases each worker spins, using a full core, for up to QUICKDAQ_WORKER_SPIN_NS and then
+ * parks. Above 500 Hz (1/QUICKDAQ_WORKER_SPIN_NS) the workers never park.
+ * 0 workers runs the plan serially. Must be called before quickDAQstart().
+ */
+void setCycleWorkers(unsigned workerCount, const int* cpuList)
+{
+	unsigned workerNum;
+	if (quickDAQStatus != STATUS_INIT && quickDAQStatus != STATUS_READY) {
+		quickDAQSetError(ERROR_NOTCONFIG, TRUE);
+		return;
+	}
+	cycleWorkerCount = (workerCount > QUICKDAQ_MAX_WORKERS) ? QUICKDAQ_MAX_WORKERS : workerCount;
+	for (workerNum = 0; workerNum < QUICKDAQ_MAX_WORKERS; workerNum++) {
+		cycleWorkerCpus[workerNum] = (cpuList != NULL && workerNum < cycleWorkerCount) ? cpuList[workerNum] : -1;
+	}
+}
+
+/*!
+ * \fn void buildCyclePlan()
+ * Compiles the configured task table into a flat, ordered execution plan for quickDAQcycle():
+ * all output flushes, then a single sample clock wait (hardware-timed mode only), then all input reads.
+ */
+void buildCyclePlan()
+{
+	NItask		*myTask = NULL;
+	unsigned	maxSteps = 2 * NItaskCount + 1;
+	unsigned	widestPhase = 0;
+	bool32		hasWait = FALSE;
+
+	freeCyclePlan();
+	quickDAQcyclePlan = (cycleStep*)malloc(maxSteps * sizeof(cycleStep));
+	cycleStepErrors = (int32*)malloc(maxSteps * sizeof(int32));
+	quickDAQcycleLen = 0;
+	quickDAQcycleCount = 0;
+
+	// Output flushes; a replay keeps the outputs in the task buffers
+	for (myTask = firstNItask(); myTask != NULL && quickDAQreplay == NULL; myTask = nextNItask(myTask)) {
+		if (myTask->taskType == ANALOG_OUT || myTask->taskType == DIGITAL_OUT) {
+			quickDAQcyclePlan[quickDAQcycleLen].op = (myTask->taskType == ANALOG_OUT) ? CYCLE_WRITE_ANALOG : CYCLE_WRITE_DIGITAL;
+			quickDAQcyclePlan[quickDAQcycleLen].taskHandler = myTask->taskHandler;
+			quickDAQcyclePlan[quickDAQcycleLen].task = myTask;
+			quickDAQcycleLen++;
+		}
+	}
+	quickDAQcycleWrites = quickDAQcycleLen;
+
+	// Sample clock wait on the clock master task, or on the software or replay clock (no task)
+	if (DAQmxSampleMode == HW_CLOCKED && NItaskMaster >= 0 && quickDAQreplay == NULL) {
+		myTask = &(NItaskTable[NItaskMaster]);
+		quickDAQcyclePlan[quickDAQcycleLen].op = CYCLE_WAIT_CLOCK;
+		quickDAQcyclePlan[quickDAQcycleLen].taskHandler = myTask->taskHandler;
+		quickDAQcyclePlan[quickDAQcycleLen].task = myTask;
+		quickDAQcycleLen++;
+		hasWait = TRUE;
+	}
+	else if ((DAQmxSampleMode == ON_DEMAND && DAQmxSamplingRate > 0.0) || quickDAQreplay != NULL) {
+		quickDAQcyclePlan[quickDAQcycleLen].op = CYCLE_WAIT_CLOCK;
+		quickDAQcyclePlan[quickDAQcycleLen].taskHandler = 0;
+		quickDAQcyclePlan[quickDAQcycleLen].task = NULL;
+		quickDAQcycleLen++;
+		hasWait = TRUE;
+	}
+
+	// Input reads
+	for (myTask = firstNItask(); myTask != NULL; myTask = nextNItask(myTask)) {
+		if (myTask->taskType == ANALOG_IN || myTask->taskType == CTR_ANGLE_IN) {
+			quickDAQcyclePlan[quickDAQcycleLen].op = (myTask->taskType == ANALOG_IN) ? CYCLE_READ_ANALOG : CYCLE_READ_COUNTER;
+			if (myTask->ring != NULL)
+				quickDAQcyclePlan[quickDAQcycleLen].op = CYCLE_READ_RING;
+			if (quickDAQreplay != NULL)
+				quickDAQcyclePlan[quickDAQcycleLen].op = CYCLE_READ_REPLAY;
+			quickDAQcyclePlan[quickDAQcycleLen].taskHandler = myTask->taskHandler;
+			quickDAQcyclePlan[quickDAQcycleLen].task = myTask;
+			quickDAQcycleLen++;
+		}
+	}
+	fprintf(ERRSTREAM, "Compiled cycle plan with %u steps.\n", quickDAQcycleLen);
+
+	// Workers beyond the widest phase would never get a step
+	widestPhase = quickDAQcycleLen - quickDAQcycleWrites - ((hasWait) ? 1 : 0);
+	if (quickDAQcycleWrites > widestPhase)
+		widestPhase = quickDAQcycleWrites;
+	if (cycleWorkerCount > 0 && widestPhase > 1) {
+		cycleWorkerPool = quickDAQpoolCreate(min(cycleWorkerCount, widestPhase - 1), cycleWorkerCpus);
+		if (cycleWorkerPool != NULL)
+			fprintf(ERRSTREAM, "Started %u cycle I/O worker(s) for %u tasks\n", cycleWorkerPool->workerCount, NItaskCount);
+	}
+}
+
+void freeCyclePlan()
+{
+	if (cycleWorkerPool != NULL) quickDAQpoolDestroy(cycleWorkerPool);
+	if (quickDAQcyclePlan != NULL) {
+		free(quickDAQcyclePlan);
+	}
+	if (cycleStepErrors != NULL) free(cycleStepErrors);
+	cycleWorkerPool = NULL;
+	quickDAQcyclePlan = NULL;
+	cycleStepErrors = NULL;
+	quickDAQcycleLen = 0;
+	quickDAQcycleWrites = 0;
+}
+
+// Runs one I/O step of a cycle phase. May run on a worker thread: it only touches its own task,
+// and its NI-DAQmx status is checked later on the control thread.
+static void cycleStepJob(unsigned jobNum, void* jobArg)
+{
+	cyclePhase	*phase = (cyclePhase*)jobArg;
+	cycleStep	*step = &(phase->steps[jobNum]);
+	int32		error = 0;
+	void		*outFrame = NULL;
+
+	phase->errors[jobNum] = 0;
+	if (step->task->faultCode != 0)
+		return;
+
+	switch (step->op)
+	{
+	case CYCLE_WRITE_ANALOG:
+		outFrame = missOutputFrame(step->task, phase->outputsLate);
+		if (outFrame != NULL)
+			error = DAQmxWriteAnalogF64(step->taskHandler, DAQmxDefaults.NIsamplesPerCh, DAQmxDefaults.AnalogAutoStart,
+				DAQmxDefaults.IOtimeout, DAQmxDefaults.dataLayout, (float64*)outFrame, NULL, NULL);
+		break;
+	case CYCLE_WRITE_DIGITAL:
+		outFrame = missOutputFrame(step->task, phase->outputsLate);
+		if (outFrame != NULL)
+			error = DAQmxWriteDigitalU32(step->taskHandler, DAQmxDefaults.NIsamplesPerCh, DAQmxDefaults.DigiAutoStart,
+				DAQmxDefaults.IOtimeout, DAQmxDefaults.dataLayout, (uInt32*)outFrame, NULL, NULL);
+		break;
+	case CYCLE_READ_ANALOG:
+		if (phase->extrapolate)
+			extrapolateInputs(step->task);
+		else if (step->task->rawBuffer != NULL)
+			error = readAnalogRaw(step->task);
+		else
+			error = DAQmxReadAnalogF64(step->taskHandler, DAQmxDefaults.NIAIsampsPerCh, DAQmxDefaults.IOtimeout,
+				DAQmxDefaults.AIdataLayout, (float64*)step->task->backBuffer, step->task->pinCount, NULL, NULL);
+		if (!DAQmxFailed(error)) {
+			swapTaskBuffers(step->task);
+			step->task->frameSeq++;
+			step->task->frameStale = FALSE;
+		}
+		break;
+	case CYCLE_READ_COUNTER:
+		if (phase->extrapolate)
+			extrapolateInputs(step->task);
+		else
+			error = DAQmxReadCounterF64(step->taskHandler, DAQmxDefaults.NIsamplesPerCh, DAQmxDefaults.IOtimeout,
+				(float64*)step->task->backBuffer, step->task->pinCount, NULL, NULL);
+		if (!DAQmxFailed(error))
+			swapTaskBuffers(step->task);
+		break;
+	case CYCLE_READ_REPLAY:
+		// Recorded inputs are never extrapolated, so a replay stays deterministic
+		replayReadTask(step->task);
+		swapTaskBuffers(step->task);
+		step->task->frameSeq++;
+		step->task->frameStale = FALSE;
+		break;
+	case CYCLE_READ_RING:
+		if (step->task->rawBuffer != NULL)
+			readAnalogRaw(step->task);
+		else
+			quickDAQringLatestFrame(step->task->ring, (float64*)step->task->backBuffer);
+		swapTaskBuffers(step->task);
+		step->task->frameSeq++;
+		step->task->frameStale = FALSE;
+		break;
+	default:
+		break;
+	}
+	phase->errors[jobNum] = error;
+}
+
+// Runs 'stepCnt' consecutive I/O steps, across the cycle worker pool if there is one, and returns
+// once all of them completed. Errors are checked here so the error ring keeps a single producer.
+static int runCyclePhase(cycleStep* firstStep, unsigned stepCnt, bool32 outputsLate, bool32 extrapolate)
+{
+	cyclePhase	phase;
+	unsigned	k;
+	int			status = ERROR_NONE;
+
+	phase.steps = firstStep;
+	phase.errors = cycleStepErrors + (firstStep - quickDAQcyclePlan);
+	phase.outputsLate = outputsLate;
+	phase.extrapolate = extrapolate;
+
+	if (cycleWorkerPool != NULL && stepCnt > 1)
+		quickDAQpoolRun(cycleWorkerPool, stepCnt, cycleStepJob, (void*)&phase);
+	else
+		for (k = 0; k < stepCnt; k++) cycleStepJob(k, (void*)&phase);
+
+	for (k = 0; k < stepCnt; k++) {
+		if (DAQmxFailed(phase.errors[k]))
+			status = taskErrChk(phase.errors[k], firstStep[k].task);
+		else if (firstStep[k].task->faultCode != 0)
+			status = ERROR_NIDAQMX;
+	}
+	return status;
+}
+
+/*!
+ * \fn int quickDAQcycle()
+ * Runs one control cycle by executing the plan compiled at quickDAQstart(): flushes the
+ * AO/DO task buffers, waits once for the next sample clock and reads all input tasks into
+ * their internal buffers. Use the set* functions before and the get* functions after the call.
+ * Output commands scheduled for this cycle (see scheduleAnalogOut) are applied before the flush.
+ * With cycle workers (see setCycleWorkers) the flushes and the reads of different tasks are
+ * issued concurrently.
+ * In non-fatal error mode a failing step is logged, its task is skipped until quickDAQrecover()
+ * restarts it, and the rest of the plan still runs. A faulted clock master is the exception: the
+ * cycle then returns before any output or input step. Late sample clock edges are handled by the
+ * deadline-miss policy (see setMissPolicy).
+ *
+ * \return Returns ERROR_NONE on success, ERROR_NIDAQMX if any step failed (non-fatal mode only),
+ * ERROR_REPLAYEND once a replay (see setReplay) is exhausted, or ERROR_NOTREADY if quickDAQ is
+ * not running.
+ */
+int quickDAQcycle()
+{
+	int32		error = 0;
+	int			status = ERROR_NONE, phaseStatus = ERROR_NONE;
+	cycleStep	*step = quickDAQcyclePlan + quickDAQcycleWrites;
+	cycleStep	*planEnd = quickDAQcyclePlan + quickDAQcycleLen;
+	const bool32 timed = quickDAQcycleTiming.enabled;
+	uInt64		cycleBegin = 0, waitBegin = 0, waitEnd = 0;
+	// Outputs react to a miss in the previous cycle, inputs to a miss in this one
+	bool32		outputsLate = (quickDAQmissRun > 0) ? TRUE : FALSE, inputsLate = FALSE;
+
+	if (quickDAQStatus != STATUS_RUNNING)
+		return quickDAQSetError(ERROR_NOTREADY, FALSE);
+	// Without its clock master the cycle is not paced: no I/O until quickDAQrecover() restarts it
+	if (step < planEnd && step->op == CYCLE_WAIT_CLOCK && step->task != NULL && step->task->faultCode != 0)
+		return ERROR_NIDAQMX;
+	if (timed)
+		cycleBegin = qdMonotonicNs();
+	if (quickDAQcommands != NULL)
+		applyCommands();
+
+	// Output flushes
+	status = runCyclePhase(quickDAQcyclePlan, quickDAQcycleWrites, outputsLate, FALSE);
+
+	// Sample clock wait
+	if (step < planEnd && step->op == CYCLE_WAIT_CLOCK) {
+		if (timed)
+			waitBegin = qdMonotonicNs();
+		if (quickDAQreplay != NULL)
+			error = replayTick();
+		else
+			error = (step->task != NULL) ? waitForSampleClock(step->taskHandler) : waitForSoftClock();
+		if (timed)
+			waitEnd = qdMonotonicNs();
+		// The edge never came: skip the input reads, the next cycle returns at the fault check
+		if (DAQmxFailed(error))
+			return taskErrChk(error, step->task);
+		inputsLate = recordMiss(lateSampleWarning);
+		if (quickDAQreplay != NULL && quickDAQreplay->isDone)
+			status = quickDAQSetError(ERROR_REPLAYEND, FALSE);
+		step++;
+	}
+	else
+		quickDAQclockTick++;
+
+	// Input reads; the clock edge starts a new shared AI frame, which the AI read step refreshes
+	if (NItaskAI != NULL)
+		NItaskAI->frameStale = TRUE;
+	phaseStatus = runCyclePhase(step, (unsigned)(planEnd - step), FALSE, inputsLate && missExtrapolates());
+	if (phaseStatus != ERROR_NONE)
+		status = phaseStatus;
+
+	if (timed)
+		recordCycleTiming(cycleBegin, waitBegin, waitEnd, qdMonotonicNs(), lateSampleWarning);
+	if (quickDAQdataLog != NULL)
+		logFrame();
+	quickDAQcycleCount++;
+	quickDAQbeat();
+	return status;
 }
 
 // shutdown function definitions
 int quickDAQTerminate()
 {
-	cListElem* thisElem = cListFirstElem(NItaskList);
-	cListElem *nextElem = cListNextElem (NItaskList, thisElem);
+	stopWatchdog();
+	stopDataLog();
+	stopEventSources();
+	stopBackgroundReaders();
+	stopReplay();
+	freeCounterTable();
+
 	NItask* thisTask = NULL;
 	unsigned devID;
 
-	while(thisElem != NULL) {
-		thisTask = (NItask*)thisElem->obj;
+	for (thisTask = firstNItask(); thisTask != NULL; thisTask = nextNItask(thisTask)) {
 		DAQmxErrChk(DAQmxStopTask (thisTask->taskHandler));
 		DAQmxErrChk(DAQmxClearTask(thisTask->taskHandler));
-			
-		free(thisTask);
-		
-		cListUnlinkElem(NItaskList, thisElem);
-		
-		thisElem = nextElem;
-		nextElem = cListNextElem(NItaskList, thisElem);
 	}
-	free(CItaskList);
-	free(COtaskList);
-	free(NItaskList);
+	freeCyclePlan();
+	freeTaskTable();
+	freeErrorRing();
+	freeCommandQueue();
 	
-	AItask		= NULL;
-	AOtask		= NULL;
-	DItask		= NULL;
-	DOtask		= NULL;
-	CItaskList	= NULL;
-	COtaskList	= NULL;
-	NItaskList	= NULL;
+	NItaskAI		= NULL;
+	NItaskAO		= NULL;
+	NItaskDI		= NULL;
+	NItaskDO		= NULL;
 	
 	// Reset library status
 	quickDAQSetStatus(STATUS_NASCENT, TRUE);
 	DAQmxEnumerated = 0;
 
 	// Free device list memory
+	freeDevChannelIndex();
 	for (devID = 0; devID < DAQmxMaxCount + 1; devID++) {
 		if (DAQmxDevList[devID].isDevValid == TRUE) {
 			if (DAQmxDevList[devID].AIcnt > 0) free(DAQmxDevList[devID].AIpins);
@@ -0,0 +1,124 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <cLinkedList.h>
+#include <NIDAQmx.h>
+#include <ansi_c.h>
+#include "quickDAQ_internal.h"
+#include <macrodef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------------
+// Scheduled output command function definitions
+//----------------------------------------------
+
+/*!
+ * \fn void setCommandQueue(unsigned capacity)
+ * Creates the output command queue with room for 'capacity' commands (rounded up to a power of
+ * two), or removes it if 'capacity' is 0. Once created, other threads may schedule AO/DO values
+ * for future cycles (see scheduleAnalogOut) and quickDAQcycle() applies them right before its
+ * output flush. Must be called before quickDAQstart().
+ */
+void setCommandQueue(unsigned capacity)
+{
+	if (quickDAQStatus != STATUS_INIT && quickDAQStatus != STATUS_READY) {
+		quickDAQSetError(ERROR_NOTCONFIG, TRUE);
+		return;
+	}
+	freeCommandQueue();
+	if (capacity == 0)
+		return;
+	quickDAQcommands = quickDAQqueueCreate(capacity);
+	if (quickDAQcommands == NULL)
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Unable to allocate the output command queue.\n");
+}
+
+void freeCommandQueue()
+{
+	quickDAQqueueDestroy(quickDAQcommands);
+	quickDAQcommands = NULL;
+}
+
+// Drops every queued and pending command and restarts the tick count; called by quickDAQstart()
+void resetCommandQueue()
+{
+	if (quickDAQcommands != NULL)
+		quickDAQqueueReset(quickDAQcommands);
+}
+
+// Producer side (any thread bound to the session), see quickDAQqueuePush()
+static bool enqueueCommand(quickDAQchan chan, uInt64 tick, quickDAQcommand* cmd)
+{
+	if (quickDAQcommands == NULL)
+		return FALSE;
+	cmd->tick = tick;
+	cmd->frame = chan.frame;
+	cmd->idx = chan.idx;
+	cmd->isDigital = (chan.ioMode == DIGITAL_OUT);
+	return quickDAQqueuePush(quickDAQcommands, cmd);
+}
+
+/*!
+ * \fn bool scheduleAnalogOut(quickDAQchan chan, uInt64 tick, float64 pinValue)
+ * Schedules 'pinValue' for the analog output 'chan' (see getChannelHandle) at cycle 'tick' (see
+ * getCommandTick). Lock-free; may be called from any thread bound to the session. A tick that has
+ * already passed is applied at the next cycle. Later commands for the same tick and channel win.
+ *
+ * \return Returns FALSE if there is no command queue, the channel is not an analog output or the queue is full.
+ */
+bool scheduleAnalogOut(quickDAQchan chan, uInt64 tick, float64 pinValue)
+{
+	quickDAQcommand cmd;
+
+	if (chan.frame == NULL || chan.ioMode != ANALOG_OUT)
+		return FALSE;
+	cmd.value.analog = pinValue;
+	return enqueueCommand(chan, tick, &cmd);
+}
+
+bool scheduleDigitalOut(quickDAQchan chan, uInt64 tick, uInt32 portValue)
+{
+	quickDAQcommand cmd;
+
+	if (chan.frame == NULL || chan.ioMode != DIGITAL_OUT)
+		return FALSE;
+	cmd.value.digital = portValue;
+	return enqueueCommand(chan, tick, &cmd);
+}
+
+/*!
+ * \fn uInt64 getCommandTick()
+ * Returns the earliest tick whose outputs have not been written yet; commands scheduled for it or
+ * later take effect on time, unless the clock skips it. Ticks count sample clock edges, missed
+ * ones included (one per cycle without a sample clock); tick 0 is the first cycle after quickDAQstart().
+ */
+uInt64 getCommandTick()
+{
+	return (quickDAQcommands != NULL) ? qdAtomicLoad(&quickDAQcommands->nextTick) : 0;
+}
+
+/*!
+ * \fn unsigned applyCommands()
+ * Consumer side, control thread only: moves newly queued commands into the tick-ordered heap and
+ * writes every command due at or before the current clock tick (quickDAQclockTick, advanced by the
+ * sample clock wait including missed edges) into the AO/DO task buffers, in tick then enqueue order.
+ * quickDAQcycle() calls it before its output flush; loops built on writeAnalog()/writeDigital()
+ * and syncSampling() call it once per cycle before their writes. Never allocates or locks.
+ *
+ * \return Returns the number of commands applied.
+ */
+unsigned applyCommands()
+{
+	if (quickDAQcommands == NULL)
+		return 0;
+	return quickDAQqueueApply(quickDAQcommands, quickDAQclockTick);
+}
+
+#ifdef __cplusplus
+}
+#endif
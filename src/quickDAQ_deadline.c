@@ -0,0 +1,198 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <cLinkedList.h>
+#include <NIDAQmx.h>
+#include <ansi_c.h>
+#include "quickDAQ_internal.h"
+#include <macrodef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//---------------------------------------------
+// Deadline-miss policy function definitions
+//---------------------------------------------
+
+/*!
+ * \fn void setMissPolicy(missPolicies missPolicy, unsigned missLimit)
+ * Selects how quickDAQcycle() and syncSampling() react to a late sample clock edge. 'missLimit' is
+ * the number of consecutive misses that trigger MISS_SAFE_STATE, the most edges MISS_CATCH_UP
+ * makes up in one cycle, or the most input frames MISS_EXTRAPOLATE extrapolates in a row (1 if
+ * zero). After that many, MISS_EXTRAPOLATE reads the late frame from the hardware once, so a
+ * sustained overrun stays anchored to real samples instead of drifting open-loop on the ramp.
+ * Every policy costs at most one pass over a task buffer per task.
+ * With syncSampling() the read and write functions apply the input and output policies.
+ * Must be called before quickDAQstart().
+ */
+void setMissPolicy(missPolicies missPolicy, unsigned missLimit)
+{
+	if (quickDAQStatus != STATUS_INIT && quickDAQStatus != STATUS_READY) {
+		quickDAQSetError(ERROR_NOTCONFIG, TRUE);
+		return;
+	}
+	quickDAQmissPolicy = missPolicy;
+	quickDAQmissLimit = (missLimit > 0) ? missLimit : 1;
+	quickDAQmissRun = 0;
+}
+
+/*!
+ * \fn void* missOutputFrame(NItask* task, bool32 lateCycle)
+ * Picks the frame an output task writes this cycle: the safe-state frame while the safe state is
+ * latched, nothing (NULL) or the held frame after a miss, otherwise the live frame. Under
+ * MISS_HOLD_OUTPUT the live frame is kept in 'backBuffer' as the frame to hold.
+ */
+void* missOutputFrame(NItask* task, bool32 lateCycle)
+{
+	if (quickDAQsafeState)
+		return task->safeBuffer;
+
+	switch (quickDAQmissPolicy)
+	{
+	case MISS_SKIP_OUTPUT:
+		return (lateCycle) ? NULL : task->dataBuffer;
+	case MISS_HOLD_OUTPUT:
+		if (lateCycle)
+			return task->backBuffer;
+		memcpy(task->backBuffer, task->dataBuffer, task->pinCount * taskSampleSize(task));
+		return task->dataBuffer;
+	default:
+		return task->dataBuffer;
+	}
+}
+
+/*!
+ * \fn bool32 recordMiss(bool32 late)
+ * Updates the clock tick (by the edges the wait reported, see quickDAQwaitMissed) and the miss
+ * counters after a sample clock wait, and applies the cycle-level policies: MISS_CATCH_UP advances
+ * the cycle count and MISS_SAFE_STATE escalates.
+ *
+ * \return Returns 'late'.
+ */
+bool32 recordMiss(bool32 late)
+{
+	quickDAQclockTick += 1 + quickDAQwaitMissed;
+	if (!late) {
+		quickDAQmissRun = 0;
+		quickDAQcycleMissed = 0;
+		return FALSE;
+	}
+
+	quickDAQmissRun++;
+	quickDAQmissTotal++;
+	quickDAQcycleMissed = (quickDAQwaitMissed > 0) ? quickDAQwaitMissed : 1;
+
+	if (quickDAQmissPolicy == MISS_CATCH_UP)
+		quickDAQcycleCount += (quickDAQcycleMissed < quickDAQmissLimit) ? quickDAQcycleMissed : quickDAQmissLimit;
+	else if (quickDAQmissPolicy == MISS_SAFE_STATE && quickDAQmissRun >= quickDAQmissLimit && !quickDAQsafeState)
+		enterSafeState();
+	return TRUE;
+}
+
+/*!
+ * \fn bool32 missExtrapolates()
+ * Tells whether the input reads of this cycle are replaced by extrapolation: under MISS_EXTRAPOLATE
+ * after a miss, except every ('missLimit' + 1)th consecutive late cycle, whose frame is read.
+ */
+bool32 missExtrapolates()
+{
+	return (quickDAQmissPolicy == MISS_EXTRAPOLATE && quickDAQmissRun % ((uInt64)quickDAQmissLimit + 1) != 0) ? TRUE : FALSE;
+}
+
+/*!
+ * \fn void extrapolateInputs(NItask* task)
+ * Fills the back buffer of an input task with the linear extrapolation of its two previous frames
+ * (front and back buffer) instead of reading the hardware. Swap the buffers afterwards, as for a read.
+ * Raw analog tasks extrapolate their counts (current and previous raw frame, saturated to int16)
+ * and scale the result, so 'rawBuffer' and the float frame stay the same sample.
+ */
+void extrapolateInputs(NItask* task)
+{
+	float64* lastFrame = (float64*)task->dataBuffer;
+	float64* nextFrame = (float64*)task->backBuffer;
+	int16* lastRaw = task->rawBuffer;
+	int16* prevRaw = NULL;
+	int32 count = 0;
+	unsigned k;
+
+	if (lastRaw != NULL) {
+		prevRaw = lastRaw + task->pinCount;
+		for (k = 0; k < task->pinCount; k++) {
+			count = 2 * (int32)lastRaw[k] - (int32)prevRaw[k];
+			prevRaw[k] = lastRaw[k];
+			lastRaw[k] = (int16)((count > INT16_MAX) ? INT16_MAX : ((count < INT16_MIN) ? INT16_MIN : count));
+		}
+		quickDAQscaleI16(lastRaw, task->pinCount, 1, task->scaleCoeffs, nextFrame);
+		return;
+	}
+	for (k = 0; k < task->pinCount; k++)
+		nextFrame[k] = 2.0 * lastFrame[k] - nextFrame[k];
+}
+
+/*inline*/ unsigned getMissedTicks()
+{
+	return (unsigned)quickDAQcycleMissed;
+}
+
+void setSafeAnalogOut(unsigned devNum, unsigned pinNum, float64 pinValue)
+{
+	if (quickDAQStatus == STATUS_RUNNING) {
+		unsigned pinID = DAQmxDevList[devNum].AOpins[pinNum].pinID;
+		((float64*)DAQmxDevList[devNum].AOtask->safeBuffer)[pinID] = pinValue;
+	}
+}
+
+void setSafeDigitalOut(unsigned devNum, unsigned portNum, uInt32 portValue)
+{
+	if (quickDAQStatus == STATUS_RUNNING) {
+		unsigned pinID = DAQmxDevList[devNum].DOpins[portNum].pinID;
+		((uInt32*)DAQmxDevList[devNum].DOtask->safeBuffer)[pinID] = portValue;
+	}
+}
+
+/*!
+ * \fn int enterSafeState()
+ * Writes the safe-state frames (see setSafeAnalogOut/setSafeDigitalOut) to all output tasks right
+ * away and latches them: later cycles keep writing them until clearSafeState() is called.
+ *
+ * \return Returns ERROR_NONE, or the status of the first failing write.
+ */
+int enterSafeState()
+{
+	NItask	*myTask = NULL;
+	int		status = ERROR_NONE, taskStatus = ERROR_NONE;
+
+	if (quickDAQStatus != STATUS_RUNNING)
+		return quickDAQSetError(ERROR_NOTREADY, FALSE);
+
+	qdAtomicStore(&quickDAQsafeState, TRUE);
+	fprintf(ERRSTREAM, "QuickDAQ library: Warning: Entering safe output state after %llu consecutive missed cycle(s).\n",
+		(unsigned long long)quickDAQmissRun);
+	if (quickDAQreplay != NULL)
+		return ERROR_NONE;
+
+	for (myTask = firstNItask(); myTask != NULL; myTask = nextNItask(myTask)) {
+		if (myTask->taskType == ANALOG_OUT)
+			taskStatus = taskErrChk(DAQmxWriteAnalogF64(myTask->taskHandler, DAQmxDefaults.NIsamplesPerCh, DAQmxDefaults.AnalogAutoStart,
+				DAQmxDefaults.IOtimeout, DAQmxDefaults.dataLayout, (float64*)myTask->safeBuffer, NULL, NULL), myTask);
+		else if (myTask->taskType == DIGITAL_OUT)
+			taskStatus = taskErrChk(DAQmxWriteDigitalU32(myTask->taskHandler, DAQmxDefaults.NIsamplesPerCh, DAQmxDefaults.DigiAutoStart,
+				DAQmxDefaults.IOtimeout, DAQmxDefaults.dataLayout, (uInt32*)myTask->safeBuffer, NULL, NULL), myTask);
+		if (status == ERROR_NONE)
+			status = taskStatus;
+	}
+	return status;
+}
+
+void clearSafeState()
+{
+	qdAtomicStore(&quickDAQsafeState, FALSE);
+	quickDAQmissRun = 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
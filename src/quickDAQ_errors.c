@@ -0,0 +1,198 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <cLinkedList.h>
+#include <NIDAQmx.h>
+#include <ansi_c.h>
+#include "quickDAQ_internal.h"
+#include <macrodef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//---------------------------------------------
+// Non-fatal error handling function definitions
+//---------------------------------------------
+
+/*!
+ * \fn void setNonFatalErrors(bool enable, unsigned ringSize)
+ * Switches hot-path NI-DAQmx failures (reads, writes, sample clock waits and quickDAQcycle) from
+ * terminate-and-exit to logged status codes. Each failure is pushed into a preallocated ring of
+ * 'ringSize' entries (rounded up to a power of two, 256 if zero) and marks its task as faulted.
+ * Configuration and start-up errors remain fatal. Must be called before quickDAQstart().
+ */
+void setNonFatalErrors(bool enable, unsigned ringSize)
+{
+	unsigned capacity = 2;
+
+	if (quickDAQStatus != STATUS_INIT && quickDAQStatus != STATUS_READY) {
+		quickDAQSetError(ERROR_NOTCONFIG, TRUE);
+		return;
+	}
+
+	freeErrorRing();
+	quickDAQnonFatal = (enable) ? TRUE : FALSE;
+	if (quickDAQnonFatal != TRUE)
+		return;
+
+	if (ringSize == 0)
+		ringSize = 256;
+	while (capacity < ringSize)
+		capacity <<= 1;
+
+	quickDAQerrorRing = (quickDAQerror*)qdAlignedAlloc(QD_CACHELINE, capacity * sizeof(quickDAQerror));
+	if (quickDAQerrorRing == NULL) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Unable to allocate the error ring. Errors remain fatal.\n");
+		quickDAQnonFatal = FALSE;
+		return;
+	}
+	memset(quickDAQerrorRing, 0, capacity * sizeof(quickDAQerror));
+	quickDAQerrorCap = capacity;
+}
+
+void freeErrorRing()
+{
+	if (quickDAQerrorRing != NULL)
+		qdAlignedFree(quickDAQerrorRing);
+	quickDAQerrorRing = NULL;
+	quickDAQerrorCap = 0;
+	quickDAQerrorHead = 0;
+	quickDAQerrorTail = 0;
+	quickDAQerrorDropped = 0;
+	quickDAQnonFatal = FALSE;
+}
+
+/*!
+ * \fn int taskErrChk(int32 errCode, NItask* task)
+ * Hot-path counterpart of DAQmxErrChk(). Outside of non-fatal mode it behaves like DAQmxErrChk().
+ * In non-fatal mode a failure is logged, 'task' is marked faulted and the call returns.
+ *
+ * \return Returns ERROR_NONE if 'errCode' is not a failure, ERROR_NIDAQMX otherwise.
+ */
+int taskErrChk(int32 errCode, NItask* task)
+{
+	if (!DAQmxFailed(errCode))
+		return ERROR_NONE;
+	if (quickDAQnonFatal != TRUE)
+		DAQmxErrChk(errCode);
+
+	NIDAQmxErrorCode = errCode;
+	if (task != NULL && task->faultCode == 0)
+		task->faultCode = errCode;
+	quickDAQpushError(errCode, task);
+	return quickDAQSetError(ERROR_NIDAQMX, FALSE);
+}
+
+// The control thread is the only producer; a full ring drops the newest entry.
+void quickDAQpushError(int32 errCode, NItask* task)
+{
+	uint64_t head = quickDAQerrorHead;
+	quickDAQerror* slot = NULL;
+
+	if (quickDAQerrorRing == NULL)
+		return;
+	if (head - qdAtomicLoad(&quickDAQerrorTail) >= quickDAQerrorCap) {
+		qdAtomicFetchAdd(&quickDAQerrorDropped, 1);
+		return;
+	}
+	slot = &(quickDAQerrorRing[head & (quickDAQerrorCap - 1)]);
+	slot->code = errCode;
+	slot->task = task;
+	slot->timestamp = qdMonotonicNs();
+	qdAtomicStore(&quickDAQerrorHead, head + 1);
+}
+
+/*!
+ * \fn bool quickDAQpopError(quickDAQerror* err)
+ * Copies the oldest logged error into 'err' and removes it from the ring. May be called from one
+ * thread other than the control thread, e.g. a logger.
+ *
+ * \return Returns FALSE if no error is pending.
+ */
+bool quickDAQpopError(quickDAQerror* err)
+{
+	uint64_t tail = quickDAQerrorTail;
+
+	if (quickDAQerrorRing == NULL || qdAtomicLoad(&quickDAQerrorHead) == tail)
+		return FALSE;
+	*err = quickDAQerrorRing[tail & (quickDAQerrorCap - 1)];
+	qdAtomicStore(&quickDAQerrorTail, tail + 1);
+	return TRUE;
+}
+
+/*inline*/ unsigned quickDAQpendingErrors()
+{
+	return (unsigned)(qdAtomicLoad(&quickDAQerrorHead) - qdAtomicLoad(&quickDAQerrorTail));
+}
+
+/*!
+ * \fn int recoverTask(NItask* task)
+ * Stops and restarts one task in place. Tasks are committed at quickDAQstart(), so stopping returns
+ * them to the committed state and the restart reuses their reserved resources: no channels are
+ * recreated and no devices are enumerated again. Other tasks keep running meanwhile.
+ *
+ * \return Returns ERROR_NONE if the task is running again, ERROR_NIDAQMX otherwise.
+ */
+int recoverTask(NItask* task)
+{
+	int32 error = 0;
+
+	if (task->ring != NULL && task->eventDriven != TRUE)
+		quickDAQringStopReader(task->ring);
+
+	error = DAQmxStopTask(task->taskHandler);
+	if (!DAQmxFailed(error))
+		error = DAQmxStartTask(task->taskHandler);
+	if (DAQmxFailed(error)) {
+		NIDAQmxErrorCode = error;
+		quickDAQpushError(error, task);
+		return quickDAQSetError(ERROR_NIDAQMX, FALSE);
+	}
+
+	if (task->ring != NULL) {
+		quickDAQringSetReaderError(task->ring, 0);
+		if (task->eventDriven != TRUE && quickDAQringStartReader(task->ring) != 0) {
+			fprintf(ERRSTREAM, "QuickDAQ library: Warning: Unable to restart background reader thread.\n");
+			return quickDAQSetError(ERROR_UNKNOWN, FALSE);
+		}
+	}
+	task->faultCode = 0;
+	return ERROR_NONE;
+}
+
+/*!
+ * \fn int quickDAQrecover()
+ * Restarts every faulted task (see recoverTask), including tasks whose background reader stopped
+ * on an error. Call from the control thread between cycles. The error ring is left untouched.
+ *
+ * \return Returns ERROR_NONE if all faulted tasks were recovered, an error code otherwise.
+ */
+int quickDAQrecover()
+{
+	NItask	*myTask = NULL;
+	int		status = ERROR_NONE, taskStatus = ERROR_NONE;
+
+	if (quickDAQStatus != STATUS_RUNNING)
+		return quickDAQSetError(ERROR_NOTREADY, FALSE);
+
+	for (myTask = firstNItask(); myTask != NULL; myTask = nextNItask(myTask)) {
+		if (myTask->ring != NULL && quickDAQringReaderError(myTask->ring) != 0 && myTask->faultCode == 0) {
+			myTask->faultCode = quickDAQringReaderError(myTask->ring);
+			quickDAQpushError(myTask->faultCode, myTask);
+		}
+		if (myTask->faultCode == 0)
+			continue;
+
+		taskStatus = recoverTask(myTask);
+		if (taskStatus != ERROR_NONE)
+			status = taskStatus;
+	}
+	return status;
+}
+
+#ifdef __cplusplus
+}
+#endif
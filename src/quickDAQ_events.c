@@ -0,0 +1,314 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <cLinkedList.h>
+#include <NIDAQmx.h>
+#include <ansi_c.h>
+#include "quickDAQ_internal.h"
+#include <macrodef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-------------------------------------------
+// Event-driven acquisition Global Definitions
+//-------------------------------------------
+// Dispatcher state of the session
+#define eventSourcesUp		(quickDAQactiveSession->eventsUp)
+#define dispatchThread		(quickDAQactiveSession->eventThread)
+#define dispatchEvent		(quickDAQactiveSession->eventWake)
+#define dispatchRunning		(quickDAQactiveSession->eventRunning)
+#define doneSignalled		(quickDAQactiveSession->eventDone)
+#define doneStatus			(quickDAQactiveSession->eventDoneStatus)
+
+//----------------------------------------------
+// Event-driven acquisition function definitions
+//----------------------------------------------
+
+static int addEventHandler(NItask* task, int devNum, unsigned nSamples, quickDAQblockHandler onBlock, quickDAQdoneHandler onDone, void* userData)
+{
+	unsigned k;
+
+	if (quickDAQStatus != STATUS_INIT && quickDAQStatus != STATUS_READY)
+		return quickDAQSetError(ERROR_NOTCONFIG, TRUE);
+	if (quickDAQeventHandlerCnt >= QUICKDAQ_MAX_EVENT_HANDLERS) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: No more than %d event handlers can be registered.\n", QUICKDAQ_MAX_EVENT_HANDLERS);
+		return quickDAQSetError(ERROR_UNSUPPORTED, FALSE);
+	}
+
+	// NI-DAQmx allows one Every N Samples registration per task
+	for (k = 0; k < quickDAQeventHandlerCnt; k++) {
+		if (task != NULL && quickDAQeventHandlers[k].task == task && quickDAQeventHandlers[k].nSamples != nSamples) {
+			fprintf(ERRSTREAM, "QuickDAQ library: Warning: Handlers of one task must use the same block size (%u samples).\n",
+				quickDAQeventHandlers[k].nSamples);
+			return quickDAQSetError(ERROR_UNSUPPORTED, FALSE);
+		}
+	}
+
+	quickDAQeventHandlers[quickDAQeventHandlerCnt].task = task;
+	quickDAQeventHandlers[quickDAQeventHandlerCnt].devNum = devNum;
+	quickDAQeventHandlers[quickDAQeventHandlerCnt].nSamples = nSamples;
+	quickDAQeventHandlers[quickDAQeventHandlerCnt].onBlock = onBlock;
+	quickDAQeventHandlers[quickDAQeventHandlerCnt].onDone = onDone;
+	quickDAQeventHandlers[quickDAQeventHandlerCnt].userData = userData;
+	quickDAQeventHandlerCnt++;
+	return ERROR_NONE;
+}
+
+/*!
+ * \fn int registerAnalogInHandler(unsigned devNum, unsigned nSamples, quickDAQblockHandler handler, void* userData)
+ * Registers 'handler' to receive every block of 'nSamples' scans of the device's analog inputs.
+ * The block view covers this device's channels only, in pin order. Call after pinMode() and
+ * before quickDAQstart(); requires a buffered (CONTINUOUS or FINITE) sample mode.
+ */
+int registerAnalogInHandler(unsigned devNum, unsigned nSamples, quickDAQblockHandler handler, void* userData)
+{
+	if (devNum > DAQmxMaxCount || DAQmxDevList[devNum].AItask == NULL || handler == NULL || nSamples == 0)
+		return quickDAQSetError(ERROR_INVIO, TRUE);
+	return addEventHandler(DAQmxDevList[devNum].AItask, (int)devNum, nSamples, handler, NULL, userData);
+}
+
+int registerCounterHandler(unsigned devNum, unsigned ctrNum, unsigned nSamples, quickDAQblockHandler handler, void* userData)
+{
+	if (devNum > DAQmxMaxCount || ctrNum >= DAQmxDevList[devNum].CIcnt || DAQmxDevList[devNum].CItask[ctrNum] == NULL
+		|| handler == NULL || nSamples == 0)
+		return quickDAQSetError(ERROR_INVIO, TRUE);
+	return addEventHandler(DAQmxDevList[devNum].CItask[ctrNum], -1, nSamples, handler, NULL, userData);
+}
+
+/*!
+ * \fn int registerDoneHandler(quickDAQdoneHandler handler, void* userData)
+ * Registers 'handler' to be called with the task status when the clock master task finishes,
+ * e.g. at the end of a FINITE acquisition or when it stops on an error.
+ */
+int registerDoneHandler(quickDAQdoneHandler handler, void* userData)
+{
+	if (handler == NULL)
+		return quickDAQSetError(ERROR_INVIO, TRUE);
+	return addEventHandler(NULL, -1, 0, NULL, handler, userData);
+}
+
+void clearEventHandlers()
+{
+	if (quickDAQStatus != STATUS_INIT && quickDAQStatus != STATUS_READY) {
+		quickDAQSetError(ERROR_NOTCONFIG, TRUE);
+		return;
+	}
+	quickDAQeventHandlerCnt = 0;
+}
+
+// Driver callbacks run on NI-DAQmx threads, so they reach the session through their callback data.
+// Every N Samples callbacks are serialized per task, making the callback the only producer of the ring.
+static int32 CVICALLBACK everyNSamplesCallback(TaskHandle taskHandle, int32 everyNsamplesEventType, uInt32 nSamples, void* callbackData)
+{
+	NItask*	task = (NItask*)callbackData;
+	int32	error = quickDAQringFill(task->ring);
+
+	(void)taskHandle;
+	(void)everyNsamplesEventType;
+	(void)nSamples;
+	if (DAQmxFailed(error))
+		quickDAQringSetReaderError(task->ring, error);
+	qdEventSignal(&(task->ring->session->eventWake));
+	return 0;
+}
+
+static int32 CVICALLBACK doneCallback(TaskHandle taskHandle, int32 status, void* callbackData)
+{
+	quickDAQSession* session = (quickDAQSession*)callbackData;
+
+	(void)taskHandle;
+	session->eventDoneStatus = status;
+	qdAtomicStore(&(session->eventDone), 1);
+	qdEventSignal(&(session->eventWake));
+	return 0;
+}
+
+static void dispatchBlock(NItask* task, const float64* block)
+{
+	quickDAQblockView	view;
+	unsigned			k;
+
+	view.data = block;
+	view.stride = task->ring->chanCount;
+	view.scans = task->ring->blockScans;
+	view.blockSeq = task->ring->tail;
+
+	for (k = 0; k < quickDAQeventHandlerCnt; k++) {
+		if (quickDAQeventHandlers[k].task != task || quickDAQeventHandlers[k].onBlock == NULL)
+			continue;
+		if (quickDAQeventHandlers[k].devNum >= 0 && task->taskType == ANALOG_IN) {
+			view.chanIdx = DAQmxDevList[quickDAQeventHandlers[k].devNum].AIchanIdx;
+			view.len = DAQmxDevList[quickDAQeventHandlers[k].devNum].AIchanCnt;
+		}
+		else {
+			view.chanIdx = NULL;
+			view.len = view.stride;
+		}
+		quickDAQeventHandlers[k].onBlock(view, quickDAQeventHandlers[k].userData);
+	}
+}
+
+// Dispatcher thread: the only consumer of the event rings; runs all handlers in registration order
+static QD_THREAD_FUNC(eventDispatchThread, arg)
+{
+	NItask			*myTask = NULL;
+	const float64	*block = NULL;
+	bool32			isIdle = TRUE;
+	unsigned		k;
+
+	quickDAQsetSession((quickDAQSession*)arg);
+	while (qdAtomicLoad(&dispatchRunning)) {
+		isIdle = TRUE;
+		for (myTask = firstNItask(); myTask != NULL; myTask = nextNItask(myTask)) {
+			if (myTask->eventDriven != TRUE)
+				continue;
+			while ((block = quickDAQringPeekBlock(myTask->ring)) != NULL) {
+				dispatchBlock(myTask, block);
+				quickDAQringReleaseBlock(myTask->ring);
+				isIdle = FALSE;
+			}
+		}
+		if (qdAtomicLoad(&doneSignalled)) {
+			qdAtomicStore(&doneSignalled, 0);
+			for (k = 0; k < quickDAQeventHandlerCnt; k++) {
+				if (quickDAQeventHandlers[k].onDone != NULL)
+					quickDAQeventHandlers[k].onDone(doneStatus, quickDAQeventHandlers[k].userData);
+			}
+			isIdle = FALSE;
+		}
+		if (isIdle)
+			qdEventWait(&dispatchEvent, QUICKDAQ_EVENT_IDLE_MS);
+	}
+	QD_THREAD_RETURN;
+}
+
+/*!
+ * \fn void startEventSources()
+ * Called by quickDAQstart() before the tasks are committed. Gives every task with block handlers a
+ * preallocated block ring filled by an NI-DAQmx Every N Samples callback, registers the done
+ * callback on the clock master task and starts the dispatcher thread. Blocks never allocate:
+ * a full ring drops the newest block, as for background readers.
+ */
+void startEventSources()
+{
+	NItask		*myTask = NULL;
+	unsigned	k, nSamples = 0;
+	bool32		hasDoneHandler = FALSE;
+
+	if (quickDAQeventHandlerCnt == 0)
+		return;
+	if (quickDAQreplay != NULL) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Event handlers are off while replaying.\n");
+		return;
+	}
+	if (DAQmxSampleMode == HW_CLOCKED) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Event handlers require CONTINUOUS or FINITE sampling mode. Ignored.\n");
+		return;
+	}
+	eventSourcesUp = TRUE;
+	doneSignalled = 0;
+	if (qdEventInit(&dispatchEvent) != 0) {
+		fprintf(ERRSTREAM, "QuickDAQ library: FATAL: Unable to create the event dispatcher.\n");
+		quickDAQTerminate();
+		quickDAQSetStatus(STATUS_UNKNOWN, FALSE);
+		quickDAQSetError(ERROR_UNKNOWN, TRUE);
+		exit(quickDAQErrorCode);
+	}
+
+	for (myTask = firstNItask(); myTask != NULL; myTask = nextNItask(myTask)) {
+		nSamples = 0;
+		for (k = 0; k < quickDAQeventHandlerCnt; k++) {
+			if (quickDAQeventHandlers[k].task == myTask)
+				nSamples = quickDAQeventHandlers[k].nSamples;
+		}
+		if (nSamples == 0)
+			continue;
+
+		myTask->ring = quickDAQringCreate(myTask, nSamples, quickDAQbgRingBlocks);
+		if (myTask->ring == NULL) {
+			fprintf(ERRSTREAM, "QuickDAQ library: FATAL: Unable to allocate an event block ring.\n");
+			quickDAQTerminate();
+			quickDAQSetStatus(STATUS_UNKNOWN, FALSE);
+			quickDAQSetError(ERROR_UNKNOWN, TRUE);
+			exit(quickDAQErrorCode);
+		}
+		myTask->eventDriven = TRUE;
+		DAQmxErrChk(DAQmxRegisterEveryNSamplesEvent(myTask->taskHandler, DAQmx_Val_Acquired_Into_Buffer, nSamples, 0,
+			everyNSamplesCallback, (void*)myTask));
+		fprintf(ERRSTREAM, "Registered event source: %u scans x %u channels per block, %u blocks\n",
+			myTask->ring->blockScans, myTask->ring->chanCount, myTask->ring->blockCount);
+	}
+
+	for (k = 0; k < quickDAQeventHandlerCnt; k++) {
+		if (quickDAQeventHandlers[k].onDone != NULL)
+			hasDoneHandler = TRUE;
+	}
+	if (hasDoneHandler && NItaskMaster >= 0)
+		DAQmxErrChk(DAQmxRegisterDoneEvent(NItaskTable[NItaskMaster].taskHandler, 0, doneCallback, (void*)quickDAQactiveSession));
+
+	qdAtomicStore(&dispatchRunning, 1);
+	if (qdThreadCreate(&dispatchThread, eventDispatchThread, (void*)quickDAQactiveSession) != 0) {
+		qdAtomicStore(&dispatchRunning, 0);
+		fprintf(ERRSTREAM, "QuickDAQ library: FATAL: Unable to start the event dispatcher thread.\n");
+		quickDAQTerminate();
+		quickDAQSetStatus(STATUS_UNKNOWN, FALSE);
+		quickDAQSetError(ERROR_UNKNOWN, TRUE);
+		exit(quickDAQErrorCode);
+	}
+}
+
+/*!
+ * \fn void stopEventSources()
+ * Stops the event-driven tasks (so no callback is in flight), joins the dispatcher thread, then
+ * unregisters the callbacks and frees the event rings.
+ */
+void stopEventSources()
+{
+	NItask		*myTask = NULL;
+	unsigned	k;
+
+	if (eventSourcesUp != TRUE)
+		return;
+	eventSourcesUp = FALSE;
+
+	for (myTask = firstNItask(); myTask != NULL; myTask = nextNItask(myTask)) {
+		if (myTask->eventDriven == TRUE)
+			DAQmxStopTask(myTask->taskHandler);
+	}
+	if (NItaskMaster >= 0)
+		DAQmxStopTask(NItaskTable[NItaskMaster].taskHandler);
+
+	if (qdAtomicLoad(&dispatchRunning)) {
+		qdAtomicStore(&dispatchRunning, 0);
+		qdEventSignal(&dispatchEvent);
+		qdThreadJoin(dispatchThread);
+	}
+	qdEventDestroy(&dispatchEvent);
+
+	for (myTask = firstNItask(); myTask != NULL; myTask = nextNItask(myTask)) {
+		if (myTask->eventDriven != TRUE)
+			continue;
+		DAQmxRegisterEveryNSamplesEvent(myTask->taskHandler, DAQmx_Val_Acquired_Into_Buffer, 0, 0, NULL, NULL);
+		if (quickDAQringReaderError(myTask->ring) != 0 || myTask->ring->droppedBlocks != 0) {
+			fprintf(ERRSTREAM, "QuickDAQ library: Warning: Event source stopped with NI-DAQmx error %ld (%llu blocks dropped).\n",
+				(long)quickDAQringReaderError(myTask->ring), (unsigned long long)myTask->ring->droppedBlocks);
+		}
+		quickDAQringDestroy(myTask->ring);
+		myTask->ring = NULL;
+		myTask->eventDriven = FALSE;
+	}
+	for (k = 0; k < quickDAQeventHandlerCnt; k++) {
+		if (quickDAQeventHandlers[k].onDone != NULL && NItaskMaster >= 0) {
+			DAQmxRegisterDoneEvent(NItaskTable[NItaskMaster].taskHandler, 0, NULL, NULL);
+			break;
+		}
+	}
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,82 @@
+#include <stdint.h>
+#include <quickDAQ_platform.h>
+#include <quickDAQ_hist.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------
+// Timing histogram function definitions
+//------------------------------------
+
+// Bucket index: values below 2^(SUB_BITS+1) map one to one, larger values keep SUB_BITS bits
+// below their leading bit.
+static unsigned histIndex(uint64_t value)
+{
+	unsigned shift = 0;
+
+	if (value >= ((uint64_t)1 << QUICKDAQ_HIST_MAX_BITS))
+		value = ((uint64_t)1 << QUICKDAQ_HIST_MAX_BITS) - 1;
+	if (value < ((uint64_t)2 << QUICKDAQ_HIST_SUB_BITS))
+		return (unsigned)value;
+
+	shift = qdLog2u64(value) - QUICKDAQ_HIST_SUB_BITS;
+	return ((shift + 1) << QUICKDAQ_HIST_SUB_BITS) + (unsigned)((value >> shift) - ((uint64_t)1 << QUICKDAQ_HIST_SUB_BITS));
+}
+
+// Highest value that maps into bucket 'idx'
+static uint64_t histBucketTop(unsigned idx)
+{
+	unsigned shift = 0;
+	uint64_t sub = 0;
+
+	if (idx < (2u << QUICKDAQ_HIST_SUB_BITS))
+		return idx;
+	shift = (idx >> QUICKDAQ_HIST_SUB_BITS) - 1;
+	sub = (idx & ((1u << QUICKDAQ_HIST_SUB_BITS) - 1)) + ((uint64_t)1 << QUICKDAQ_HIST_SUB_BITS);
+	return ((sub + 1) << shift) - 1;
+}
+
+void quickDAQhistRecord(quickDAQhist* hist, uint64_t value)
+{
+	if (hist->count == 0 || value < hist->min)
+		hist->min = value;
+	if (value > hist->max)
+		hist->max = value;
+	hist->count++;
+	hist->sum += value;
+	hist->bucket[histIndex(value)]++;
+}
+
+/*!
+ * \fn uint64_t quickDAQhistPercentile(const quickDAQhist* hist, double percentile)
+ * Returns the value below which 'percentile' percent (0-100) of the recorded values fall, to within
+ * the bucket resolution. Returns 0 for an empty histogram.
+ */
+uint64_t quickDAQhistPercentile(const quickDAQhist* hist, double percentile)
+{
+	uint64_t target = 0, seen = 0, top = 0;
+	unsigned idx = 0;
+
+	if (hist->count == 0)
+		return 0;
+	if (percentile >= 100.0)
+		return hist->max;
+
+	target = (uint64_t)((percentile / 100.0) * (double)hist->count + 0.5);
+	if (target < 1)
+		target = 1;
+	for (idx = 0; idx < QUICKDAQ_HIST_BUCKETS; idx++) {
+		seen += hist->bucket[idx];
+		if (seen >= target) {
+			top = histBucketTop(idx);
+			return (top < hist->max) ? top : hist->max;
+		}
+	}
+	return hist->max;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,292 @@
+#pragma once
+#ifndef QUICKDAQ_INTERNAL_H
+#define QUICKDAQ_INTERNAL_H
+
+/* Library side of quickDAQ.h: the platform layer, the session run-time state and the names that
+* resolve to it. Included by the library sources only.
+*/
+
+#ifdef __cplusplus 
+extern "C" {
+#endif
+
+#include <quickDAQ_platform.h>
+#include <quickDAQ.h>
+#include <quickDAQ_queue.h>
+#include <quickDAQ_workers.h>
+#include <quickDAQ_tdms.h>
+#include <quickDAQ_logwriter.h>
+#include <quickDAQ_logreader.h>
+
+//-------------------------------
+// quickDAQ Private TypeDef List
+//-------------------------------
+
+/*!
+* Defines a single-producer/single-consumer ring of sample blocks for a task.
+* A background reader thread (producer) drains the driver into the ring in blocks
+* of 'blockScans' scans, interleaved by scan. The application (consumer) pulls
+* blocks or the latest frame without ever calling into the driver.
+*/
+struct _quickDAQring {
+	// Producer-owned cache line: number of blocks published
+	volatile uint64_t	head;
+	char				headPad[QD_CACHELINE - sizeof(uint64_t)];
+	// Consumer-owned cache line: number of blocks released
+	volatile uint64_t	tail;
+	char				tailPad[QD_CACHELINE - sizeof(uint64_t)];
+
+	// Ring geometry, read-only after creation. Raw analog rings hold int16 counts in 'rawBlocks'
+	// instead of 'blocks' and scale them into 'scaled' for float consumers.
+	float64				*blocks;
+	float64				*scratch;
+	int16				*rawBlocks;
+	int16				*rawScratch;
+	float64				*scaled;
+	unsigned			blockScans;
+	unsigned			chanCount;
+	unsigned			blockStride;	// samples per block slot, padded to a cache line
+	unsigned			blockCount;		// power of two
+
+	// Latest scan, rewritten by every fill even when the ring is full, so latest-frame consumers
+	// never depend on anyone releasing blocks. 'latestSeq' is a sequence lock: odd while writing.
+	volatile uint64_t	latestSeq;
+	float64				*latest;
+	int16				*rawLatest;
+
+	// Reader thread state
+	struct _NItask		*task;
+	qdThread			thread;
+	volatile uint64_t	isRunning;
+	volatile uint64_t	droppedBlocks;
+	// First NI-DAQmx error of the producer (int32 code), see quickDAQringReaderError()
+	volatile uint64_t	readerError;
+	// Owning session, for driver callbacks
+	struct _quickDAQSession	*session;
+};
+
+/*!
+* Defines the seqlock-published copy of an input task's latest frame. The thread that reads the
+* task is the only writer; any number of threads may take snapshots without blocking it.
+*/
+struct _quickDAQframePub {
+	// Odd while a frame is being written; seq/2 frames have been published
+	volatile uint64_t	seq;
+	char				seqPad[QD_CACHELINE - sizeof(uint64_t)];
+
+	uInt64				timestamp;		// qdMonotonicNs() at publication
+	unsigned			chanCount;
+	float64				*data;
+};
+
+/*!
+* Defines a quickDAQ session: the devices, tasks, timing, status and run-time state of one
+* acquisition configuration. Every quickDAQ function works on the session bound to the
+* calling thread (see quickDAQsetSession), which is the default session unless changed.
+*/
+struct QD_CACHE_ALIGNED _quickDAQSession {
+	// Public part: status, devices and sampling, shared tasks
+	quickDAQSessionInfo	info;
+
+	// NI-DAQmx subsystem tasks
+	NItask				*taskTable;
+	unsigned			taskCapacity;
+	unsigned			taskCount;
+	NItaskGroup			taskGroups[NITASK_GROUP_CNT];
+	int					taskMaster;
+
+	// Event-driven acquisition
+	quickDAQeventHandler	eventHandlers[QUICKDAQ_MAX_EVENT_HANDLERS];
+	unsigned				eventHandlerCnt;
+	bool32					eventsUp;
+	qdThread				eventThread;
+	qdEvent					eventWake;
+	volatile uint64_t		eventRunning;
+	volatile uint64_t		eventDone;
+	volatile int32			eventDoneStatus;
+
+	// Non-fatal error handling
+	bool32				nonFatal;
+	quickDAQerror		*errorRing;
+	unsigned			errorCap;
+	volatile uint64_t	errorHead, errorTail;
+	volatile uint64_t	errorDropped;
+
+	// Frame snapshots
+	bool32				framePublish;
+
+	// Raw analog input
+	bool32				rawAnalogIn;
+
+	// Scheduled output commands
+	quickDAQcommandQueue	*commandQueue;
+
+	// Data logging
+	quickDAQlog				*dataLog;
+	char					logPath[DAQMX_MAX_STR_LEN];
+	unsigned				logChunkRows;
+	unsigned				logChunkCount;
+	logFormats				logFormat;
+
+	// Replay source
+	quickDAQreplaySource	*replay;
+	char					replayPath[DAQMX_MAX_STR_LEN];
+	replayModes				replayMode;
+
+	// Loop watchdog; the heartbeat has its own cache line. 'beatCount' is the control thread's own
+	// count, published to the watchdog through 'heartbeat'.
+	char					heartbeatPad0[QD_CACHELINE];
+	volatile uint64_t		heartbeat;
+	uint64_t				beatCount;
+	char					heartbeatPad1[QD_CACHELINE - 2 * sizeof(uint64_t)];
+	unsigned				watchdogTicks;
+	quickDAQwatchdogHandler	watchdogHandler;
+	void					*watchdogUserData;
+	qdThread				watchdogThread;
+	qdEvent					watchdogWake;
+	volatile uint64_t		watchdogRunning;
+	volatile uint64_t		watchdogTrips;
+
+	// Background acquisition settings
+	bool32				bgReadEnable;
+	unsigned			bgBlockScans;
+	unsigned			bgRingBlocks;
+
+	// Grouped counter reads
+	NItask				**ctrReadList;
+	unsigned			ctrReadCnt;
+	float64				*ctrAngles;
+	int32				*ctrReadErrors;
+	quickDAQworkerPool	*ctrWorkerPool;
+	unsigned			ctrWorkerCount;
+	int					ctrWorkerCpus[QUICKDAQ_MAX_WORKERS];
+
+	// Cycle engine execution plan
+	cycleStep			*cyclePlan;
+	unsigned			cycleLen;
+	uInt64				cycleCount;
+	unsigned			cycleWrites;
+	quickDAQworkerPool	*ioWorkerPool;
+	unsigned			ioWorkerCount;
+	int					ioWorkerCpus[QUICKDAQ_MAX_WORKERS];
+	int32				*ioStepErrors;
+
+	// Cycle timing recorder
+	quickDAQtiming		timing;
+
+	// Sample clock wait strategy
+	waitModes			waitMode;
+	uInt64				waitSpinNs;
+	NItask				*waitTask;
+	uInt64				waitMissed;
+	// Sample clock edges since quickDAQstart(), missed ones included: the output command tick
+	uInt64				clockTick;
+	uInt64				waitPrevTotal;
+	uInt64				waitPrevEdge;
+	bool32				waitIsPrimed;
+	uInt64				softEpoch;
+	uInt64				softTick;
+
+	// Deadline-miss policy
+	missPolicies		missPolicy;
+	unsigned			missLimit;
+	uInt64				missRun;
+	uInt64				missTotal;
+	uInt64				cycleMissed;
+	volatile uint64_t	safeState;
+};
+
+//-------------------------------
+// quickDAQ Private Declarations
+//-------------------------------
+extern quickDAQSession			quickDAQdefaultSession;
+
+// NI-DAQmx subsystem tasks
+#define NItaskTable					(quickDAQactiveSession->taskTable)
+#define NItaskCapacity				(quickDAQactiveSession->taskCapacity)
+#define NItaskCount					(quickDAQactiveSession->taskCount)
+#define NItaskGroups				(quickDAQactiveSession->taskGroups)
+#define NItaskMaster				(quickDAQactiveSession->taskMaster)
+
+// Event-driven acquisition
+#define quickDAQeventHandlers		(quickDAQactiveSession->eventHandlers)
+#define quickDAQeventHandlerCnt		(quickDAQactiveSession->eventHandlerCnt)
+
+// Non-fatal error handling
+#define quickDAQnonFatal			(quickDAQactiveSession->nonFatal)
+#define quickDAQerrorRing			(quickDAQactiveSession->errorRing)
+#define quickDAQerrorCap			(quickDAQactiveSession->errorCap)
+#define quickDAQerrorHead			(quickDAQactiveSession->errorHead)
+#define quickDAQerrorTail			(quickDAQactiveSession->errorTail)
+#define quickDAQerrorDropped		(quickDAQactiveSession->errorDropped)
+
+// Frame snapshots
+#define quickDAQframePublish		(quickDAQactiveSession->framePublish)
+
+// Raw analog input
+#define quickDAQrawAnalogIn			(quickDAQactiveSession->rawAnalogIn)
+
+// Scheduled output commands
+#define quickDAQcommands			(quickDAQactiveSession->commandQueue)
+
+// Data logging
+#define quickDAQdataLog				(quickDAQactiveSession->dataLog)
+
+// Replay source
+#define quickDAQreplay				(quickDAQactiveSession->replay)
+
+// Loop watchdog
+#define quickDAQheartbeat			(quickDAQactiveSession->heartbeat)
+#define quickDAQbeatCount			(quickDAQactiveSession->beatCount)
+
+// Background acquisition settings
+#define quickDAQbgReadEnable		(quickDAQactiveSession->bgReadEnable)
+#define quickDAQbgBlockScans		(quickDAQactiveSession->bgBlockScans)
+#define quickDAQbgRingBlocks		(quickDAQactiveSession->bgRingBlocks)
+
+// Grouped counter reads
+#define CIreadList					(quickDAQactiveSession->ctrReadList)
+#define CIreadCnt					(quickDAQactiveSession->ctrReadCnt)
+#define CIangles					(quickDAQactiveSession->ctrAngles)
+#define CIworkerPool				(quickDAQactiveSession->ctrWorkerPool)
+#define CIworkerCount				(quickDAQactiveSession->ctrWorkerCount)
+#define CIworkerCpus				(quickDAQactiveSession->ctrWorkerCpus)
+
+// Cycle engine execution plan
+#define quickDAQcyclePlan			(quickDAQactiveSession->cyclePlan)
+#define quickDAQcycleLen			(quickDAQactiveSession->cycleLen)
+#define quickDAQcycleCount			(quickDAQactiveSession->cycleCount)
+#define quickDAQcycleWrites			(quickDAQactiveSession->cycleWrites)
+#define cycleWorkerPool				(quickDAQactiveSession->ioWorkerPool)
+#define cycleWorkerCount			(quickDAQactiveSession->ioWorkerCount)
+#define cycleWorkerCpus				(quickDAQactiveSession->ioWorkerCpus)
+
+// Cycle timing recorder
+#define quickDAQcycleTiming			(quickDAQactiveSession->timing)
+
+// Sample clock wait strategy
+#define quickDAQwaitMode			(quickDAQactiveSession->waitMode)
+#define quickDAQwaitSpinNs			(quickDAQactiveSession->waitSpinNs)
+#define quickDAQwaitTask			(quickDAQactiveSession->waitTask)
+#define quickDAQwaitMissed			(quickDAQactiveSession->waitMissed)
+#define quickDAQclockTick			(quickDAQactiveSession->clockTick)
+
+// Deadline-miss policy
+#define quickDAQmissPolicy			(quickDAQactiveSession->missPolicy)
+#define quickDAQmissLimit			(quickDAQactiveSession->missLimit)
+#define quickDAQmissRun				(quickDAQactiveSession->missRun)
+#define quickDAQmissTotal			(quickDAQactiveSession->missTotal)
+#define quickDAQcycleMissed			(quickDAQactiveSession->cycleMissed)
+#define quickDAQsafeState			(quickDAQactiveSession->safeState)
+
+//----------------------------
+// quickDAQ Private Functions
+//----------------------------
+// worker pool functions
+quickDAQworkerPool* quickDAQpoolCreate(unsigned workerCount, const int* cpuList);
+
+#ifdef __cplusplus 
+}
+#endif 
+
+#endif // !QUICKDAQ_INTERNAL_H
@@ -0,0 +1,232 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <cLinkedList.h>
+#include <NIDAQmx.h>
+#include <ansi_c.h>
+#include "quickDAQ_internal.h"
+#include <macrodef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//---------------------------------
+// Data logging Global Definitions
+//---------------------------------
+// Data logging settings of the session
+#define logFilePath		(quickDAQactiveSession->logPath)
+#define logChunkRowCnt	(quickDAQactiveSession->logChunkRows)
+#define logChunkCnt		(quickDAQactiveSession->logChunkCount)
+#define logFileFormat	(quickDAQactiveSession->logFormat)
+
+//------------------------------------
+// Data logging function definitions
+//------------------------------------
+
+/*!
+ * \fn void setDataLogging(const char* filePath, unsigned chunkRows, unsigned chunkCount)
+ * Logs every cycle to 'filePath' while quickDAQ runs, or stops logging if 'filePath' is NULL.
+ * Each row holds the cycle number and the value of every configured AI, counter, AO and DO
+ * channel (in device and pin order). Rows are collected in chunks of 'chunkRows' rows (rounded up
+ * to a multiple of 8) in a pool of 'chunkCount' chunks (rounded up to a power of two) that a
+ * writer thread stores column by column; see quickDAQlogHeader for the file layout, or
+ * setDataLogFormat for TDMS. Pass 0 to keep the current chunk sizes. Must be called before
+ * quickDAQstart().
+ */
+void setDataLogging(const char* filePath, unsigned chunkRows, unsigned chunkCount)
+{
+	if (quickDAQStatus != STATUS_INIT && quickDAQStatus != STATUS_READY) {
+		quickDAQSetError(ERROR_NOTCONFIG, TRUE);
+		return;
+	}
+	if (filePath == NULL)
+		logFilePath[0] = '\0';
+	else
+		snprintf(logFilePath, DAQMX_MAX_STR_LEN, "%s", filePath);
+	if (chunkRows > 0)
+		logChunkRowCnt = ((chunkRows + 7) / 8) * 8;
+	if (chunkCount > 1)
+		logChunkCnt = chunkCount;
+}
+
+/*!
+ * \fn void setDataLogFormat(logFormats format)
+ * Selects the data log file format. LOG_TDMS writes an NI TDMS 2.0 file (one channel group per
+ * device plus a 'quickDAQ' group holding the cycle number) that NI tools open directly, without
+ * NI-DAQmx logging. Must be called before quickDAQstart().
+ */
+void setDataLogFormat(logFormats format)
+{
+	if (quickDAQStatus != STATUS_INIT && quickDAQStatus != STATUS_READY) {
+		quickDAQSetError(ERROR_NOTCONFIG, TRUE);
+		return;
+	}
+	logFileFormat = format;
+}
+
+// Places a task frame in the log row, once per frame: rows hold every logged frame back to back
+static uint32_t logRowFrame(quickDAQlog* log, void** frame, size_t frameBytes)
+{
+	quickDAQlogFrame	*rowFrame = NULL;
+	unsigned			k;
+
+	for (k = 0; k < log->frameCount; k++) {
+		if (log->frames[k].frame == frame)
+			return log->frames[k].rowOffset;
+	}
+	rowFrame = &(log->frames[log->frameCount++]);
+	rowFrame->frame = frame;
+	rowFrame->rowOffset = log->rowBytes;
+	rowFrame->bytes = (uint32_t)frameBytes;
+	log->rowBytes += (unsigned)(((frameBytes + 7) / 8) * 8);
+	return rowFrame->rowOffset;
+}
+
+// Adds the configured pins of one I/O mode of a device as log columns
+static unsigned addLogColumns(quickDAQlog* log, quickDAQlogColumn* desc, unsigned devNum, IOmodes ioMode, pinInfo* pins, unsigned pinCnt)
+{
+	char				pinName[DAQMX_MAX_STR_LEN];
+	NItask				*pinTask = NULL;
+	quickDAQlogSource	*source = NULL;
+	size_t				sampleSize = 0;
+	unsigned			pinNum, added = 0, c;
+
+	for (pinNum = 0; pinNum < pinCnt; pinNum++) {
+		if (pins[pinNum].isPinValid != TRUE || pins[pinNum].pinTask == NULL)
+			continue;
+		if (log != NULL) {
+			pinTask = pins[pinNum].pinTask;
+			source = &(log->sources[log->columnCount]);
+			desc[log->columnCount].devNum = devNum;
+			desc[log->columnCount].pinNum = pinNum;
+			desc[log->columnCount].ioMode = ioMode;
+			desc[log->columnCount].valueSize = sizeof(float64);
+			// Raw analog input: log the counts and their scaling
+			if (ioMode == ANALOG_IN && pinTask->rawBuffer != NULL) {
+				sampleSize = sizeof(int16);
+				source->type = LOG_SOURCE_I16;
+				source->rowOffset = logRowFrame(log, (void**)&(pinTask->rawBuffer), pinTask->pinCount * sampleSize);
+				desc[log->columnCount].valueSize = sizeof(int16);
+				for (c = 0; c < QUICKDAQ_SCALE_COEFFS; c++)
+					desc[log->columnCount].scale[c] = pinTask->scaleCoeffs[c * pinTask->pinCount + pins[pinNum].pinID];
+			}
+			else {
+				sampleSize = taskSampleSize(pinTask);
+				source->type = (ioMode == DIGITAL_OUT) ? LOG_SOURCE_U32 : LOG_SOURCE_F64;
+				source->rowOffset = logRowFrame(log, &(pinTask->dataBuffer), pinTask->pinCount * sampleSize);
+			}
+			source->rowOffset += (uint32_t)(pins[pinNum].pinID * sampleSize);
+			snprintf(desc[log->columnCount].name, QUICKDAQ_LOG_NAME_LEN, "%s", pin2string(pinName, devNum, ioMode, pinNum));
+			log->columnCount++;
+		}
+		added++;
+	}
+	return added;
+}
+
+// Resolves the log columns; with 'log' NULL only counts them
+static unsigned buildLogColumns(quickDAQlog* log, quickDAQlogColumn* desc)
+{
+	deviceInfo	*thisDev = NULL;
+	unsigned	devID, count = 1;
+
+	if (log != NULL) {
+		log->columnCount = 1;
+		log->rowBytes = sizeof(uInt64);
+		log->sources[0].type = LOG_SOURCE_U64;
+		desc[0].ioMode = INVALID_IO;
+		desc[0].valueSize = sizeof(uInt64);
+		snprintf(desc[0].name, QUICKDAQ_LOG_NAME_LEN, "cycle");
+	}
+	for (devID = 0; devID <= DAQmxMaxCount; devID++) {
+		thisDev = &(DAQmxDevList[devID]);
+		if (thisDev->isDevValid != TRUE)
+			continue;
+		count += addLogColumns(log, desc, devID, ANALOG_IN, thisDev->AIpins, thisDev->AIcnt);
+		count += addLogColumns(log, desc, devID, CTR_ANGLE_IN, thisDev->CIpins, thisDev->CIcnt);
+		count += addLogColumns(log, desc, devID, ANALOG_OUT, thisDev->AOpins, thisDev->AOcnt);
+		count += addLogColumns(log, desc, devID, DIGITAL_OUT, thisDev->DOpins, thisDev->DOcnt);
+	}
+	return count;
+}
+
+// Called by quickDAQstart() once the channel tables are built
+void startDataLog()
+{
+	quickDAQlog	*log = NULL;
+	unsigned	columnCount, chunkCount = 2;
+
+	if (logFilePath[0] == '\0')
+		return;
+	while (chunkCount < logChunkCnt)
+		chunkCount <<= 1;
+
+	columnCount = buildLogColumns(NULL, NULL);
+	log = quickDAQlogCreate(columnCount, logChunkRowCnt, chunkCount, logFileFormat);
+	if (log == NULL) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Unable to allocate the data log. Logging disabled.\n");
+		return;
+	}
+	buildLogColumns(log, log->columnInfo);
+	if (!quickDAQlogStart(log, logFilePath, DAQmxSampleMode, DAQmxSamplingRate)) {
+		quickDAQlogFree(log);
+		return;
+	}
+	quickDAQdataLog = log;
+	fprintf(ERRSTREAM, "Logging %u columns to '%s' in chunks of %u rows.\n", columnCount, logFilePath, log->chunkRows);
+}
+
+/*!
+ * \fn void logFrame()
+ * Control thread only: appends the current input frames and output values as one row of the
+ * data log. quickDAQcycle() calls it after its reads; loops built on syncSampling() call it once
+ * per cycle after their reads. The row, the cycle number followed by each logged task frame as is
+ * (one copy per task), goes into a preallocated chunk; a full chunk is handed to the writer thread
+ * with one atomic store, and the writer sorts it into columns. If every chunk is still waiting to
+ * be written the row is dropped and counted (see getLogDroppedRows), the loop never waits on the disk.
+ */
+void logFrame()
+{
+	quickDAQlog				*log = quickDAQdataLog;
+	const quickDAQlogFrame	*frame = NULL;
+	char					*row = NULL;
+	unsigned				k;
+
+	if (log == NULL)
+		return;
+	row = quickDAQlogBeginRow(log);
+	if (row == NULL)
+		return;
+	memcpy(row, &quickDAQcycleCount, sizeof(uInt64));
+	for (k = 0, frame = log->frames; k < log->frameCount; k++, frame++)
+		memcpy(row + frame->rowOffset, *frame->frame, frame->bytes);
+	quickDAQlogEndRow(log);
+}
+
+// Called by quickDAQstop(): writes the partial chunk, drains the ring and closes the file
+void stopDataLog()
+{
+	quickDAQlog* log = quickDAQdataLog;
+
+	if (log == NULL)
+		return;
+	quickDAQlogStop(log);
+	if (log->writeError != 0)
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Data log '%s' is incomplete (write error).\n", logFilePath);
+	if (log->droppedRows > 0)
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Data log dropped %llu rows (writer too slow).\n", (unsigned long long)log->droppedRows);
+	quickDAQlogFree(log);
+	quickDAQdataLog = NULL;
+}
+
+/*inline*/ uInt64 getLogDroppedRows()
+{
+	return (quickDAQdataLog != NULL) ? quickDAQdataLog->droppedRows : 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,375 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <quickDAQ_logreader.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------
+// Data log reader Global Definitions
+//------------------------------------------
+// Extraction of one row range, shared by the jobs of a worker pool (one job per chunk)
+typedef struct _logExtractJob {
+	const quickDAQlogFile	*logFile;
+	uint64_t				firstRow;
+	uint64_t				rowCount;
+	uint64_t				firstChunk;
+	const unsigned			*columns;
+	unsigned				columnCount;
+	double					*outputData;
+} logExtractJob;
+
+// First value of the cycle column of chunk 'chunkNum'
+#define chunkCycles(logFile, chunkNum)	((const uint64_t*)((const char*)(logFile)->map.data + (logFile)->index[chunkNum].offset + QUICKDAQ_LOG_CHUNK_HEAD))
+
+//------------------------------------------
+// Data log reader function definitions
+//------------------------------------------
+
+// Uses the block index of a complete version 3 log in place
+static bool findLogIndex(quickDAQlogFile* logFile)
+{
+	const char				*data = (const char*)logFile->map.data;
+	const quickDAQlogHeader	*header = logFile->header;
+	const quickDAQlogFooter	*footer = NULL;
+	uint64_t				chunkCount = 0;
+
+	if (header->version < 3 || logFile->map.size < header->headerBytes + sizeof(quickDAQlogFooter))
+		return false;
+	footer = (const quickDAQlogFooter*)(data + logFile->map.size - sizeof(quickDAQlogFooter));
+	if (memcmp(footer->magic, QUICKDAQ_LOG_INDEX_MAGIC, sizeof(footer->magic)) != 0 || footer->entryCount < 2)
+		return false;
+	chunkCount = footer->entryCount - 1;
+	if (footer->indexOffset != header->headerBytes + chunkCount * header->chunkBytes
+		|| footer->indexOffset + footer->entryCount * sizeof(quickDAQlogIndexEntry) + sizeof(quickDAQlogFooter) != logFile->map.size)
+		return false;
+	logFile->index = (const quickDAQlogIndexEntry*)(data + footer->indexOffset);
+	logFile->chunkCount = chunkCount;
+	return true;
+}
+
+// Rebuilds the block index from the chunk headers, for logs without one (older or cut short).
+// Logs before version 3 have no chunk times: they are derived from the cycle number.
+static bool rebuildLogIndex(quickDAQlogFile* logFile)
+{
+	const char				*data = (const char*)logFile->map.data;
+	const quickDAQlogHeader	*header = logFile->header;
+	const quickDAQlogChunk	*info = NULL;
+	const uint64_t			*cycles = NULL;
+	quickDAQlogIndexEntry	*entry = NULL;
+	uint64_t				chunkCount = 0, offset = header->headerBytes, lastCycle = 0, k;
+	unsigned				lastRows = 0;
+
+	for (; offset + header->chunkBytes <= logFile->map.size; offset += header->chunkBytes, chunkCount++) {
+		info = (const quickDAQlogChunk*)(data + offset);
+		if (info->chunkNum != chunkCount || info->rowCount == 0 || info->rowCount > header->chunkRows)
+			break;
+	}
+	logFile->indexCopy = (quickDAQlogIndexEntry*)malloc((size_t)(chunkCount + 1) * sizeof(quickDAQlogIndexEntry));
+	if (logFile->indexCopy == NULL)
+		return false;
+
+	for (k = 0, offset = header->headerBytes; k <= chunkCount; k++, offset += header->chunkBytes) {
+		entry = &(logFile->indexCopy[k]);
+		entry->firstRow = (k == 0) ? 0 : entry[-1].firstRow + lastRows;
+		entry->offset = offset;
+		if (k == chunkCount) {
+			// End entry
+			entry->firstCycle = (k == 0) ? 0 : lastCycle + 1;
+			entry->time = (k == 0) ? 0 : entry[-1].time;
+			if (k > 0 && header->samplingRate > 0)
+				entry->time += (uint64_t)((double)lastRows * 1e9 / header->samplingRate);
+			break;
+		}
+		info = (const quickDAQlogChunk*)(data + offset);
+		cycles = (const uint64_t*)(data + offset + QUICKDAQ_LOG_CHUNK_HEAD);
+		entry->firstCycle = cycles[0];
+		entry->time = info->firstTime;
+		if (header->version < 3)
+			entry->time = (header->samplingRate > 0) ? (uint64_t)((double)cycles[0] * 1e9 / header->samplingRate) : 0;
+		lastRows = info->rowCount;
+		lastCycle = cycles[lastRows - 1];
+	}
+	logFile->index = logFile->indexCopy;
+	logFile->chunkCount = chunkCount;
+	return true;
+}
+
+/*!
+ * \fn quickDAQlogFile* quickDAQlogOpen(const char* filePath)
+ * Opens a data log written by setDataLogging() (quickDAQ format, not TDMS) for offline reading.
+ * The file is memory-mapped, not read: opening takes the same time for any length. Complete
+ * version 3 logs carry a block index; for older logs and logs cut short the index is rebuilt
+ * from the chunk headers, which touches one page per chunk. Does not need a session or NI-DAQmx.
+ *
+ * \return Returns the opened log, or NULL if the file cannot be mapped or is not a data log.
+ */
+quickDAQlogFile* quickDAQlogOpen(const char* filePath)
+{
+	quickDAQlogFile			*logFile = NULL;
+	const quickDAQlogHeader	*header = NULL;
+	const char				*desc = NULL;
+	size_t					descSize = sizeof(quickDAQlogColumn), dataBytes = 0;
+	unsigned				k;
+
+	logFile = (quickDAQlogFile*)calloc(1, sizeof(quickDAQlogFile));
+	if (logFile == NULL)
+		return NULL;
+	if (qdMapFile(filePath, &(logFile->map)) != 0) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Unable to open data log '%s'.\n", filePath);
+		free(logFile);
+		return NULL;
+	}
+	header = (const quickDAQlogHeader*)logFile->map.data;
+	logFile->header = header;
+	if (logFile->map.size < sizeof(quickDAQlogHeader) || memcmp(header->magic, QUICKDAQ_LOG_MAGIC, sizeof(header->magic)) != 0
+		|| header->version < 1 || header->version > QUICKDAQ_LOG_VERSION || header->columnCount == 0 || header->chunkRows == 0)
+		goto notALog;
+	// Version 1 descriptors have no scaling coefficients
+	if (header->version == 1)
+		descSize = offsetof(quickDAQlogColumn, scale);
+	if (header->headerBytes > logFile->map.size || sizeof(quickDAQlogHeader) + header->columnCount * descSize > header->headerBytes)
+		goto notALog;
+
+	logFile->columnInfo = (quickDAQlogColumn*)calloc(header->columnCount, sizeof(quickDAQlogColumn));
+	logFile->columnOffset = (size_t*)malloc(header->columnCount * sizeof(size_t));
+	if (logFile->columnInfo == NULL || logFile->columnOffset == NULL)
+		goto notALog;
+	desc = (const char*)logFile->map.data + sizeof(quickDAQlogHeader);
+	for (k = 0; k < header->columnCount; k++, desc += descSize) {
+		memcpy(&(logFile->columnInfo[k]), desc, descSize);
+		if (logFile->columnInfo[k].valueSize != sizeof(int16_t) && logFile->columnInfo[k].valueSize != sizeof(double))
+			goto notALog;
+		logFile->columnOffset[k] = dataBytes;
+		dataBytes += (size_t)logFile->columnInfo[k].valueSize * header->chunkRows;
+	}
+	if (QUICKDAQ_LOG_CHUNK_HEAD + dataBytes > header->chunkBytes)
+		goto notALog;
+
+	if (!findLogIndex(logFile) && !rebuildLogIndex(logFile))
+		goto notALog;
+	logFile->rowCount = logFile->index[logFile->chunkCount].firstRow;
+	return logFile;
+
+notALog:
+	fprintf(ERRSTREAM, "QuickDAQ library: Warning: '%s' is not a readable quickDAQ data log.\n", filePath);
+	quickDAQlogClose(logFile);
+	return NULL;
+}
+
+void quickDAQlogClose(quickDAQlogFile* logFile)
+{
+	if (logFile == NULL)
+		return;
+	qdUnmapFile(&(logFile->map));
+	if (logFile->columnInfo != NULL) free(logFile->columnInfo);
+	if (logFile->columnOffset != NULL) free(logFile->columnOffset);
+	if (logFile->indexCopy != NULL) free(logFile->indexCopy);
+	free(logFile);
+}
+
+/*!
+ * \fn int quickDAQlogFindColumn(const quickDAQlogFile* logFile, unsigned devNum, int ioMode, unsigned pinNum)
+ * Looks up the column of a logged channel. Column 0 is the cycle number.
+ *
+ * \return Returns the column number, or -1 if the channel was not logged.
+ */
+int quickDAQlogFindColumn(const quickDAQlogFile* logFile, unsigned devNum, int ioMode, unsigned pinNum)
+{
+	unsigned k;
+
+	for (k = 1; k < logFile->header->columnCount; k++) {
+		if (logFile->columnInfo[k].devNum == devNum && logFile->columnInfo[k].ioMode == ioMode && logFile->columnInfo[k].pinNum == pinNum)
+			return (int)k;
+	}
+	return -1;
+}
+
+// Chunk holding 'row' (< rowCount): binary search of the index
+static uint64_t chunkOfRow(const quickDAQlogFile* logFile, uint64_t row)
+{
+	uint64_t low = 0, high = logFile->chunkCount - 1, mid;
+
+	while (low < high) {
+		mid = (low + high + 1) / 2;
+		if (logFile->index[mid].firstRow <= row)
+			low = mid;
+		else
+			high = mid - 1;
+	}
+	return low;
+}
+
+/*!
+ * \fn uint64_t quickDAQlogRowAt(const quickDAQlogFile* logFile, double seconds)
+ * Seeks by time: binary search of the block index, then of the cycle numbers of one chunk. Only
+ * the pages of that chunk's cycle column are touched. 'seconds' counts from the logging start.
+ *
+ * \return Returns the first row at or after 'seconds', or the row count if there is none.
+ */
+uint64_t quickDAQlogRowAt(const quickDAQlogFile* logFile, double seconds)
+{
+	const quickDAQlogIndexEntry	*index = logFile->index;
+	const uint64_t				*cycles = NULL;
+	uint64_t					t = 0, low = 0, high = 0, mid = 0, chunkNum = 0, cycle = 0, rowsInChunk = 0;
+
+	if (logFile->chunkCount == 0 || seconds >= index[logFile->chunkCount].time / 1e9)
+		return logFile->rowCount;
+	if (seconds > 0)
+		t = (uint64_t)(seconds * 1e9);
+	if (t <= index[0].time)
+		return 0;
+
+	// Last chunk starting at or before 't'
+	low = 0;
+	high = logFile->chunkCount - 1;
+	while (low < high) {
+		mid = (low + high + 1) / 2;
+		if (index[mid].time <= t)
+			low = mid;
+		else
+			high = mid - 1;
+	}
+	chunkNum = low;
+
+	// Rows are one sample clock period apart within a chunk: interpolate the cycle number...
+	cycle = index[chunkNum].firstCycle;
+	if (index[chunkNum + 1].time > index[chunkNum].time)
+		cycle += (uint64_t)((double)(index[chunkNum + 1].firstCycle - index[chunkNum].firstCycle)
+			* (double)(t - index[chunkNum].time) / (double)(index[chunkNum + 1].time - index[chunkNum].time) + 0.999999);
+	// ...and find its row
+	cycles = chunkCycles(logFile, chunkNum);
+	rowsInChunk = index[chunkNum + 1].firstRow - index[chunkNum].firstRow;
+	low = 0;
+	high = rowsInChunk;
+	while (low < high) {
+		mid = (low + high) / 2;
+		if (cycles[mid] < cycle)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return index[chunkNum].firstRow + low;
+}
+
+/*!
+ * \fn double quickDAQlogTimeOf(const quickDAQlogFile* logFile, uint64_t row)
+ * Inverse of quickDAQlogRowAt().
+ *
+ * \return Returns the time of 'row' in seconds from the logging start, or the end time of the
+ * log if 'row' is past the last row.
+ */
+double quickDAQlogTimeOf(const quickDAQlogFile* logFile, uint64_t row)
+{
+	const quickDAQlogIndexEntry	*index = logFile->index;
+	uint64_t					chunkNum = 0, cycle = 0;
+	double						t = 0;
+
+	if (row >= logFile->rowCount)
+		return index[logFile->chunkCount].time / 1e9;
+	chunkNum = chunkOfRow(logFile, row);
+	cycle = chunkCycles(logFile, chunkNum)[row - index[chunkNum].firstRow];
+	t = (double)index[chunkNum].time;
+	if (index[chunkNum + 1].firstCycle > index[chunkNum].firstCycle)
+		t += (double)(index[chunkNum + 1].time - index[chunkNum].time) * (double)(cycle - index[chunkNum].firstCycle)
+			/ (double)(index[chunkNum + 1].firstCycle - index[chunkNum].firstCycle);
+	return t / 1e9;
+}
+
+// Extraction job: copies the requested rows of one chunk
+static void logExtractChunk(unsigned jobNum, void* arg)
+{
+	const logExtractJob		*job = (const logExtractJob*)arg;
+	const quickDAQlogFile	*logFile = job->logFile;
+	const uint64_t			chunkNum = job->firstChunk + jobNum;
+	const char				*chunkData = (const char*)logFile->map.data + logFile->index[chunkNum].offset + QUICKDAQ_LOG_CHUNK_HEAD;
+	const quickDAQlogColumn	*col = NULL;
+	const char				*src = NULL;
+	double					*dst = NULL;
+	uint64_t				first = logFile->index[chunkNum].firstRow, end = logFile->index[chunkNum + 1].firstRow, k;
+	unsigned				c, n;
+
+	if (first < job->firstRow)
+		first = job->firstRow;
+	if (end > job->firstRow + job->rowCount)
+		end = job->firstRow + job->rowCount;
+	n = (unsigned)(end - first);
+
+	for (c = 0; c < job->columnCount; c++) {
+		col = &(logFile->columnInfo[job->columns[c]]);
+		src = chunkData + logFile->columnOffset[job->columns[c]] + (size_t)col->valueSize * (first - logFile->index[chunkNum].firstRow);
+		dst = job->outputData + (size_t)c * job->rowCount + (first - job->firstRow);
+		if (job->columns[c] == 0) {
+			for (k = 0; k < n; k++)
+				dst[k] = (double)((const uint64_t*)src)[k];
+		}
+		else if (col->valueSize == sizeof(int16_t))
+			quickDAQscaleI16((const int16_t*)src, 1, n, col->scale, dst);
+		else
+			memcpy(dst, src, n * sizeof(double));
+	}
+}
+
+/*!
+ * \fn uint64_t quickDAQlogExtract(const quickDAQlogFile* logFile, uint64_t firstRow, uint64_t rowCount, const unsigned* columns, unsigned columnCount, double* outputData, unsigned workerCount)
+ * Copies rows [firstRow, firstRow + rowCount) of 'columnCount' columns into 'outputData', one
+ * array of 'rowCount' values per column, in the order of 'columns'. Cycle numbers are converted
+ * to double and raw analog counts scaled. Chunks are extracted in parallel by a worker pool of
+ * 'workerCount' threads created for the call, or by the calling thread alone if 0. Combine with
+ * quickDAQlogRowAt() to extract a time range.
+ *
+ * \return Returns the number of rows extracted, fewer than 'rowCount' past the end of the log.
+ */
+uint64_t quickDAQlogExtract(const quickDAQlogFile* logFile, uint64_t firstRow, uint64_t rowCount, const unsigned* columns,
+	unsigned columnCount, double* outputData, unsigned workerCount)
+{
+	quickDAQworkerPool	*pool = NULL;
+	logExtractJob		job;
+	uint64_t			lastChunk = 0, jobCount = 0, k;
+	unsigned			c;
+
+	if (firstRow >= logFile->rowCount || rowCount == 0)
+		return 0;
+	for (c = 0; c < columnCount; c++) {
+		if (columns[c] >= logFile->header->columnCount) {
+			fprintf(ERRSTREAM, "QuickDAQ library: Warning: Data log has no column %u.\n", columns[c]);
+			return 0;
+		}
+	}
+	// Rows past the end are left untouched; columns keep their 'rowCount' stride
+	job.logFile = logFile;
+	job.firstRow = firstRow;
+	job.rowCount = rowCount;
+	job.columns = columns;
+	job.columnCount = columnCount;
+	job.outputData = outputData;
+	if (rowCount > logFile->rowCount - firstRow)
+		rowCount = logFile->rowCount - firstRow;
+	job.firstChunk = chunkOfRow(logFile, firstRow);
+	lastChunk = chunkOfRow(logFile, firstRow + rowCount - 1);
+	jobCount = lastChunk - job.firstChunk + 1;
+
+	if (workerCount > 0 && jobCount > 1) {
+		if (workerCount > jobCount - 1)
+			workerCount = (unsigned)(jobCount - 1);
+		pool = quickDAQpoolCreateEx(workerCount, NULL, NULL, NULL);
+	}
+	if (pool != NULL) {
+		quickDAQpoolRun(pool, (unsigned)jobCount, logExtractChunk, &job);
+		quickDAQpoolDestroy(pool);
+	}
+	else {
+		for (k = 0; k < jobCount; k++)
+			logExtractChunk((unsigned)k, &job);
+	}
+	return rowCount;
+}
+
+#ifdef __cplusplus
+}
+#endif
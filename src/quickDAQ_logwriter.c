@@ -0,0 +1,350 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <quickDAQ_logwriter.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//---------------------------------
+// Data log writer Global Definitions
+//---------------------------------
+// Rounds 'bytes' up to a whole number of file blocks
+#define logAlign(bytes)	((((bytes) + QUICKDAQ_LOG_ALIGN - 1) / QUICKDAQ_LOG_ALIGN) * QUICKDAQ_LOG_ALIGN)
+
+//---------------------------------
+// Data log writer function definitions
+//---------------------------------
+
+/*!
+ * \fn quickDAQlog* quickDAQlogCreate(unsigned columnCount, unsigned chunkRows, unsigned chunkCount, logFormats format)
+ * Allocates a data log of 'columnCount' columns (column 0 is the cycle number) stored in chunks of
+ * 'chunkRows' rows, a multiple of 8, in a pool of 'chunkCount' chunks, a power of two. Before
+ * quickDAQlogStart(), describe the columns in 'columnInfo', lay out a row in 'rowBytes' and give
+ * the place and type of each column in it in 'sources'.
+ *
+ * \return Returns the log, or NULL if it cannot be allocated.
+ */
+quickDAQlog* quickDAQlogCreate(unsigned columnCount, unsigned chunkRows, unsigned chunkCount, logFormats format)
+{
+	quickDAQlog* log = (quickDAQlog*)qdAlignedAlloc(QD_CACHELINE, sizeof(quickDAQlog));
+
+	if (log == NULL)
+		return NULL;
+	memset(log, 0, sizeof(quickDAQlog));
+	log->format = format;
+	log->chunkRows = chunkRows;
+	log->chunkCount = chunkCount;
+	log->columnCount = columnCount;
+	log->columnInfo = (quickDAQlogColumn*)calloc(columnCount, sizeof(quickDAQlogColumn));
+	log->sources = (quickDAQlogSource*)calloc(columnCount, sizeof(quickDAQlogSource));
+	log->columnOffset = (size_t*)malloc(columnCount * sizeof(size_t));
+	log->frames = (quickDAQlogFrame*)calloc(columnCount, sizeof(quickDAQlogFrame));
+	if (log->columnInfo == NULL || log->sources == NULL || log->columnOffset == NULL || log->frames == NULL) {
+		quickDAQlogFree(log);
+		return NULL;
+	}
+	return log;
+}
+
+void quickDAQlogFree(quickDAQlog* log)
+{
+	if (log == NULL)
+		return;
+	if (log->file != NULL) fclose(log->file);
+	if (log->chunks != NULL) qdAlignedFree(log->chunks);
+	if (log->fileChunk != NULL) qdAlignedFree(log->fileChunk);
+	if (log->columnInfo != NULL) free(log->columnInfo);
+	if (log->sources != NULL) free(log->sources);
+	if (log->columnOffset != NULL) free(log->columnOffset);
+	if (log->frames != NULL) free(log->frames);
+	freeTdmsWriter(&(log->tdms));
+	if (log->index != NULL) free(log->index);
+	qdAlignedFree(log);
+}
+
+// Writer thread only: transposes the rows of a chunk of the pool into the columns of 'fileChunk'
+static void transposeChunk(quickDAQlog* log, const char* chunk)
+{
+	const quickDAQlogChunk	*info = (const quickDAQlogChunk*)chunk;
+	const char				*src = NULL;
+	char					*dst = NULL;
+	uint32_t				u32;
+	double					f64;
+	unsigned				k, r;
+
+	memcpy(log->fileChunk, chunk, sizeof(quickDAQlogChunk));
+	for (k = 0; k < log->columnCount; k++) {
+		src = chunk + QUICKDAQ_LOG_CHUNK_HEAD + log->sources[k].rowOffset;
+		dst = log->fileChunk + QUICKDAQ_LOG_CHUNK_HEAD + log->columnOffset[k];
+		switch (log->sources[k].type)
+		{
+		case LOG_SOURCE_I16:
+			for (r = 0; r < info->rowCount; r++, src += log->rowBytes)
+				memcpy(dst + r * sizeof(int16_t), src, sizeof(int16_t));
+			break;
+		case LOG_SOURCE_U32:
+			for (r = 0; r < info->rowCount; r++, src += log->rowBytes) {
+				memcpy(&u32, src, sizeof(u32));
+				f64 = (double)u32;
+				memcpy(dst + r * sizeof(double), &f64, sizeof(f64));
+			}
+			break;
+		default:
+			for (r = 0; r < info->rowCount; r++, src += log->rowBytes)
+				memcpy(dst + r * sizeof(double), src, sizeof(double));
+			break;
+		}
+	}
+}
+
+// Writer thread only: records where a stored chunk starts in the file and in time
+static bool indexChunk(quickDAQlog* log, const char* chunk)
+{
+	const quickDAQlogChunk	*info = (const quickDAQlogChunk*)chunk;
+	const uint64_t			*cycles = (const uint64_t*)(chunk + QUICKDAQ_LOG_CHUNK_HEAD);
+	quickDAQlogIndexEntry	*entry = NULL;
+	uint64_t				newCap = 0;
+
+	if (log->indexCount == log->indexCap) {
+		newCap = (log->indexCap == 0) ? 256 : 2 * log->indexCap;
+		entry = (quickDAQlogIndexEntry*)realloc(log->index, (size_t)newCap * sizeof(quickDAQlogIndexEntry));
+		if (entry == NULL)
+			return false;
+		log->index = entry;
+		log->indexCap = newCap;
+	}
+	entry = &(log->index[log->indexCount]);
+	entry->firstRow = (log->indexCount == 0) ? 0 : entry[-1].firstRow + log->lastRows;
+	entry->firstCycle = cycles[0];
+	entry->time = info->firstTime;
+	entry->offset = log->fileOffset;
+	log->indexCount++;
+	log->lastRows = info->rowCount;
+	log->lastCycle = cycles[info->rowCount - 1];
+	log->fileOffset += log->chunkBytes;
+	return true;
+}
+
+// Writer thread only: appends the block index and the footer once the last chunk is stored
+static bool writeLogIndex(quickDAQlog* log)
+{
+	const quickDAQlogIndexEntry	*last = &(log->index[log->indexCount - 1]);
+	quickDAQlogIndexEntry		endEntry;
+	quickDAQlogFooter			footer;
+
+	// End entry: one row past the last, timed at the sampling rate when there is one
+	endEntry.firstRow = last->firstRow + log->lastRows;
+	endEntry.firstCycle = log->lastCycle + 1;
+	endEntry.time = qdMonotonicNs() - log->startMonotonic;
+	if (log->samplingRate > 0)
+		endEntry.time = last->time + (uint64_t)((double)log->lastRows * 1e9 / log->samplingRate);
+	endEntry.offset = log->fileOffset;
+	footer.entryCount = log->indexCount + 1;
+	footer.indexOffset = log->fileOffset;
+	memcpy(footer.magic, QUICKDAQ_LOG_INDEX_MAGIC, sizeof(footer.magic));
+
+	return (fwrite(log->index, sizeof(quickDAQlogIndexEntry), (size_t)log->indexCount, log->file) == log->indexCount
+		&& fwrite(&endEntry, sizeof(endEntry), 1, log->file) == 1
+		&& fwrite(&footer, sizeof(footer), 1, log->file) == 1);
+}
+
+// Writer thread: the only consumer of the chunk ring. Drains what is left once stopped.
+static QD_THREAD_FUNC(logWriterThread, arg)
+{
+	quickDAQlog*	log = (quickDAQlog*)arg;
+	uint64_t		tail = log->tail;
+	char			*chunk = NULL;
+	bool			written = true, isIndexed = (log->format != LOG_TDMS);
+
+	for (;;) {
+		if (tail == qdAtomicLoad(&log->head)) {
+			if (!qdAtomicLoad(&log->isRunning) && tail == qdAtomicLoad(&log->head))
+				break;
+			qdEventWait(&log->wake, QUICKDAQ_LOG_POLL_MS);
+			continue;
+		}
+		chunk = log->chunks + (size_t)(tail & (log->chunkCount - 1)) * log->slotBytes;
+		if (log->writeError == 0) {
+			transposeChunk(log, chunk);
+			if (log->format == LOG_TDMS)
+				written = tdmsWriteChunk(&(log->tdms), log->fileChunk, log->chunkRows, log->columnOffset);
+			else
+				written = (fwrite(log->fileChunk, 1, log->chunkBytes, log->file) == log->chunkBytes);
+			if (!written)
+				log->writeError = -1;
+			// Without an index the reader rebuilds it from the chunk headers
+			else if (isIndexed && !indexChunk(log, log->fileChunk))
+				isIndexed = false;
+		}
+		tail++;
+		qdAtomicStore(&log->tail, tail);
+	}
+	if (isIndexed && log->writeError == 0 && log->indexCount > 0 && !writeLogIndex(log))
+		log->writeError = -1;
+	QD_THREAD_RETURN;
+}
+
+// Columnar format: header, column descriptors, zero padding
+static bool writeLogHeader(quickDAQlog* log)
+{
+	quickDAQlogHeader	header;
+	char				*headerBlock = NULL;
+	size_t				headerBytes = logAlign(sizeof(quickDAQlogHeader) + log->columnCount * sizeof(quickDAQlogColumn));
+	bool				isWritten = false;
+
+	headerBlock = (char*)qdAlignedAlloc(QUICKDAQ_LOG_ALIGN, headerBytes);
+	if (headerBlock == NULL)
+		return false;
+	memset(headerBlock, 0, headerBytes);
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, QUICKDAQ_LOG_MAGIC, sizeof(header.magic));
+	header.version = QUICKDAQ_LOG_VERSION;
+	header.headerBytes = (uint32_t)headerBytes;
+	header.columnCount = log->columnCount;
+	header.chunkRows = log->chunkRows;
+	header.chunkBytes = log->chunkBytes;
+	header.sampleMode = log->sampleMode;
+	header.samplingRate = log->samplingRate;
+	header.startTime = log->startTime;
+	header.startMonotonic = log->startMonotonic;
+	memcpy(headerBlock, &header, sizeof(header));
+	memcpy(headerBlock + sizeof(header), log->columnInfo, log->columnCount * sizeof(quickDAQlogColumn));
+	isWritten = (fwrite(headerBlock, 1, headerBytes, log->file) == headerBytes);
+	qdAlignedFree(headerBlock);
+	log->fileOffset = headerBytes;
+	return isWritten;
+}
+
+/*!
+ * \fn bool quickDAQlogStart(quickDAQlog* log, const char* filePath, int32_t sampleMode, double samplingRate)
+ * Allocates and touches the chunk pool and the writer's chunk, creates 'filePath', writes the file header and starts the
+ * writer thread. 'sampleMode' and 'samplingRate' are recorded in the header; the rate also times
+ * the block index and TDMS waveforms. Prints a warning on failure; the log is then not started
+ * and may only be freed.
+ *
+ * \return Returns false if the log cannot be started.
+ */
+bool quickDAQlogStart(quickDAQlog* log, const char* filePath, int32_t sampleMode, double samplingRate)
+{
+	size_t		dataBytes = 0;
+	unsigned	k;
+
+	log->sampleMode = sampleMode;
+	log->samplingRate = samplingRate;
+	log->rowBytes = ((log->rowBytes + 7) / 8) * 8;
+	// Columns of raw counts are a quarter of the size; chunkRows keeps every column 8-byte aligned
+	for (k = 0; k < log->columnCount; k++) {
+		log->columnOffset[k] = dataBytes;
+		dataBytes += (size_t)log->columnInfo[k].valueSize * log->chunkRows;
+	}
+	log->chunkBytes = (unsigned)logAlign(QUICKDAQ_LOG_CHUNK_HEAD + dataBytes);
+	log->slotBytes = ((QUICKDAQ_LOG_CHUNK_HEAD + log->chunkRows * log->rowBytes + QD_CACHELINE - 1) / QD_CACHELINE) * QD_CACHELINE;
+	log->chunks = (char*)qdAlignedAlloc(QD_CACHELINE, (size_t)log->slotBytes * log->chunkCount);
+	log->fileChunk = (char*)qdAlignedAlloc(QUICKDAQ_LOG_ALIGN, log->chunkBytes);
+	if (log->chunks == NULL || log->fileChunk == NULL) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Unable to allocate the data log. Logging disabled.\n");
+		return false;
+	}
+	// Touch the pool now so the control loop never page-faults on it
+	memset(log->chunks, 0, (size_t)log->slotBytes * log->chunkCount);
+	memset(log->fileChunk, 0, log->chunkBytes);
+	log->startTime = (uint64_t)time(NULL);
+	log->startMonotonic = qdMonotonicNs();
+
+	log->file = qdFileOpen(filePath, "wb");
+	if (log->file == NULL) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Unable to open data log '%s'. Logging disabled.\n", filePath);
+		return false;
+	}
+	// Chunks are already large and aligned: bypass the stdio buffer
+	setvbuf(log->file, NULL, _IONBF, 0);
+
+	if (log->format == LOG_TDMS) {
+		// Every segment is written by the writer thread; size its metadata buffer now
+		if (!initTdmsWriter(&(log->tdms), log->file, log->columnInfo, log->columnCount, log->chunkRows, log->startTime, samplingRate)) {
+			fprintf(ERRSTREAM, "QuickDAQ library: Warning: Unable to allocate the data log. Logging disabled.\n");
+			return false;
+		}
+	}
+	else if (!writeLogHeader(log))
+		log->writeError = -1;
+
+	if (qdEventInit(&(log->wake)) != 0) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Unable to start the data log writer. Logging disabled.\n");
+		return false;
+	}
+	qdAtomicStore(&log->isRunning, 1);
+	if (qdThreadCreate(&(log->thread), logWriterThread, (void*)log) != 0) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Unable to start the data log writer. Logging disabled.\n");
+		qdAtomicStore(&log->isRunning, 0);
+		qdEventDestroy(&(log->wake));
+		return false;
+	}
+	return true;
+}
+
+// Hands the chunk being filled to the writer
+static void handOverChunk(quickDAQlog* log)
+{
+	const uint64_t		head = log->head;
+	quickDAQlogChunk	*chunk = (quickDAQlogChunk*)(log->chunks + (size_t)(head & (log->chunkCount - 1)) * log->slotBytes);
+
+	chunk->chunkNum = head;
+	chunk->rowCount = log->rowCount;
+	chunk->droppedRows = log->droppedRows;
+	log->rowCount = 0;
+	qdAtomicStore(&log->head, head + 1);
+}
+
+/*!
+ * \fn char* quickDAQlogBeginRow(quickDAQlog* log)
+ * Control thread only: starts a row. Copy its 'rowBytes' bytes (the frames of 'sources') to the
+ * returned address, then call quickDAQlogEndRow(). If every chunk is still waiting to be written
+ * the row is dropped and counted in 'droppedRows': the loop never waits on the disk.
+ *
+ * \return Returns the row to fill, or NULL if the row is dropped.
+ */
+char* quickDAQlogBeginRow(quickDAQlog* log)
+{
+	char *chunk = NULL;
+
+	if (log->rowCount == 0 && log->head - qdAtomicLoad(&log->tail) >= log->chunkCount) {
+		log->droppedRows++;
+		return NULL;
+	}
+	chunk = log->chunks + (size_t)(log->head & (log->chunkCount - 1)) * log->slotBytes;
+	// Chunk headers carry their own time, so a log cut short can still be indexed
+	if (log->rowCount == 0)
+		((quickDAQlogChunk*)chunk)->firstTime = qdMonotonicNs() - log->startMonotonic;
+	return chunk + QUICKDAQ_LOG_CHUNK_HEAD + (size_t)log->rowCount * log->rowBytes;
+}
+
+// Control thread only: ends the row started by quickDAQlogBeginRow(); a full chunk goes to the writer
+void quickDAQlogEndRow(quickDAQlog* log)
+{
+	if (++log->rowCount == log->chunkRows)
+		handOverChunk(log);
+}
+
+/*!
+ * \fn void quickDAQlogStop(quickDAQlog* log)
+ * Hands the partial chunk over, lets the writer drain the ring and append the block index, and
+ * joins it. 'writeError' then tells whether the file is complete. Free the log afterwards.
+ */
+void quickDAQlogStop(quickDAQlog* log)
+{
+	if (log->rowCount > 0)
+		handOverChunk(log);
+	qdAtomicStore(&log->isRunning, 0);
+	qdEventSignal(&(log->wake));
+	qdThreadJoin(log->thread);
+	qdEventDestroy(&(log->wake));
+}
+
+#ifdef __cplusplus
+}
+#endif
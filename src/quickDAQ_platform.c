@@ -0,0 +1,172 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+	#define _GNU_SOURCE	// for CPU affinity
+#endif
+#include <quickDAQ_platform.h>
+#include <string.h>
+#if !defined(_WIN32) && !defined(_WIN64)
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------
+// Platform layer non-inline definitions
+//------------------------------------------
+
+/*!
+ * \fn int qdPinCurrentThread(int cpu)
+ * Pins the calling thread to a single CPU core.
+ *
+ * \return Returns 0 on success and -1 on failure or if affinity is unsupported.
+ */
+int qdPinCurrentThread(int cpu)
+{
+	if (cpu < 0)
+		return -1;
+#if defined(_WIN32) || defined(_WIN64)
+	return (SetThreadAffinityMask(GetCurrentThread(), ((DWORD_PTR)1) << cpu) == 0) ? -1 : 0;
+#elif defined(__linux__)
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(cpu, &cpuSet);
+	return (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0) ? 0 : -1;
+#else
+	return -1;
+#endif
+}
+
+/*!
+ * \fn int qdSetThreadRealtime(int priority)
+ * Moves the calling thread to a real-time scheduling policy. POSIX uses SCHED_FIFO at 'priority'
+ * (clamped to the policy's range). Windows raises the process to HIGH_PRIORITY_CLASS and the thread
+ * to TIME_CRITICAL, ignoring 'priority'.
+ *
+ * \return Returns 0 on success and -1 on failure (typically missing privileges).
+ */
+int qdSetThreadRealtime(int priority)
+{
+#if defined(_WIN32) || defined(_WIN64)
+	(void)priority;
+	if (SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS) == 0)
+		return -1;
+	return (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) == 0) ? -1 : 0;
+#else
+	struct sched_param param;
+	int minPrio = sched_get_priority_min(SCHED_FIFO);
+	int maxPrio = sched_get_priority_max(SCHED_FIFO);
+
+	if (priority < minPrio) priority = minPrio;
+	if (priority > maxPrio) priority = maxPrio;
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = priority;
+	return (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0) ? 0 : -1;
+#endif
+}
+
+/*!
+ * \fn int qdLockMemory()
+ * Locks the process' current and future pages in RAM (POSIX mlockall). Windows has no equivalent,
+ * so the working set minimum is raised instead and individual buffers are locked by qdPrefault().
+ *
+ * \return Returns 0 on success and -1 on failure.
+ */
+int qdLockMemory()
+{
+#if defined(_WIN32) || defined(_WIN64)
+	return (SetProcessWorkingSetSize(GetCurrentProcess(), (SIZE_T)64 << 20, (SIZE_T)256 << 20) == 0) ? -1 : 0;
+#else
+	return (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) ? 0 : -1;
+#endif
+}
+
+/*!
+ * \fn void qdPrefault(void* mem, size_t size)
+ * Touches every page of 'mem' (keeping its contents) so that the first real access does not fault.
+ * On Windows the range is also locked into the working set.
+ */
+void qdPrefault(void* mem, size_t size)
+{
+	volatile char* page = (volatile char*)mem;
+	size_t offset = 0;
+	const size_t pageSize = 4096;
+
+	if (mem == NULL || size == 0)
+		return;
+	for (offset = 0; offset < size; offset += pageSize)
+		page[offset] = page[offset];
+	page[size - 1] = page[size - 1];
+#if defined(_WIN32) || defined(_WIN64)
+	VirtualLock(mem, size);
+#endif
+}
+
+/*!
+ * \fn int qdMapFile(const char* path, qdFileMap* map)
+ * Maps the whole file 'path' read-only into memory.
+ *
+ * \return Returns 0 on success and -1 on failure (including an empty file).
+ */
+int qdMapFile(const char* path, qdFileMap* map)
+{
+	memset(map, 0, sizeof(qdFileMap));
+#if defined(_WIN32) || defined(_WIN64)
+	LARGE_INTEGER fileSize;
+
+	map->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (map->file == INVALID_HANDLE_VALUE)
+		return -1;
+	if (GetFileSizeEx(map->file, &fileSize) == 0 || fileSize.QuadPart == 0
+		|| (map->mapping = CreateFileMappingA(map->file, NULL, PAGE_READONLY, 0, 0, NULL)) == NULL) {
+		CloseHandle(map->file);
+		return -1;
+	}
+	map->data = MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0);
+	if (map->data == NULL) {
+		CloseHandle(map->mapping);
+		CloseHandle(map->file);
+		return -1;
+	}
+	map->size = (size_t)fileSize.QuadPart;
+	return 0;
+#else
+	struct stat fileStat;
+	void* data = NULL;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		return -1;
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+		close(fd);
+		return -1;
+	}
+	data = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return -1;
+	map->data = data;
+	map->size = (size_t)fileStat.st_size;
+	return 0;
+#endif
+}
+
+void qdUnmapFile(qdFileMap* map)
+{
+	if (map->data == NULL)
+		return;
+#if defined(_WIN32) || defined(_WIN64)
+	UnmapViewOfFile(map->data);
+	CloseHandle(map->mapping);
+	CloseHandle(map->file);
+#else
+	munmap((void*)map->data, map->size);
+#endif
+	map->data = NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,186 @@
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <quickDAQ_queue.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------
+// Output command queue function definitions
+//------------------------------------------
+
+/*!
+ * \fn quickDAQcommandQueue* quickDAQqueueCreate(unsigned capacity)
+ * Allocates a command queue with room for 'capacity' commands (rounded up to a power of two),
+ * queued and pending alike.
+ *
+ * \return Returns the queue, or NULL if it cannot be allocated.
+ */
+quickDAQcommandQueue* quickDAQqueueCreate(unsigned capacity)
+{
+	quickDAQcommandQueue	*queue = NULL;
+	unsigned				slotCap = 2;
+
+	while (slotCap < capacity)
+		slotCap <<= 1;
+	queue = (quickDAQcommandQueue*)qdAlignedAlloc(QD_CACHELINE, sizeof(quickDAQcommandQueue));
+	if (queue == NULL)
+		return NULL;
+	memset(queue, 0, sizeof(quickDAQcommandQueue));
+	queue->capacity = slotCap;
+	queue->slots = (quickDAQcommand*)qdAlignedAlloc(QD_CACHELINE, slotCap * sizeof(quickDAQcommand));
+	queue->pending = (quickDAQcommand*)qdAlignedAlloc(QD_CACHELINE, slotCap * sizeof(quickDAQcommand));
+	if (queue->slots == NULL || queue->pending == NULL) {
+		quickDAQqueueDestroy(queue);
+		return NULL;
+	}
+	quickDAQqueueReset(queue);
+	return queue;
+}
+
+void quickDAQqueueDestroy(quickDAQcommandQueue* queue)
+{
+	if (queue == NULL)
+		return;
+	if (queue->slots != NULL) qdAlignedFree(queue->slots);
+	if (queue->pending != NULL) qdAlignedFree(queue->pending);
+	qdAlignedFree(queue);
+}
+
+// Drops every queued and pending command and restarts the tick count. No producer may be running.
+void quickDAQqueueReset(quickDAQcommandQueue* queue)
+{
+	unsigned k;
+
+	for (k = 0; k < queue->capacity; k++) {
+		queue->slots[k].seq = k;
+	}
+	queue->head = 0;
+	queue->pendingCnt = 0;
+	queue->appliedCnt = 0;
+	queue->lateCnt = 0;
+	qdAtomicStore(&queue->tail, 0);
+	qdAtomicStore(&queue->nextTick, 0);
+}
+
+/*!
+ * \fn bool quickDAQqueuePush(quickDAQcommandQueue* queue, const quickDAQcommand* cmd)
+ * Producer side (any thread): claims a slot by CAS on 'tail', copies 'cmd' into it (its 'seq' and
+ * 'ticket' are ignored) and publishes it through its sequence number. A slot whose sequence lags
+ * behind is still held by the consumer: queue full.
+ *
+ * \return Returns false if the queue is full.
+ */
+bool quickDAQqueuePush(quickDAQcommandQueue* queue, const quickDAQcommand* cmd)
+{
+	quickDAQcommand	*slot = NULL;
+	uint64_t		pos = 0, seq = 0;
+	int64_t			lag = 0;
+
+	pos = qdAtomicLoad(&queue->tail);
+	for (;;) {
+		slot = &(queue->slots[pos & (queue->capacity - 1)]);
+		seq = qdAtomicLoad(&slot->seq);
+		lag = (int64_t)(seq - pos);
+		if (lag == 0) {
+			if (qdAtomicCAS(&queue->tail, pos, pos + 1))
+				break;
+			pos = qdAtomicLoad(&queue->tail);
+		}
+		else if (lag < 0)
+			return false;
+		else
+			pos = qdAtomicLoad(&queue->tail);
+	}
+	slot->tick = cmd->tick;
+	slot->ticket = pos;
+	slot->frame = cmd->frame;
+	slot->idx = cmd->idx;
+	slot->isDigital = cmd->isDigital;
+	slot->value = cmd->value;
+	qdAtomicStore(&slot->seq, pos + 1);
+	return true;
+}
+
+// Heap order: earlier tick first, then enqueue order
+static bool commandBefore(const quickDAQcommand* a, const quickDAQcommand* b)
+{
+	return (a->tick != b->tick) ? (a->tick < b->tick) : (a->ticket < b->ticket);
+}
+
+static void heapPush(quickDAQcommandQueue* queue, const quickDAQcommand* cmd)
+{
+	quickDAQcommand	*heap = queue->pending;
+	unsigned		k = queue->pendingCnt++, parent;
+
+	while (k > 0) {
+		parent = (k - 1) / 2;
+		if (!commandBefore(cmd, &heap[parent]))
+			break;
+		heap[k] = heap[parent];
+		k = parent;
+	}
+	heap[k] = *cmd;
+}
+
+static void heapPop(quickDAQcommandQueue* queue)
+{
+	quickDAQcommand	*heap = queue->pending;
+	quickDAQcommand	last = heap[--queue->pendingCnt];
+	unsigned		k = 0, child;
+
+	while ((child = 2 * k + 1) < queue->pendingCnt) {
+		if (child + 1 < queue->pendingCnt && commandBefore(&heap[child + 1], &heap[child]))
+			child++;
+		if (!commandBefore(&heap[child], &last))
+			break;
+		heap[k] = heap[child];
+		k = child;
+	}
+	heap[k] = last;
+}
+
+/*!
+ * \fn unsigned quickDAQqueueApply(quickDAQcommandQueue* queue, uint64_t tick)
+ * Consumer side, one thread only: moves newly queued commands into the tick-ordered heap and
+ * writes every command due at or before 'tick' into its output buffer, in tick then enqueue
+ * order, then publishes 'tick' + 1 as the next tick. Never allocates or locks.
+ *
+ * \return Returns the number of commands applied.
+ */
+unsigned quickDAQqueueApply(quickDAQcommandQueue* queue, uint64_t tick)
+{
+	quickDAQcommand	*slot = NULL;
+	unsigned		applied = 0;
+
+	// Drain while the heap has room; the rest stays queued (back pressure on the producers)
+	while (queue->pendingCnt < queue->capacity) {
+		slot = &(queue->slots[queue->head & (queue->capacity - 1)]);
+		if (qdAtomicLoad(&slot->seq) != queue->head + 1)
+			break;
+		heapPush(queue, slot);
+		qdAtomicStore(&slot->seq, queue->head + queue->capacity);
+		queue->head++;
+	}
+
+	while (queue->pendingCnt > 0 && queue->pending[0].tick <= tick) {
+		slot = &(queue->pending[0]);
+		if (slot->isDigital)
+			((uint32_t*)*slot->frame)[slot->idx] = slot->value.digital;
+		else
+			((double*)*slot->frame)[slot->idx] = slot->value.analog;
+		if (slot->tick < tick)
+			queue->lateCnt++;
+		heapPop(queue);
+		applied++;
+	}
+	queue->appliedCnt += applied;
+	qdAtomicStore(&queue->nextTick, tick + 1);
+	return applied;
+}
+
+#ifdef __cplusplus
+}
+#endif
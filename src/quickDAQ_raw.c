@@ -0,0 +1,119 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <cLinkedList.h>
+#include <NIDAQmx.h>
+#include <ansi_c.h>
+#include "quickDAQ_internal.h"
+#include <macrodef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------
+// Raw analog input function definitions
+//------------------------------------------
+
+/*!
+ * \fn void setRawAnalogIn(bool enable)
+ * Opts in (or out) of raw analog input. ANALOG IN tasks then read int16 counts through the
+ * driver's binary read path, a quarter of the data of scaled reads. The scaling polynomial of every
+ * channel is captured once at quickDAQstart(). Background and event rings and the data log keep
+ * the raw counts; float consumers get them scaled on access (quickDAQringPeekBlock, readAnalog).
+ * Channels with more than 16-bit raw samples or a longer polynomial keep scaled reads.
+ * Must be called before quickDAQstart().
+ */
+void setRawAnalogIn(bool enable)
+{
+	if (quickDAQStatus != STATUS_INIT && quickDAQStatus != STATUS_READY) {
+		quickDAQSetError(ERROR_NOTCONFIG, TRUE);
+		return;
+	}
+	quickDAQrawAnalogIn = (enable) ? TRUE : FALSE;
+}
+
+static void dropRawMode(NItask* task)
+{
+	if (task->rawBuffer != NULL) qdAlignedFree(task->rawBuffer);
+	if (task->scaleCoeffs != NULL) qdAlignedFree(task->scaleCoeffs);
+	task->rawBuffer = NULL;
+	task->scaleCoeffs = NULL;
+}
+
+/*!
+ * \fn bool32 captureAnalogScaling(NItask* task)
+ * Called by quickDAQstart() for every ANALOG IN task in raw mode: reads the device scaling
+ * polynomial of each channel (in task channel order) and allocates the raw frame buffer.
+ *
+ * \return Returns FALSE, leaving the task in scaled mode, if a channel cannot be read raw.
+ */
+bool32 captureAnalogScaling(NItask* task)
+{
+	char		chanName[DAQMX_MAX_STR_LEN];
+	float64		coeffs[QUICKDAQ_SCALE_COEFFS];
+	uInt32		rawSize = 0;
+	int32		coeffCnt = 0;
+	unsigned	k, c;
+
+	// Current frame followed by the previous one, see extrapolateInputs()
+	task->rawBuffer = (int16*)qdAlignedAlloc(QD_CACHELINE, 2 * task->pinCount * sizeof(int16));
+	task->scaleCoeffs = (float64*)qdAlignedAlloc(QD_CACHELINE, QUICKDAQ_SCALE_COEFFS * task->pinCount * sizeof(float64));
+	if (task->rawBuffer == NULL || task->scaleCoeffs == NULL) {
+		dropRawMode(task);
+		return FALSE;
+	}
+	memset(task->rawBuffer, 0, 2 * task->pinCount * sizeof(int16));
+
+	for (k = 0; k < task->pinCount; k++) {
+		if (DAQmxFailed(DAQmxGetNthTaskChannel(task->taskHandler, k + 1, chanName, DAQMX_MAX_STR_LEN))
+			|| DAQmxFailed(DAQmxGetAIRawSampSize(task->taskHandler, chanName, &rawSize)) || rawSize > 16) {
+			fprintf(ERRSTREAM, "QuickDAQ library: Warning: Analog input channel %u has no 16-bit raw samples. Using scaled reads.\n", k);
+			dropRawMode(task);
+			return FALSE;
+		}
+		// With no buffer NI-DAQmx returns the number of coefficients
+		coeffCnt = DAQmxGetAIDevScalingCoeff(task->taskHandler, chanName, NULL, 0);
+		memset(coeffs, 0, sizeof(coeffs));
+		if (coeffCnt <= 0 || coeffCnt > QUICKDAQ_SCALE_COEFFS
+			|| DAQmxFailed(DAQmxGetAIDevScalingCoeff(task->taskHandler, chanName, coeffs, QUICKDAQ_SCALE_COEFFS))) {
+			fprintf(ERRSTREAM, "QuickDAQ library: Warning: Unable to read the scaling of '%s'. Using scaled reads.\n", chanName);
+			dropRawMode(task);
+			return FALSE;
+		}
+		for (c = 0; c < QUICKDAQ_SCALE_COEFFS; c++)
+			task->scaleCoeffs[c * task->pinCount + k] = coeffs[c];
+	}
+	return TRUE;
+}
+
+/*!
+ * \fn int32 readAnalogRaw(NItask* task)
+ * Reads one raw frame of a raw ANALOG IN task into its 'rawBuffer' (from its background ring if
+ * it has one, else from the driver) and scales it into the back buffer. The frame it replaces is
+ * kept as the previous raw frame. Swap the buffers afterwards, as for a scaled read.
+ *
+ * \return Returns the NI-DAQmx error code of the read.
+ */
+int32 readAnalogRaw(NItask* task)
+{
+	int32 error = 0;
+
+	memcpy(task->rawBuffer + task->pinCount, task->rawBuffer, task->pinCount * sizeof(int16));
+	if (task->ring != NULL)
+		quickDAQringLatestRawFrame(task->ring, task->rawBuffer);
+	else {
+		error = DAQmxReadBinaryI16(task->taskHandler, DAQmxDefaults.NIAIsampsPerCh, DAQmxDefaults.IOtimeout,
+			DAQmxDefaults.AIdataLayout, task->rawBuffer, task->pinCount, NULL, NULL);
+		if (DAQmxFailed(error))
+			return error;
+	}
+	quickDAQscaleI16(task->rawBuffer, task->pinCount, 1, task->scaleCoeffs, (float64*)task->backBuffer);
+	return error;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,314 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <cLinkedList.h>
+#include <NIDAQmx.h>
+#include <ansi_c.h>
+#include "quickDAQ_internal.h"
+#include <macrodef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//---------------------------------
+// Replay source Global Definitions
+//---------------------------------
+// Replay settings of the session
+#define replayFilePath	(quickDAQactiveSession->replayPath)
+#define replayPacing	(quickDAQactiveSession->replayMode)
+
+//------------------------------------
+// Replay source function definitions
+//------------------------------------
+
+/*!
+ * \fn void setReplay(const char* filePath, replayModes mode)
+ * Replays the columnar data log 'filePath' (see setDataLogging) through the normal read API
+ * instead of the hardware, or goes back to the hardware if 'filePath' is NULL. At quickDAQstart()
+ * the recorded AI and counter columns are matched to the configured pins by device and pin number;
+ * every syncSampling() or quickDAQcycle() then moves to the next recorded row, which readAnalog(),
+ * readCounterAngle(), readAllCounters() and the cycle plan return. REPLAY_PACED ticks at the
+ * recorded sample rate, REPLAY_FAST as fast as the loop runs. Either way the inputs of each tick
+ * are the recorded ones, so a replay is deterministic. The tasks are configured but never started
+ * and output writes never reach the driver; log the run with setDataLogging() to capture the
+ * outputs for diffing against the recorded AO/DO columns. Once the log is exhausted syncSampling()
+ * and quickDAQcycle() return ERROR_REPLAYEND and the inputs hold the last row.
+ * Background readers, event handlers and raw analog input are off while replaying.
+ * Must be called before quickDAQstart().
+ */
+void setReplay(const char* filePath, replayModes mode)
+{
+	if (quickDAQStatus != STATUS_INIT && quickDAQStatus != STATUS_READY) {
+		quickDAQSetError(ERROR_NOTCONFIG, TRUE);
+		return;
+	}
+	if (filePath == NULL)
+		replayFilePath[0] = '\0';
+	else
+		snprintf(replayFilePath, DAQMX_MAX_STR_LEN, "%s", filePath);
+	replayPacing = mode;
+}
+
+static void freeReplay(quickDAQreplaySource* replay)
+{
+	if (replay == NULL)
+		return;
+	if (replay->file != NULL) fclose(replay->file);
+	if (replay->columnInfo != NULL) free(replay->columnInfo);
+	if (replay->columnOffset != NULL) free(replay->columnOffset);
+	if (replay->chunk != NULL) qdAlignedFree(replay->chunk);
+	if (replay->inputTask != NULL) free(replay->inputTask);
+	if (replay->inputIdx != NULL) free(replay->inputIdx);
+	if (replay->inputColumn != NULL) free(replay->inputColumn);
+	if (replay->inputValue != NULL) free(replay->inputValue);
+	free(replay);
+}
+
+// Reads the header and column descriptors and lays out the chunk columns
+static bool32 readReplayHeader(quickDAQreplaySource* replay)
+{
+	quickDAQlogHeader	*header = &(replay->header);
+	size_t				descSize = sizeof(quickDAQlogColumn), dataBytes = 0;
+	unsigned			k;
+
+	if (fread(header, 1, sizeof(quickDAQlogHeader), replay->file) != sizeof(quickDAQlogHeader)
+		|| memcmp(header->magic, QUICKDAQ_LOG_MAGIC, sizeof(header->magic)) != 0
+		|| header->version < 1 || header->version > QUICKDAQ_LOG_VERSION || header->columnCount == 0 || header->chunkRows == 0)
+		return FALSE;
+	// Version 1 descriptors have no scaling coefficients
+	if (header->version == 1)
+		descSize = offsetof(quickDAQlogColumn, scale);
+
+	replay->columnInfo = (quickDAQlogColumn*)calloc(header->columnCount, sizeof(quickDAQlogColumn));
+	replay->columnOffset = (size_t*)malloc(header->columnCount * sizeof(size_t));
+	if (replay->columnInfo == NULL || replay->columnOffset == NULL)
+		return FALSE;
+	for (k = 0; k < header->columnCount; k++) {
+		if (fread(&(replay->columnInfo[k]), 1, descSize, replay->file) != descSize)
+			return FALSE;
+		if (replay->columnInfo[k].valueSize != sizeof(int16) && replay->columnInfo[k].valueSize != sizeof(float64))
+			return FALSE;
+		replay->columnOffset[k] = dataBytes;
+		dataBytes += (size_t)replay->columnInfo[k].valueSize * header->chunkRows;
+	}
+	if (QUICKDAQ_LOG_CHUNK_HEAD + dataBytes > header->chunkBytes || fseek(replay->file, (long)header->headerBytes, SEEK_SET) != 0)
+		return FALSE;
+
+	replay->chunk = (char*)qdAlignedAlloc(QD_CACHELINE, header->chunkBytes);
+	return (replay->chunk != NULL) ? TRUE : FALSE;
+}
+
+// Matches the recorded input columns to the configured AI and counter pins
+static unsigned mapReplayInputs(quickDAQreplaySource* replay)
+{
+	const quickDAQlogColumn	*col = NULL;
+	deviceInfo				*thisDev = NULL;
+	pinInfo					*thisPin = NULL;
+	unsigned				k;
+
+	for (k = 1; k < replay->header.columnCount; k++) {
+		col = &(replay->columnInfo[k]);
+		if (col->devNum > DAQmxMaxCount || DAQmxDevList[col->devNum].isDevValid != TRUE)
+			continue;
+		thisDev = &(DAQmxDevList[col->devNum]);
+		if (col->ioMode == ANALOG_IN)
+			thisPin = (col->pinNum < thisDev->AIcnt) ? &(thisDev->AIpins[col->pinNum]) : NULL;
+		else if (col->ioMode == CTR_ANGLE_IN)
+			thisPin = (col->pinNum < thisDev->CIcnt) ? &(thisDev->CIpins[col->pinNum]) : NULL;
+		else
+			continue;
+		if (thisPin == NULL || thisPin->isPinValid != TRUE || thisPin->pinTask == NULL)
+			continue;
+		if (replay->inputTask != NULL) {
+			replay->inputTask[replay->inputCount] = thisPin->pinTask;
+			replay->inputIdx[replay->inputCount] = thisPin->pinID;
+			replay->inputColumn[replay->inputCount] = k;
+			replay->inputValue[replay->inputCount] = 0.0;
+		}
+		replay->inputCount++;
+	}
+	return replay->inputCount;
+}
+
+// Counts the configured AI and counter pins
+static unsigned countInputPins()
+{
+	deviceInfo	*thisDev = NULL;
+	unsigned	devID, pinNum, count = 0;
+
+	for (devID = 0; devID <= DAQmxMaxCount; devID++) {
+		thisDev = &(DAQmxDevList[devID]);
+		if (thisDev->isDevValid != TRUE)
+			continue;
+		for (pinNum = 0; pinNum < thisDev->AIcnt; pinNum++)
+			if (thisDev->AIpins[pinNum].isPinValid == TRUE) count++;
+		for (pinNum = 0; pinNum < thisDev->CIcnt; pinNum++)
+			if (thisDev->CIpins[pinNum].isPinValid == TRUE) count++;
+	}
+	return count;
+}
+
+static void replayFatal(const char* message)
+{
+	fprintf(ERRSTREAM, "QuickDAQ library: FATAL: %s '%s'.\n", message, replayFilePath);
+	quickDAQTerminate();
+	quickDAQSetStatus(STATUS_UNKNOWN, FALSE);
+	quickDAQSetError(ERROR_UNKNOWN, TRUE);
+	exit(quickDAQErrorCode);
+}
+
+/*!
+ * \fn void startReplay()
+ * Called by quickDAQstart() before the task buffers are allocated: opens the replay log and maps
+ * its input columns. Replaying a recording on the hardware by accident is worse than not running,
+ * so a log that cannot be replayed is fatal.
+ */
+void startReplay()
+{
+	quickDAQreplaySource	*replay = NULL;
+	unsigned				inputCount = 0, pinCount = 0;
+
+	if (replayFilePath[0] == '\0')
+		return;
+	if (strcmp(replayFilePath, quickDAQactiveSession->logPath) == 0)
+		replayFatal("The data log would overwrite the replay log");
+
+	replay = (quickDAQreplaySource*)calloc(1, sizeof(quickDAQreplaySource));
+	if (replay == NULL)
+		replayFatal("Unable to allocate the replay source for");
+	replay->mode = replayPacing;
+	replay->file = qdFileOpen(replayFilePath, "rb");
+	if (replay->file == NULL) {
+		freeReplay(replay);
+		replayFatal("Unable to open replay log");
+	}
+	if (readReplayHeader(replay) != TRUE) {
+		freeReplay(replay);
+		replayFatal("Not a columnar quickDAQ data log");
+	}
+
+	inputCount = mapReplayInputs(replay);
+	replay->inputCount = 0;
+	replay->inputTask = (NItask**)malloc((inputCount + 1) * sizeof(NItask*));
+	replay->inputIdx = (unsigned*)malloc((inputCount + 1) * sizeof(unsigned));
+	replay->inputColumn = (unsigned*)malloc((inputCount + 1) * sizeof(unsigned));
+	replay->inputValue = (float64*)malloc((inputCount + 1) * sizeof(float64));
+	if (replay->inputTask == NULL || replay->inputIdx == NULL || replay->inputColumn == NULL || replay->inputValue == NULL) {
+		freeReplay(replay);
+		replayFatal("Unable to allocate the replay source for");
+	}
+	mapReplayInputs(replay);
+
+	pinCount = countInputPins();
+	if (pinCount > inputCount)
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: %u configured input channel(s) are not in the replay log and read 0.\n", pinCount - inputCount);
+	// Replay at the recorded rate, so the loop sees the timing it was recorded with
+	if (replay->header.samplingRate > 0.0 && replay->header.samplingRate != DAQmxSamplingRate) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Replaying at the recorded rate of %.1f Hz instead of %.1f Hz.\n",
+			replay->header.samplingRate, DAQmxSamplingRate);
+		DAQmxSamplingRate = replay->header.samplingRate;
+	}
+	quickDAQreplay = replay;
+	fprintf(ERRSTREAM, "Replaying %u input channel(s) from '%s' (%s).\n", inputCount, replayFilePath,
+		(replay->mode == REPLAY_FAST) ? "fast" : "paced");
+}
+
+void stopReplay()
+{
+	if (quickDAQreplay == NULL)
+		return;
+	fprintf(ERRSTREAM, "Replayed %llu row(s).\n", (unsigned long long)quickDAQreplay->rowCount);
+	freeReplay(quickDAQreplay);
+	quickDAQreplay = NULL;
+}
+
+// Moves to the next recorded row, reading the next non-empty chunk when needed. The block index
+// after the last chunk does not carry the next chunk number, so it ends the replay.
+static bool32 nextReplayRow(quickDAQreplaySource* replay)
+{
+	const quickDAQlogChunk* info = (const quickDAQlogChunk*)replay->chunk;
+
+	if (++replay->row < replay->chunkRowCnt)
+		return TRUE;
+	do {
+		if (fread(replay->chunk, 1, replay->header.chunkBytes, replay->file) != replay->header.chunkBytes
+			|| info->chunkNum != replay->nextChunk)
+			return FALSE;
+		replay->nextChunk++;
+		if (info->rowCount > replay->header.chunkRows) {
+			fprintf(ERRSTREAM, "QuickDAQ library: Warning: Replay log chunk %llu is corrupt. Replay ends.\n", (unsigned long long)info->chunkNum);
+			return FALSE;
+		}
+	} while (info->rowCount == 0);
+	replay->chunkRowCnt = info->rowCount;
+	replay->row = 0;
+	return TRUE;
+}
+
+/*!
+ * \fn int32 replayTick()
+ * Replay counterpart of the sample clock wait, called by syncSampling() and quickDAQcycle(): paces
+ * the tick (REPLAY_PACED) and loads the next recorded row. Sets 'isDone' once the log is exhausted.
+ *
+ * \return Returns 0; the replay clock cannot fail.
+ */
+int32 replayTick()
+{
+	quickDAQreplaySource	*replay = quickDAQreplay;
+	const quickDAQlogColumn	*col = NULL;
+	const char				*data = NULL;
+	unsigned				k;
+
+	if (replay->mode == REPLAY_PACED && DAQmxSamplingRate > 0.0)
+		waitForSoftClock();
+	else {
+		lateSampleWarning = FALSE;
+		quickDAQwaitMissed = 0;
+	}
+	if (replay->isDone)
+		return 0;
+	if (!nextReplayRow(replay)) {
+		replay->isDone = TRUE;
+		return 0;
+	}
+
+	for (k = 0; k < replay->inputCount; k++) {
+		col = &(replay->columnInfo[replay->inputColumn[k]]);
+		data = replay->chunk + QUICKDAQ_LOG_CHUNK_HEAD + replay->columnOffset[replay->inputColumn[k]];
+		if (col->valueSize == sizeof(int16))
+			quickDAQscaleI16(((const int16*)data) + replay->row, 1, 1, col->scale, &(replay->inputValue[k]));
+		else
+			replay->inputValue[k] = ((const float64*)data)[replay->row];
+	}
+	replay->rowCount++;
+	return 0;
+}
+
+/*!
+ * \fn void replayReadTask(NItask* task)
+ * Replay counterpart of an input task read: copies the current row into the back buffer of 'task'.
+ * Swap the buffers afterwards, as for a driver read. Safe on cycle worker threads.
+ */
+void replayReadTask(NItask* task)
+{
+	const quickDAQreplaySource	*replay = quickDAQreplay;
+	unsigned					k;
+
+	for (k = 0; k < replay->inputCount; k++) {
+		if (replay->inputTask[k] == task)
+			((float64*)task->backBuffer)[replay->inputIdx[k]] = replay->inputValue[k];
+	}
+}
+
+/*inline*/ uInt64 getReplayRows()
+{
+	return (quickDAQreplay != NULL) ? quickDAQreplay->rowCount : 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,388 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <cLinkedList.h>
+#include <NIDAQmx.h>
+#include <ansi_c.h>
+#include "quickDAQ_internal.h"
+#include <macrodef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//---------------------------------------------
+// Background acquisition function definitions
+//---------------------------------------------
+
+/*!
+ * \fn void setBackgroundAcquisition(bool enable, unsigned blockScans, unsigned ringBlocks)
+ * Opts in (or out) of background acquisition for CONTINUOUS sampling. When enabled, quickDAQstart()
+ * spawns one reader thread per input task that drains the driver in blocks of 'blockScans' scans
+ * into a ring of 'ringBlocks' blocks (rounded up to a power of two).
+ * Must be called before quickDAQstart().
+ */
+void setBackgroundAcquisition(bool enable, unsigned blockScans, unsigned ringBlocks)
+{
+	if (quickDAQStatus != STATUS_INIT && quickDAQStatus != STATUS_READY) {
+		quickDAQSetError(ERROR_NOTCONFIG, TRUE);
+		return;
+	}
+	quickDAQbgReadEnable = (enable) ? TRUE : FALSE;
+	if (blockScans > 0) quickDAQbgBlockScans = blockScans;
+	if (ringBlocks > 1) quickDAQbgRingBlocks = ringBlocks;
+}
+
+quickDAQring* quickDAQringCreate(NItask* task, unsigned blockScans, unsigned ringBlocks)
+{
+	quickDAQring* ring = (quickDAQring*)qdAlignedAlloc(QD_CACHELINE, sizeof(quickDAQring));
+	const bool32 isRaw = (task->rawBuffer != NULL) ? TRUE : FALSE;
+	const unsigned lineSamples = QD_CACHELINE / ((isRaw) ? sizeof(int16) : sizeof(float64));
+	unsigned blockCount = 2;
+
+	if (ring == NULL)
+		return NULL;
+	memset(ring, 0, sizeof(quickDAQring));
+
+	while (blockCount < ringBlocks)
+		blockCount <<= 1;
+
+	ring->task = task;
+	ring->session = quickDAQactiveSession;
+	ring->blockScans = blockScans;
+	ring->chanCount = task->pinCount;
+	ring->blockStride = ((blockScans * task->pinCount + lineSamples - 1) / lineSamples) * lineSamples;
+	ring->blockCount = blockCount;
+	if (isRaw) {
+		ring->rawBlocks = (int16*)qdAlignedAlloc(QD_CACHELINE, (size_t)ring->blockStride * blockCount * sizeof(int16));
+		ring->rawScratch = (int16*)qdAlignedAlloc(QD_CACHELINE, (size_t)ring->blockStride * sizeof(int16));
+		ring->scaled = (float64*)qdAlignedAlloc(QD_CACHELINE, (size_t)ring->blockStride * sizeof(float64));
+		ring->rawLatest = (int16*)qdAlignedAlloc(QD_CACHELINE, (size_t)ring->chanCount * sizeof(int16));
+		if (ring->rawBlocks == NULL || ring->rawScratch == NULL || ring->scaled == NULL || ring->rawLatest == NULL) {
+			quickDAQringDestroy(ring);
+			return NULL;
+		}
+		return ring;
+	}
+	ring->blocks = (float64*)qdAlignedAlloc(QD_CACHELINE, (size_t)ring->blockStride * blockCount * sizeof(float64));
+	ring->scratch = (float64*)qdAlignedAlloc(QD_CACHELINE, (size_t)ring->blockStride * sizeof(float64));
+	ring->latest = (float64*)qdAlignedAlloc(QD_CACHELINE, (size_t)ring->chanCount * sizeof(float64));
+	if (ring->blocks == NULL || ring->scratch == NULL || ring->latest == NULL) {
+		quickDAQringDestroy(ring);
+		return NULL;
+	}
+	return ring;
+}
+
+void quickDAQringDestroy(quickDAQring* ring)
+{
+	if (ring == NULL)
+		return;
+	if (ring->blocks != NULL) qdAlignedFree(ring->blocks);
+	if (ring->scratch != NULL) qdAlignedFree(ring->scratch);
+	if (ring->rawBlocks != NULL) qdAlignedFree(ring->rawBlocks);
+	if (ring->rawScratch != NULL) qdAlignedFree(ring->rawScratch);
+	if (ring->scaled != NULL) qdAlignedFree(ring->scaled);
+	if (ring->latest != NULL) qdAlignedFree(ring->latest);
+	if (ring->rawLatest != NULL) qdAlignedFree(ring->rawLatest);
+	qdAlignedFree(ring);
+}
+
+// Producer side of the latest-scan sequence lock: copies the last scan of a block just read
+static void publishLatestScan(quickDAQring* ring, const void* block, int32 scansRead, size_t sampleSize, void* latest)
+{
+	const uint64_t	seq = ring->latestSeq;
+	const size_t	scanBytes = (size_t)ring->chanCount * sampleSize;
+
+	if (scansRead <= 0)
+		return;
+	qdAtomicStore(&ring->latestSeq, seq + 1);
+	qdAtomicFence();
+	memcpy(latest, (const char*)block + (size_t)(scansRead - 1) * scanBytes, scanBytes);
+	qdAtomicStore(&ring->latestSeq, seq + 2);
+}
+
+// Consumer side: retries while the producer is writing or rewrote the scan during the copy
+static bool copyLatestScan(quickDAQring* ring, const void* latest, size_t sampleSize, void* outputData)
+{
+	uint64_t seq = 0;
+
+	do {
+		seq = qdAtomicLoad(&ring->latestSeq);
+		if (seq == 0)
+			return FALSE;
+		if (seq & 1)
+			continue;
+		memcpy(outputData, latest, (size_t)ring->chanCount * sampleSize);
+		qdAtomicFence();
+	} while ((seq & 1) || qdAtomicLoad(&ring->latestSeq) != seq);
+	return TRUE;
+}
+
+/*!
+ * \fn int32 quickDAQringFill(quickDAQring* ring)
+ * Producer step: reads one block from the driver into the next free slot and publishes it. When
+ * the consumer falls behind and the ring is full, the block is still drained from the driver (into
+ * scratch) and dropped, so the driver FIFO never overflows because of a slow consumer. The last
+ * scan of every block read, dropped or not, becomes the latest scan. Only one thread may fill a
+ * given ring.
+ *
+ * \return Returns the NI-DAQmx error code of the read.
+ */
+int32 quickDAQringFill(quickDAQring* ring)
+{
+	const uInt32	blockLen = ring->blockScans * ring->chanCount;
+	const uint64_t	head = ring->head;
+	const bool32	isFull = (head - qdAtomicLoad(&ring->tail) >= ring->blockCount) ? TRUE : FALSE;
+	int32			error = 0, scansRead = 0;
+	float64			*slot = NULL;
+	int16			*rawSlot = NULL;
+
+	if (ring->rawBlocks != NULL) {
+		// Raw analog counts: no scaling on the reader thread
+		rawSlot = (isFull) ? ring->rawScratch : ring->rawBlocks + (head & (ring->blockCount - 1)) * ring->blockStride;
+		error = DAQmxReadBinaryI16(ring->task->taskHandler, ring->blockScans, DAQmxDefaults.IOtimeout, DAQmx_Val_GroupByScanNumber,
+			rawSlot, blockLen, &scansRead, NULL);
+	}
+	else {
+		slot = (isFull) ? ring->scratch : ring->blocks + (head & (ring->blockCount - 1)) * ring->blockStride;
+		if (ring->task->taskType == ANALOG_IN)
+			error = DAQmxReadAnalogF64(ring->task->taskHandler, ring->blockScans, DAQmxDefaults.IOtimeout, DAQmx_Val_GroupByScanNumber,
+				slot, blockLen, &scansRead, NULL);
+		else
+			error = DAQmxReadCounterF64(ring->task->taskHandler, ring->blockScans, DAQmxDefaults.IOtimeout, slot, blockLen, &scansRead, NULL);
+	}
+
+	if (DAQmxFailed(error))
+		return error;
+	if (rawSlot != NULL)
+		publishLatestScan(ring, rawSlot, scansRead, sizeof(int16), ring->rawLatest);
+	else
+		publishLatestScan(ring, slot, scansRead, sizeof(float64), ring->latest);
+	if (isFull)
+		qdAtomicFetchAdd(&ring->droppedBlocks, 1);
+	else
+		qdAtomicStore(&ring->head, head + 1);
+	return error;
+}
+
+// Reader thread: the only producer of its ring
+static QD_THREAD_FUNC(ringReaderThread, arg)
+{
+	quickDAQring*	ring = (quickDAQring*)arg;
+	int32			error = 0;
+
+	while (qdAtomicLoad(&ring->isRunning)) {
+		error = quickDAQringFill(ring);
+		if (DAQmxFailed(error)) {
+			if (qdAtomicLoad(&ring->isRunning))
+				quickDAQringSetReaderError(ring, error);
+			break;
+		}
+	}
+	QD_THREAD_RETURN;
+}
+
+int quickDAQringStartReader(quickDAQring* ring)
+{
+	qdAtomicStore(&ring->isRunning, 1);
+	if (qdThreadCreate(&(ring->thread), ringReaderThread, (void*)ring) != 0) {
+		qdAtomicStore(&ring->isRunning, 0);
+		return -1;
+	}
+	return 0;
+}
+
+void quickDAQringStopReader(quickDAQring* ring)
+{
+	if (qdAtomicLoad(&ring->isRunning)) {
+		qdAtomicStore(&ring->isRunning, 0);
+		qdThreadJoin(ring->thread);
+	}
+	if (quickDAQringReaderError(ring) != 0) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Background reader stopped on NI-DAQmx error %ld (%llu blocks dropped).\n",
+			(long)quickDAQringReaderError(ring), (unsigned long long)ring->droppedBlocks);
+	}
+}
+
+/*!
+ * \fn int32 quickDAQringReaderError(quickDAQring* ring)
+ * Returns the first NI-DAQmx error recorded by the producer of the ring, or 0.
+ */
+int32 quickDAQringReaderError(quickDAQring* ring)
+{
+	return (int32)(int64_t)qdAtomicLoad(&ring->readerError);
+}
+
+// Keeps the first error: later errors of the same producer are consequences of it. 0 clears it.
+void quickDAQringSetReaderError(quickDAQring* ring, int32 error)
+{
+	if (error == 0)
+		qdAtomicStore(&ring->readerError, 0);
+	else
+		qdAtomicCAS(&ring->readerError, 0, (uint64_t)(int64_t)error);
+}
+
+void startBackgroundReaders()
+{
+	NItask		*myTask = NULL;
+
+	if (quickDAQbgReadEnable != TRUE)
+		return;
+	if (quickDAQreplay != NULL) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Background acquisition is off while replaying.\n");
+		return;
+	}
+	if (DAQmxSampleMode != CONTINUOUS) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Background acquisition requires CONTINUOUS sampling mode. Ignored.\n");
+		return;
+	}
+
+	for (myTask = firstNItask(); myTask != NULL; myTask = nextNItask(myTask)) {
+		if (myTask->taskType != ANALOG_IN && myTask->taskType != CTR_ANGLE_IN)
+			continue;
+		if (myTask->ring != NULL)
+			continue;
+
+		myTask->ring = quickDAQringCreate(myTask, quickDAQbgBlockScans, quickDAQbgRingBlocks);
+		if (myTask->ring == NULL || quickDAQringStartReader(myTask->ring) != 0) {
+			fprintf(ERRSTREAM, "QuickDAQ library: FATAL: Unable to start background reader thread.\n");
+			quickDAQTerminate();
+			quickDAQSetStatus(STATUS_UNKNOWN, FALSE);
+			quickDAQSetError(ERROR_UNKNOWN, TRUE);
+			exit(quickDAQErrorCode);
+		}
+		fprintf(ERRSTREAM, "Started background reader: %u scans x %u channels per block, %u blocks\n",
+			myTask->ring->blockScans, myTask->ring->chanCount, myTask->ring->blockCount);
+	}
+}
+
+void stopBackgroundReaders()
+{
+	NItask		*myTask = NULL;
+
+	for (myTask = firstNItask(); myTask != NULL; myTask = nextNItask(myTask)) {
+		// Event-driven tasks fill their ring from driver callbacks, see stopEventSources()
+		if (myTask->ring != NULL && myTask->eventDriven != TRUE) {
+			quickDAQringStopReader(myTask->ring);
+			quickDAQringDestroy(myTask->ring);
+			myTask->ring = NULL;
+		}
+	}
+}
+
+// consumer functions
+/*inline*/ unsigned quickDAQringAvailable(quickDAQring* ring)
+{
+	return (unsigned)(qdAtomicLoad(&ring->head) - ring->tail);
+}
+
+/*!
+ * \fn const float64* quickDAQringPeekBlock(quickDAQring* ring)
+ * Returns the oldest unreleased block (scan-interleaved, 'blockScans' x 'chanCount' samples)
+ * without copying it, or NULL if the ring is empty. The block stays valid until released.
+ * A raw analog ring returns the block scaled into its 'scaled' buffer; see quickDAQringPeekRawBlock.
+ */
+const float64* quickDAQringPeekBlock(quickDAQring* ring)
+{
+	uint64_t tail = ring->tail;
+	if (qdAtomicLoad(&ring->head) == tail)
+		return NULL;
+	if (ring->rawBlocks != NULL) {
+		quickDAQscaleI16(ring->rawBlocks + (tail & (ring->blockCount - 1)) * ring->blockStride, ring->chanCount, ring->blockScans,
+			ring->task->scaleCoeffs, ring->scaled);
+		return ring->scaled;
+	}
+	return ring->blocks + (tail & (ring->blockCount - 1)) * ring->blockStride;
+}
+
+/*!
+ * \fn const int16* quickDAQringPeekRawBlock(quickDAQring* ring)
+ * Raw analog rings only: returns the oldest unreleased block as int16 counts without copying or
+ * scaling it, or NULL if the ring is empty or not raw.
+ */
+const int16* quickDAQringPeekRawBlock(quickDAQring* ring)
+{
+	uint64_t tail = ring->tail;
+	if (ring->rawBlocks == NULL || qdAtomicLoad(&ring->head) == tail)
+		return NULL;
+	return ring->rawBlocks + (tail & (ring->blockCount - 1)) * ring->blockStride;
+}
+
+/*inline*/ void quickDAQringReleaseBlock(quickDAQring* ring)
+{
+	qdAtomicStore(&ring->tail, ring->tail + 1);
+}
+
+bool quickDAQringPopBlock(quickDAQring* ring, float64* outputData)
+{
+	const float64* block = NULL;
+	const int16* rawBlock = NULL;
+
+	if (ring->rawBlocks != NULL) {
+		rawBlock = quickDAQringPeekRawBlock(ring);
+		if (rawBlock == NULL)
+			return FALSE;
+		quickDAQscaleI16(rawBlock, ring->chanCount, ring->blockScans, ring->task->scaleCoeffs, outputData);
+		quickDAQringReleaseBlock(ring);
+		return TRUE;
+	}
+	block = quickDAQringPeekBlock(ring);
+	if (block == NULL)
+		return FALSE;
+	memcpy(outputData, block, (size_t)ring->blockScans * ring->chanCount * sizeof(float64));
+	quickDAQringReleaseBlock(ring);
+	return TRUE;
+}
+
+bool quickDAQringPopRawBlock(quickDAQring* ring, int16* outputData)
+{
+	const int16* block = quickDAQringPeekRawBlock(ring);
+	if (block == NULL)
+		return FALSE;
+	memcpy(outputData, block, (size_t)ring->blockScans * ring->chanCount * sizeof(int16));
+	quickDAQringReleaseBlock(ring);
+	return TRUE;
+}
+
+/*!
+ * \fn bool quickDAQringLatestFrame(quickDAQring* ring, float64* outputData)
+ * Copies the most recent scan ('chanCount' samples) read by the producer, whether or not its block
+ * was consumed or even fit in the ring, so latest-frame consumers keep up with a full ring.
+ *
+ * \return Returns FALSE if nothing has been read yet.
+ */
+bool quickDAQringLatestFrame(quickDAQring* ring, float64* outputData)
+{
+	if (ring->rawBlocks != NULL) {
+		if (!quickDAQringLatestRawFrame(ring, ring->task->rawBuffer))
+			return FALSE;
+		quickDAQscaleI16(ring->task->rawBuffer, ring->chanCount, 1, ring->task->scaleCoeffs, outputData);
+		return TRUE;
+	}
+	return copyLatestScan(ring, ring->latest, sizeof(float64), outputData);
+}
+
+bool quickDAQringLatestRawFrame(quickDAQring* ring, int16* outputData)
+{
+	if (ring->rawLatest == NULL)
+		return FALSE;
+	return copyLatestScan(ring, ring->rawLatest, sizeof(int16), outputData);
+}
+
+quickDAQring* getAnalogInRing()
+{
+	return (NItaskAI != NULL) ? NItaskAI->ring : NULL;
+}
+
+quickDAQring* getCounterAngleRing(unsigned devNum, unsigned ctrNum)
+{
+	NItask* ctrTask = DAQmxDevList[devNum].CItask[ctrNum];
+	return (ctrTask != NULL) ? ctrTask->ring : NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
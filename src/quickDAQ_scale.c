@@ -0,0 +1,143 @@
+#include <stdint.h>
+#include <quickDAQ_compiler.h>
+#include <quickDAQ_scale.h>
+
+// The AVX2 kernel is always compiled on x86 and picked at run time, so one binary runs on any
+// x86-64 CPU without /arch:AVX2 (or -mavx2)
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define QD_SCALE_AVX2
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define QD_TARGET_AVX2
+	#else
+		#define QD_TARGET_AVX2	__attribute__((target("avx2")))
+	#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+	#include <arm_neon.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------
+// Raw analog scaling function definitions
+//------------------------------------------
+
+// Scalar tail of a scan, channels [ch, chanCount)
+QD_INLINE void scaleI16Scalar(const int16_t* src, unsigned ch, unsigned chanCount, const double* c0, const double* c1,
+	const double* c2, const double* c3, double* dst)
+{
+	double x;
+
+	for (; ch < chanCount; ch++) {
+		x = (double)src[ch];
+		dst[ch] = c0[ch] + x * (c1[ch] + x * (c2[ch] + x * c3[ch]));
+	}
+}
+
+#if defined(QD_SCALE_AVX2)
+// AVX2 support: 0 unknown, 1 absent, 2 present. Probing is idempotent, so racing threads agree.
+static volatile int avx2State = 0;
+
+static int probeAVX2()
+{
+#if defined(_MSC_VER)
+	int regs[4];
+
+	// AVX2 instructions, and YMM state saved by the OS (OSXSAVE, then XCR0 bits 1 and 2)
+	__cpuid(regs, 0);
+	if (regs[0] < 7)
+		return 0;
+	__cpuid(regs, 1);
+	if ((regs[2] & (1 << 27)) == 0 || (regs[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+		return 0;
+	__cpuidex(regs, 7, 0);
+	return (regs[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static QD_TARGET_AVX2 void scaleI16AVX2(const int16_t* raw, unsigned chanCount, unsigned scans, const double* coeffs, double* outputData)
+{
+	const double	*c0 = coeffs, *c1 = coeffs + chanCount, *c2 = coeffs + 2 * chanCount, *c3 = coeffs + 3 * chanCount;
+	const int16_t	*src = raw;
+	double			*dst = outputData;
+	unsigned		scan, ch;
+
+	for (scan = 0; scan < scans; scan++, src += chanCount, dst += chanCount) {
+		for (ch = 0; ch + 4 <= chanCount; ch += 4) {
+			__m256d xv = _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i*)(src + ch))));
+			__m256d yv = _mm256_loadu_pd(c3 + ch);
+			yv = _mm256_add_pd(_mm256_mul_pd(yv, xv), _mm256_loadu_pd(c2 + ch));
+			yv = _mm256_add_pd(_mm256_mul_pd(yv, xv), _mm256_loadu_pd(c1 + ch));
+			yv = _mm256_add_pd(_mm256_mul_pd(yv, xv), _mm256_loadu_pd(c0 + ch));
+			_mm256_storeu_pd(dst + ch, yv);
+		}
+		scaleI16Scalar(src, ch, chanCount, c0, c1, c2, c3, dst);
+	}
+}
+#endif
+
+/*!
+ * \fn int quickDAQscaleHasAVX2()
+ * Probes the CPU (and OS support of the AVX registers) once.
+ *
+ * \return Returns non-zero if quickDAQscaleI16() uses its AVX2 kernel.
+ */
+int quickDAQscaleHasAVX2()
+{
+#if defined(QD_SCALE_AVX2)
+	if (avx2State == 0)
+		avx2State = probeAVX2() ? 2 : 1;
+	return avx2State == 2;
+#else
+	return 0;
+#endif
+}
+
+/*!
+ * \fn void quickDAQscaleI16(const int16_t* raw, unsigned chanCount, unsigned scans, const double* coeffs, double* outputData)
+ * Converts 'scans' scan-interleaved frames of 'chanCount' raw counts to engineering units with the
+ * per-channel polynomials 'coeffs' (QUICKDAQ_SCALE_COEFFS planes of 'chanCount' coefficients, see
+ * NItask). Vectorized across channels with AVX2 (4 lanes) on x86 CPUs that have it, chosen at run
+ * time, or AArch64 NEON (2 x 2 lanes). Scalar otherwise.
+ */
+void quickDAQscaleI16(const int16_t* raw, unsigned chanCount, unsigned scans, const double* coeffs, double* outputData)
+{
+	const double	*c0 = coeffs, *c1 = coeffs + chanCount, *c2 = coeffs + 2 * chanCount, *c3 = coeffs + 3 * chanCount;
+	const int16_t	*src = raw;
+	double			*dst = outputData;
+	unsigned		scan, ch;
+
+#if defined(QD_SCALE_AVX2)
+	if (chanCount >= 4 && quickDAQscaleHasAVX2()) {
+		scaleI16AVX2(raw, chanCount, scans, coeffs, outputData);
+		return;
+	}
+#endif
+	for (scan = 0; scan < scans; scan++, src += chanCount, dst += chanCount) {
+		ch = 0;
+#if defined(__ARM_NEON) && defined(__aarch64__)
+		for (; ch + 4 <= chanCount; ch += 4) {
+			int32x4_t	wide = vmovl_s16(vld1_s16(src + ch));
+			float64x2_t	xlo = vcvtq_f64_s64(vmovl_s32(vget_low_s32(wide)));
+			float64x2_t	xhi = vcvtq_f64_s64(vmovl_s32(vget_high_s32(wide)));
+			float64x2_t	ylo = vfmaq_f64(vld1q_f64(c2 + ch), vld1q_f64(c3 + ch), xlo);
+			float64x2_t	yhi = vfmaq_f64(vld1q_f64(c2 + ch + 2), vld1q_f64(c3 + ch + 2), xhi);
+			ylo = vfmaq_f64(vld1q_f64(c1 + ch), ylo, xlo);
+			yhi = vfmaq_f64(vld1q_f64(c1 + ch + 2), yhi, xhi);
+			vst1q_f64(dst + ch, vfmaq_f64(vld1q_f64(c0 + ch), ylo, xlo));
+			vst1q_f64(dst + ch + 2, vfmaq_f64(vld1q_f64(c0 + ch + 2), yhi, xhi));
+		}
+#endif
+		scaleI16Scalar(src, ch, chanCount, c0, c1, c2, c3, dst);
+	}
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,152 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <cLinkedList.h>
+#include <NIDAQmx.h>
+#include <ansi_c.h>
+#include "quickDAQ_internal.h"
+#include <macrodef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-----------------------------------
+// Frame snapshot function definitions
+//-----------------------------------
+
+/*!
+ * \fn void setFramePublishing(bool enable)
+ * Opts in (or out) of publishing every completed input frame (AI and counter tasks) for other
+ * threads, e.g. UI, loggers or safety monitors. The control loop pays one frame copy and one
+ * clock read per input read, never a lock or an allocation. Readers use readAnalogSnapshot()
+ * or readCounterSnapshot(). Must be called before quickDAQstart().
+ */
+void setFramePublishing(bool enable)
+{
+	if (quickDAQStatus != STATUS_INIT && quickDAQStatus != STATUS_READY) {
+		quickDAQSetError(ERROR_NOTCONFIG, TRUE);
+		return;
+	}
+	quickDAQframePublish = (enable) ? TRUE : FALSE;
+}
+
+quickDAQframePub* quickDAQframeCreate(unsigned chanCount)
+{
+	quickDAQframePub* pub = (quickDAQframePub*)qdAlignedAlloc(QD_CACHELINE, sizeof(quickDAQframePub));
+
+	if (pub == NULL)
+		return NULL;
+	memset(pub, 0, sizeof(quickDAQframePub));
+	pub->chanCount = chanCount;
+	pub->data = (float64*)qdAlignedAlloc(QD_CACHELINE, chanCount * sizeof(float64));
+	if (pub->data == NULL) {
+		qdAlignedFree(pub);
+		return NULL;
+	}
+	memset(pub->data, 0, chanCount * sizeof(float64));
+	return pub;
+}
+
+void quickDAQframeDestroy(quickDAQframePub* pub)
+{
+	if (pub == NULL)
+		return;
+	if (pub->data != NULL) qdAlignedFree(pub->data);
+	qdAlignedFree(pub);
+}
+
+/*!
+ * \fn void publishFrame(NItask* task)
+ * Writer side of the seqlock: copies the front buffer of 'task' into its published frame between
+ * two sequence increments. Called by swapTaskBuffers(); only one thread reads a task at a time.
+ */
+void publishFrame(NItask* task)
+{
+	quickDAQframePub*	pub = task->published;
+	const uint64_t		seq = pub->seq;
+
+	qdAtomicStore(&pub->seq, seq + 1);
+	// Keep the data stores below the odd sequence number
+	qdAtomicFence();
+	memcpy(pub->data, task->dataBuffer, pub->chanCount * sizeof(float64));
+	pub->timestamp = qdMonotonicNs();
+	qdAtomicStore(&pub->seq, seq + 2);
+}
+
+/*!
+ * \fn bool quickDAQsnapshot(const quickDAQframePub* pub, const unsigned* chanIdx, unsigned len, float64* outputData, quickDAQframeInfo* info)
+ * Reader side of the seqlock: copies channels chanIdx[0..len-1] (or the first 'len' channels if
+ * 'chanIdx' is NULL) of the latest published frame. A copy that overlapped a write is retried, at
+ * most QUICKDAQ_SNAPSHOT_RETRIES times, so the call never waits on the writer. 'info' may be NULL.
+ *
+ * \return Returns FALSE if no frame was published yet or every attempt overlapped a write.
+ */
+bool quickDAQsnapshot(const quickDAQframePub* pub, const unsigned* chanIdx, unsigned len, float64* outputData, quickDAQframeInfo* info)
+{
+	uint64_t	seq = 0;
+	uInt64		timestamp = 0;
+	unsigned	attempt, k;
+
+	for (attempt = 0; attempt < QUICKDAQ_SNAPSHOT_RETRIES; attempt++) {
+		seq = qdAtomicLoad((volatile uint64_t*)&pub->seq);
+		if (seq == 0)
+			return FALSE;
+		if (seq & 1) {
+			qdCpuRelax();
+			continue;
+		}
+		for (k = 0; k < len; k++) {
+			outputData[k] = pub->data[(chanIdx != NULL) ? chanIdx[k] : k];
+		}
+		timestamp = pub->timestamp;
+		// Keep the data loads above the sequence re-check
+		qdAtomicFence();
+		if (qdAtomicLoad((volatile uint64_t*)&pub->seq) == seq) {
+			if (info != NULL) {
+				info->frameNum = seq / 2;
+				info->timestamp = timestamp;
+			}
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/*!
+ * \fn bool readAnalogSnapshot(unsigned devNum, float64* outputData, quickDAQframeInfo* info)
+ * Copies the device's analog inputs (in pin order) from the latest published frame. Safe to call
+ * from any thread bound to the session while quickDAQ runs (see quickDAQsetSession); never blocks
+ * the control loop. Requires setFramePublishing(true).
+ *
+ * \return Returns FALSE if no consistent frame is available (see quickDAQsnapshot).
+ */
+bool readAnalogSnapshot(unsigned devNum, float64* outputData, quickDAQframeInfo* info)
+{
+	deviceInfo* thisDev = NULL;
+
+	if (quickDAQStatus != STATUS_RUNNING)
+		return FALSE;
+	thisDev = &(DAQmxDevList[devNum]);
+	if (thisDev->AItask == NULL || thisDev->AItask->published == NULL)
+		return FALSE;
+	return quickDAQsnapshot(thisDev->AItask->published, thisDev->AIchanIdx, thisDev->AIchanCnt, outputData, info);
+}
+
+bool readCounterSnapshot(unsigned devNum, unsigned ctrNum, float64* angle, quickDAQframeInfo* info)
+{
+	NItask* ctrTask = NULL;
+
+	if (quickDAQStatus != STATUS_RUNNING)
+		return FALSE;
+	ctrTask = DAQmxDevList[devNum].CItask[ctrNum];
+	if (ctrTask == NULL || ctrTask->published == NULL)
+		return FALSE;
+	return quickDAQsnapshot(ctrTask->published, &(DAQmxDevList[devNum].CIpins[ctrNum].pinID), 1, angle, info);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <quickDAQ_tdms.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//---------------------------------
+// TDMS writer function definitions
+//---------------------------------
+// The TDMS encoder only formats the data log chunks; it never calls into NI-DAQmx.
+
+#define TDMS_ROOT_GROUP		"quickDAQ"
+
+// Appends 'size' bytes to the metadata being built; with no buffer it only counts them
+static void tdmsPut(char** pos, size_t* len, const void* data, size_t size)
+{
+	if (*pos != NULL) {
+		memcpy(*pos, data, size);
+		*pos += size;
+	}
+	*len += size;
+}
+
+static void tdmsPutU32(char** pos, size_t* len, uint32_t value)
+{
+	tdmsPut(pos, len, &value, sizeof(value));
+}
+
+static void tdmsPutString(char** pos, size_t* len, const char* str, size_t strLen)
+{
+	tdmsPutU32(pos, len, (uint32_t)strLen);
+	tdmsPut(pos, len, str, strLen);
+}
+
+// Object path "/'group'" or "/'group'/'channel'" (channel NULL for a group)
+static void tdmsPutPath(char** pos, size_t* len, const char* group, size_t groupLen, const char* channel)
+{
+	char	path[2 * QUICKDAQ_LOG_NAME_LEN + 8];
+	int		pathLen;
+
+	if (channel == NULL)
+		pathLen = snprintf(path, sizeof(path), "/'%.*s'", (int)groupLen, group);
+	else
+		pathLen = snprintf(path, sizeof(path), "/'%.*s'/'%s'", (int)groupLen, group, channel);
+	tdmsPutString(pos, len, path, (size_t)pathLen);
+}
+
+// Splits a column name "Dev/pin" into its group (device) and channel (pin) parts. The cycle
+// number (column 0) and names without a device go to the root group.
+static const char* tdmsChannelName(const tdmsWriter* tdms, unsigned colNum, const char** group, size_t* groupLen)
+{
+	const char* name = tdms->columnInfo[colNum].name;
+	const char* slash = strchr(name, '/');
+
+	if (colNum == 0 || slash == NULL) {
+		*group = TDMS_ROOT_GROUP;
+		*groupLen = strlen(TDMS_ROOT_GROUP);
+		return name;
+	}
+	*group = name;
+	*groupLen = (size_t)(slash - name);
+	return slash + 1;
+}
+
+// NI scaling properties of a raw counts channel: one polynomial applied to the stored values
+static void tdmsPutScaling(char** pos, size_t* len, const quickDAQlogColumn* col)
+{
+	char		propName[48];
+	int			propLen;
+	unsigned	c;
+
+	tdmsPutString(pos, len, "NI_Scaling_Status", 17);
+	tdmsPutU32(pos, len, TDMS_TYPE_STRING);
+	tdmsPutString(pos, len, "unscaled", 8);
+	tdmsPutString(pos, len, "NI_Number_Of_Scales", 19);
+	tdmsPutU32(pos, len, TDMS_TYPE_U32);
+	tdmsPutU32(pos, len, 1);
+	tdmsPutString(pos, len, "NI_Scale[0]_Scale_Type", 22);
+	tdmsPutU32(pos, len, TDMS_TYPE_STRING);
+	tdmsPutString(pos, len, "Polynomial", 10);
+	tdmsPutString(pos, len, "NI_Scale[0]_Polynomial_Coefficients_Size", 40);
+	tdmsPutU32(pos, len, TDMS_TYPE_U32);
+	tdmsPutU32(pos, len, QUICKDAQ_SCALE_COEFFS);
+	for (c = 0; c < QUICKDAQ_SCALE_COEFFS; c++) {
+		propLen = snprintf(propName, sizeof(propName), "NI_Scale[0]_Polynomial_Coefficients[%u]", c);
+		tdmsPutString(pos, len, propName, (size_t)propLen);
+		tdmsPutU32(pos, len, TDMS_TYPE_DOUBLE);
+		tdmsPut(pos, len, &(col->scale[c]), sizeof(double));
+	}
+	// Input source 0xFFFFFFFF: the stored raw values
+	tdmsPutString(pos, len, "NI_Scale[0]_Polynomial_Input_Source", 35);
+	tdmsPutU32(pos, len, TDMS_TYPE_U32);
+	tdmsPutU32(pos, len, 0xFFFFFFFF);
+}
+
+/*!
+ * \fn bool initTdmsWriter(tdmsWriter* tdms, FILE* file, const quickDAQlogColumn* columnInfo, unsigned columnCount, unsigned maxRows, uint64_t startTime, double samplingRate)
+ * Prepares writing TDMS segments of up to 'maxRows' rows of the 'columnCount' columns described by
+ * 'columnInfo' to 'file', which must stay open (and 'columnInfo' valid) until freeTdmsWriter().
+ * 'startTime' (seconds since the Unix epoch) and 'samplingRate' give the waveform timing, one row
+ * per second if the rate is not positive. The metadata buffer is allocated here, so writing never
+ * allocates.
+ *
+ * \return Returns false if the metadata buffer cannot be allocated.
+ */
+bool initTdmsWriter(tdmsWriter* tdms, FILE* file, const quickDAQlogColumn* columnInfo, unsigned columnCount,
+	unsigned maxRows, uint64_t startTime, double samplingRate)
+{
+	memset(tdms, 0, sizeof(tdmsWriter));
+	tdms->file = file;
+	tdms->columnInfo = columnInfo;
+	tdms->columnCount = columnCount;
+	tdms->startTime = startTime;
+	tdms->increment = (samplingRate > 0.0) ? 1.0 / samplingRate : 1.0;
+	// The first segment is the largest: it carries the properties
+	tdms->metaCap = TDMS_LEAD_IN_LEN + tdmsMetadata(NULL, tdms, maxRows, true);
+	tdms->meta = (char*)malloc(tdms->metaCap);
+	return (tdms->meta != NULL);
+}
+
+void freeTdmsWriter(tdmsWriter* tdms)
+{
+	if (tdms->meta != NULL) free(tdms->meta);
+	tdms->meta = NULL;
+	tdms->metaCap = 0;
+}
+
+/*!
+ * \fn size_t tdmsLeadIn(char* buf, uint32_t toc, uint64_t metaLen, uint64_t rawLen)
+ * Writes the TDMS_LEAD_IN_LEN bytes segment lead-in for a segment of 'metaLen' metadata bytes
+ * followed by 'rawLen' raw data bytes.
+ *
+ * \return Returns the lead-in length.
+ */
+size_t tdmsLeadIn(char* buf, uint32_t toc, uint64_t metaLen, uint64_t rawLen)
+{
+	const uint32_t	version = TDMS_VERSION;
+	const uint64_t	nextSegment = metaLen + rawLen;
+
+	memcpy(buf, "TDSm", 4);
+	memcpy(buf + 4, &toc, sizeof(toc));
+	memcpy(buf + 8, &version, sizeof(version));
+	memcpy(buf + 12, &nextSegment, sizeof(nextSegment));
+	memcpy(buf + 20, &metaLen, sizeof(metaLen));
+	return TDMS_LEAD_IN_LEN;
+}
+
+/*!
+ * \fn size_t tdmsMetadata(char* buf, const tdmsWriter* tdms, unsigned rowCount, bool withProperties)
+ * Writes the metadata of a segment holding 'rowCount' rows of every column: the file object,
+ * a 'quickDAQ' group with the cycle number, then one group per device with its channels, in
+ * column order. With 'withProperties' (first segment) the channels get the waveform properties
+ * wf_start_time, wf_increment and wf_start_offset, and raw analog channels their polynomial
+ * scaling. With 'buf' NULL only the length is computed.
+ *
+ * \return Returns the metadata length in bytes.
+ */
+size_t tdmsMetadata(char* buf, const tdmsWriter* tdms, unsigned rowCount, bool withProperties)
+{
+	const quickDAQlogColumn	*col = NULL;
+	const char				*group = NULL, *channel = NULL, *lastGroup = NULL;
+	char					*pos = buf;
+	size_t					len = 0, groupLen = 0, lastGroupLen = 0;
+	uint32_t				objCount = 1;
+	uint64_t				rows = rowCount, startSeconds = tdms->startTime + TDMS_EPOCH_OFFSET, startFraction = 0;
+	double					increment = tdms->increment, offset = 0.0;
+	unsigned				k;
+
+	// Objects: the file, each group once, every channel
+	for (k = 0; k < tdms->columnCount; k++) {
+		channel = tdmsChannelName(tdms, k, &group, &groupLen);
+		if (lastGroup == NULL || groupLen != lastGroupLen || strncmp(group, lastGroup, groupLen) != 0)
+			objCount++;
+		lastGroup = group;
+		lastGroupLen = groupLen;
+		objCount++;
+	}
+	tdmsPutU32(&pos, &len, objCount);
+
+	tdmsPutString(&pos, &len, "/", 1);
+	tdmsPutU32(&pos, &len, TDMS_NO_RAW_DATA);
+	if (withProperties) {
+		tdmsPutU32(&pos, &len, 1);
+		tdmsPutString(&pos, &len, "name", 4);
+		tdmsPutU32(&pos, &len, TDMS_TYPE_STRING);
+		tdmsPutString(&pos, &len, TDMS_ROOT_GROUP, strlen(TDMS_ROOT_GROUP));
+	}
+	else
+		tdmsPutU32(&pos, &len, 0);
+
+	lastGroup = NULL;
+	for (k = 0; k < tdms->columnCount; k++) {
+		col = &(tdms->columnInfo[k]);
+		channel = tdmsChannelName(tdms, k, &group, &groupLen);
+		if (lastGroup == NULL || groupLen != lastGroupLen || strncmp(group, lastGroup, groupLen) != 0) {
+			tdmsPutPath(&pos, &len, group, groupLen, NULL);
+			tdmsPutU32(&pos, &len, TDMS_NO_RAW_DATA);
+			tdmsPutU32(&pos, &len, 0);
+		}
+		lastGroup = group;
+		lastGroupLen = groupLen;
+
+		// Channel with its raw data index: index length, data type, dimension, value count
+		tdmsPutPath(&pos, &len, group, groupLen, channel);
+		tdmsPutU32(&pos, &len, 20);
+		tdmsPutU32(&pos, &len, (k == 0) ? TDMS_TYPE_U64 : (col->valueSize == sizeof(int16_t)) ? TDMS_TYPE_I16 : TDMS_TYPE_DOUBLE);
+		tdmsPutU32(&pos, &len, 1);
+		tdmsPut(&pos, &len, &rows, sizeof(rows));
+		if (!withProperties) {
+			tdmsPutU32(&pos, &len, 0);
+			continue;
+		}
+		tdmsPutU32(&pos, &len, (col->valueSize == sizeof(int16_t)) ? 8 + QUICKDAQ_SCALE_COEFFS : 3);
+		tdmsPutString(&pos, &len, "wf_start_time", 13);
+		tdmsPutU32(&pos, &len, TDMS_TYPE_TIMESTAMP);
+		tdmsPut(&pos, &len, &startFraction, sizeof(startFraction));
+		tdmsPut(&pos, &len, &startSeconds, sizeof(startSeconds));
+		tdmsPutString(&pos, &len, "wf_increment", 12);
+		tdmsPutU32(&pos, &len, TDMS_TYPE_DOUBLE);
+		tdmsPut(&pos, &len, &increment, sizeof(increment));
+		tdmsPutString(&pos, &len, "wf_start_offset", 15);
+		tdmsPutU32(&pos, &len, TDMS_TYPE_DOUBLE);
+		tdmsPut(&pos, &len, &offset, sizeof(offset));
+		if (col->valueSize == sizeof(int16_t))
+			tdmsPutScaling(&pos, &len, col);
+	}
+	return len;
+}
+
+/*!
+ * \fn bool tdmsWriteChunk(tdmsWriter* tdms, char* chunk, unsigned chunkRows, const size_t* columnOffset)
+ * Writer thread: stores one data log chunk (of 'chunkRows' rows, columns at 'columnOffset') as a
+ * TDMS segment. The chunk columns already are TDMS non-interleaved raw data, raw analog counts
+ * included: they are written as I16 with their NI scaling properties. A chunk with as many rows
+ * as the previous segment is written as a raw-only segment, its lead-in placed in the chunk header
+ * area right before the data, so it costs a single write. Other chunks (the first, and a partial
+ * last one) carry full metadata.
+ *
+ * \return Returns false if the file write failed.
+ */
+bool tdmsWriteChunk(tdmsWriter* tdms, char* chunk, unsigned chunkRows, const size_t* columnOffset)
+{
+	const quickDAQlogChunk	*info = (const quickDAQlogChunk*)chunk;
+	char					*raw = chunk + QUICKDAQ_LOG_CHUNK_HEAD;
+	const unsigned			rows = info->rowCount;
+	size_t					rawLen = 0, metaLen = 0;
+	bool					isWritten = false;
+	unsigned				k;
+
+	if (rows == 0)
+		return true;
+	// A partial chunk: pack the columns back to back
+	for (k = 0; k < tdms->columnCount; k++) {
+		if (rows < chunkRows && k > 0)
+			memmove(raw + rawLen, raw + columnOffset[k], (size_t)tdms->columnInfo[k].valueSize * rows);
+		rawLen += (size_t)tdms->columnInfo[k].valueSize * rows;
+	}
+
+	if (tdms->segments > 0 && rows == tdms->lastRows) {
+		// QUICKDAQ_LOG_CHUNK_HEAD leaves room for the lead-in after the quickDAQlogChunk header
+		tdmsLeadIn(raw - TDMS_LEAD_IN_LEN, TDMS_TOC_RAW_DATA, 0, rawLen);
+		isWritten = (fwrite(raw - TDMS_LEAD_IN_LEN, 1, TDMS_LEAD_IN_LEN + rawLen, tdms->file) == TDMS_LEAD_IN_LEN + rawLen);
+	}
+	else {
+		metaLen = tdmsMetadata(tdms->meta + TDMS_LEAD_IN_LEN, tdms, rows, (tdms->segments == 0));
+		tdmsLeadIn(tdms->meta, TDMS_TOC_METADATA | TDMS_TOC_NEW_OBJ_LIST | TDMS_TOC_RAW_DATA, metaLen, rawLen);
+		isWritten = (fwrite(tdms->meta, 1, TDMS_LEAD_IN_LEN + metaLen, tdms->file) == TDMS_LEAD_IN_LEN + metaLen
+			&& fwrite(raw, 1, rawLen, tdms->file) == rawLen);
+	}
+	tdms->segments++;
+	tdms->lastRows = rows;
+	return isWritten;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,314 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <cLinkedList.h>
+#include <NIDAQmx.h>
+#include <ansi_c.h>
+#include "quickDAQ_internal.h"
+#include <macrodef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------
+// Cycle timing Global Definitions
+//------------------------------------
+// Sample clock wait state of the session
+#define waitLastTotal	(quickDAQactiveSession->waitPrevTotal)
+#define waitLastEdge	(quickDAQactiveSession->waitPrevEdge)
+#define waitPrimed		(quickDAQactiveSession->waitIsPrimed)
+#define softClockEpoch	(quickDAQactiveSession->softEpoch)
+#define softClockTick	(quickDAQactiveSession->softTick)
+
+static const char* timingHistNames[TIMING_HIST_CNT] = { "wait", "period", "lateness", "write", "read", "wake" };
+
+//------------------------------------
+// Cycle timing function definitions
+//------------------------------------
+
+/*!
+ * \fn void setCycleTiming(bool enable)
+ * Turns the cycle timing recorder on or off and clears its statistics. When on, quickDAQcycle()
+ * and syncSampling() timestamp every sample clock wait and the write/read phases around it.
+ * The recorder uses fixed storage only and costs a few clock reads per cycle.
+ */
+void setCycleTiming(bool enable)
+{
+	resetCycleTiming();
+	quickDAQcycleTiming.enabled = (enable) ? TRUE : FALSE;
+}
+
+void resetCycleTiming()
+{
+	bool32 enabled = quickDAQcycleTiming.enabled;
+	memset(&quickDAQcycleTiming, 0, sizeof(quickDAQtiming));
+	quickDAQcycleTiming.enabled = enabled;
+}
+
+/*!
+ * \fn void recordWaitTiming(uInt64 waitBegin, uInt64 waitEnd, bool32 late)
+ * Records one sample clock wait (qdMonotonicNs timestamps taken around it) and the late flag
+ * NI-DAQmx returned for it.
+ */
+void recordWaitTiming(uInt64 waitBegin, uInt64 waitEnd, bool32 late)
+{
+	quickDAQtiming* timing = &quickDAQcycleTiming;
+	uInt64 nominal = (DAQmxSamplingRate > 0.0) ? (uInt64)(1.0e9 / DAQmxSamplingRate) : 0;
+	uInt64 period = 0;
+
+	if (timing->enabled != TRUE)
+		return;
+
+	quickDAQhistRecord(&(timing->hist[TIMING_WAIT]), waitEnd - waitBegin);
+	if (timing->lastWaitEnd != 0) {
+		period = waitEnd - timing->lastWaitEnd;
+		quickDAQhistRecord(&(timing->hist[TIMING_PERIOD]), period);
+		quickDAQhistRecord(&(timing->hist[TIMING_LATENESS]), (period > nominal) ? period - nominal : 0);
+		if (nominal != 0 && period > nominal + nominal / 2)
+			timing->missedTicks++;
+	}
+
+	if (late) {
+		timing->lateSamples++;
+		timing->lateRun++;
+		if (timing->lateRun > timing->maxLateRun)
+			timing->maxLateRun = timing->lateRun;
+	}
+	else {
+		timing->lateRun = 0;
+	}
+	timing->lastWaitBegin = waitBegin;
+	timing->lastWaitEnd = waitEnd;
+	timing->lastLate = late;
+	timing->ticks++;
+}
+
+/*!
+ * \fn void recordCycleTiming(uInt64 cycleBegin, uInt64 waitBegin, uInt64 waitEnd, uInt64 cycleEnd, bool32 late)
+ * Records one quickDAQcycle(): outputs are flushed between 'cycleBegin' and 'waitBegin', inputs are
+ * read between 'waitEnd' and 'cycleEnd'. Cycles without a sample clock wait pass 0 for both wait
+ * timestamps and are recorded as a read phase only.
+ */
+void recordCycleTiming(uInt64 cycleBegin, uInt64 waitBegin, uInt64 waitEnd, uInt64 cycleEnd, bool32 late)
+{
+	quickDAQtiming* timing = &quickDAQcycleTiming;
+
+	if (timing->enabled != TRUE)
+		return;
+
+	if (waitEnd != 0) {
+		quickDAQhistRecord(&(timing->hist[TIMING_WRITE]), waitBegin - cycleBegin);
+		quickDAQhistRecord(&(timing->hist[TIMING_READ]), cycleEnd - waitEnd);
+		recordWaitTiming(waitBegin, waitEnd, late);
+	}
+	else {
+		quickDAQhistRecord(&(timing->hist[TIMING_READ]), cycleEnd - cycleBegin);
+		timing->ticks++;
+	}
+}
+
+/*inline*/ const quickDAQtiming* getCycleTiming()
+{
+	return &quickDAQcycleTiming;
+}
+
+/*!
+ * \fn void dumpCycleTiming(FILE* stream)
+ * Prints the cycle timing counters and a percentile summary of each histogram (in microseconds).
+ */
+void dumpCycleTiming(FILE* stream)
+{
+	const quickDAQtiming* timing = &quickDAQcycleTiming;
+	const quickDAQhist* hist = NULL;
+	unsigned k = 0;
+
+	fprintf(stream, "\n*** QUICKDAQ CYCLE TIMING ***************************************************************************************\n");
+	fprintf(stream, "Ticks: %llu | Late samples: %llu | Missed ticks: %llu | Longest late run: %llu | Nominal period: %0.3f us\n",
+		(unsigned long long)timing->ticks, (unsigned long long)timing->lateSamples, (unsigned long long)timing->missedTicks,
+		(unsigned long long)timing->maxLateRun, (DAQmxSamplingRate > 0.0) ? 1.0e6 / DAQmxSamplingRate : 0.0);
+	fprintf(stream, "Wait strategy: %d | Wake overshoots: %llu\n", (int)quickDAQwaitMode, (unsigned long long)timing->wakeOvershoots);
+	fprintf(stream, "%-10s %12s %10s %10s %10s %10s %10s %10s %10s\n", "(us)", "count", "min", "mean", "p50", "p90", "p99", "p99.9", "max");
+	for (k = 0; k < TIMING_HIST_CNT; k++) {
+		hist = &(timing->hist[k]);
+		if (hist->count == 0) {
+			fprintf(stream, "%-10s %12d\n", timingHistNames[k], 0);
+			continue;
+		}
+		fprintf(stream, "%-10s %12llu %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n", timingHistNames[k], (unsigned long long)hist->count,
+			hist->min / 1000.0, ((double)hist->sum / (double)hist->count) / 1000.0,
+			quickDAQhistPercentile(hist, 50.0) / 1000.0, quickDAQhistPercentile(hist, 90.0) / 1000.0,
+			quickDAQhistPercentile(hist, 99.0) / 1000.0, quickDAQhistPercentile(hist, 99.9) / 1000.0, hist->max / 1000.0);
+	}
+	fprintf(stream, "*****************************************************************************************************************\n\n");
+}
+
+//--------------------------------------------
+// Sample clock wait strategy function definitions
+//--------------------------------------------
+
+/*!
+ * \fn void setWaitStrategy(waitModes waitMode, unsigned spinMarginUs)
+ * Selects how syncSampling() and quickDAQcycle() wait for the next sample clock edge. The polling
+ * strategies spin on the acquired-sample count of an input task (AI, else the first counter) and
+ * fall back to blocking if there is none. WAIT_HYBRID sleeps until 'spinMarginUs' before the
+ * predicted edge and spins from there. With the timing recorder on, polling waits record their
+ * wake-up latency in the TIMING_WAKE histogram. In ON_DEMAND sampling mode the same strategies
+ * pace the software sample clock (see waitForSoftClock).
+ * Must be called before quickDAQstart().
+ */
+void setWaitStrategy(waitModes waitMode, unsigned spinMarginUs)
+{
+	if (quickDAQStatus != STATUS_INIT && quickDAQStatus != STATUS_READY) {
+		quickDAQSetError(ERROR_NOTCONFIG, TRUE);
+		return;
+	}
+	quickDAQwaitMode = waitMode;
+	if (spinMarginUs > 0)
+		quickDAQwaitSpinNs = (uInt64)spinMarginUs * 1000;
+}
+
+// Called at quickDAQstart()
+void initSampleClockWait()
+{
+	quickDAQwaitTask = NULL;
+	if (quickDAQwaitMode != WAIT_BLOCKING && NItaskGroups[ANALOG_IN].count > 0)
+		quickDAQwaitTask = &(NItaskTable[NItaskGroups[ANALOG_IN].first]);
+	else if (quickDAQwaitMode != WAIT_BLOCKING && NItaskGroups[CTR_ANGLE_IN].count > 0)
+		quickDAQwaitTask = &(NItaskTable[NItaskGroups[CTR_ANGLE_IN].first]);
+	waitLastTotal = 0;
+	waitLastEdge = 0;
+	waitPrimed = FALSE;
+	softClockEpoch = 0;
+	softClockTick = 0;
+	quickDAQclockTick = 0;
+}
+
+// Spins until the acquired-sample count of the wait task moves past the last seen value
+static int32 pollSampleClock(uInt64 pollBegin)
+{
+	TaskHandle	pollTask = quickDAQwaitTask->taskHandler;
+	uInt64		timeoutNs = (uInt64)(DAQmxDefaults.IOtimeout * 1.0e9);
+	uInt64		total = 0, now = pollBegin, lastEmptyPoll = 0;
+	int32		error = 0;
+
+	if (waitPrimed != TRUE) {
+		error = DAQmxGetReadTotalSampPerChanAcquired(pollTask, &waitLastTotal);
+		if (DAQmxFailed(error))
+			return error;
+		waitPrimed = TRUE;
+	}
+
+	for (;;) {
+		error = DAQmxGetReadTotalSampPerChanAcquired(pollTask, &total);
+		now = qdMonotonicNs();
+		if (DAQmxFailed(error))
+			return error;
+		if (total > waitLastTotal)
+			break;
+		if (now - pollBegin > timeoutNs)
+			return DAQmxErrorSamplesNotYetAvailable;
+		lastEmptyPoll = now;
+		qdCpuRelax();
+	}
+
+	lateSampleWarning = (total > waitLastTotal + 1) ? TRUE : FALSE;
+	quickDAQwaitMissed = total - waitLastTotal - 1;
+	waitLastTotal = total;
+	waitLastEdge = (lastEmptyPoll != 0) ? lastEmptyPoll : now;
+	if (quickDAQcycleTiming.enabled) {
+		if (lastEmptyPoll != 0)
+			quickDAQhistRecord(&(quickDAQcycleTiming.hist[TIMING_WAKE]), now - lastEmptyPoll);
+		else
+			quickDAQcycleTiming.wakeOvershoots++;
+	}
+	return 0;
+}
+
+/*!
+ * \fn int32 waitForSampleClock(TaskHandle masterTask)
+ * Waits for the next sample clock edge of the clock master 'masterTask' using the selected strategy
+ * and sets 'lateSampleWarning' and 'quickDAQwaitMissed'.
+ *
+ * \return Returns the NI-DAQmx error code of the wait.
+ */
+int32 waitForSampleClock(TaskHandle masterTask)
+{
+	uInt64 nominal = 0, deadline = 0;
+
+	int32 error = 0;
+
+	if (quickDAQwaitTask == NULL) {
+		// NI-DAQmx only flags a late edge, so a blocking wait counts it as one missed edge
+		error = DAQmxWaitForNextSampleClock(masterTask, DAQmxDefaults.IOtimeout, &lateSampleWarning);
+		quickDAQwaitMissed = (lateSampleWarning) ? 1 : 0;
+		return error;
+	}
+
+	if (quickDAQwaitMode == WAIT_HYBRID && waitLastEdge != 0 && DAQmxSamplingRate > 0.0) {
+		nominal = (uInt64)(1.0e9 / DAQmxSamplingRate);
+		if (nominal > quickDAQwaitSpinNs) {
+			deadline = waitLastEdge + nominal - quickDAQwaitSpinNs;
+			if (deadline > qdMonotonicNs())
+				qdSleepUntilNs(deadline);
+		}
+	}
+	return pollSampleClock(qdMonotonicNs());
+}
+
+/*!
+ * \fn int32 waitForSoftClock()
+ * Software sample clock for ON_DEMAND sampling. Waits for the absolute deadline epoch + n/rate,
+ * where the epoch is the first call after quickDAQstart(), so the period never drifts with the
+ * loop's own run time. WAIT_BLOCKING sleeps on the monotonic clock, WAIT_HYBRID sleeps until the
+ * spin margin and spins the rest, WAIT_BUSY_POLL spins. A call past its deadline returns at once,
+ * sets 'lateSampleWarning' and skips the ticks that have fully passed ('quickDAQwaitMissed'),
+ * keeping the phase of later deadlines.
+ *
+ * \return Returns 0; the software clock cannot fail.
+ */
+int32 waitForSoftClock()
+{
+	const float64	periodNs = 1.0e9 / DAQmxSamplingRate;
+	uInt64			now = qdMonotonicNs(), deadline = 0, passed = 0;
+
+	if (softClockEpoch == 0) {
+		softClockEpoch = now;
+		softClockTick = 0;
+	}
+	softClockTick++;
+	deadline = softClockEpoch + (uInt64)((float64)softClockTick * periodNs);
+
+	if (now >= deadline) {
+		passed = (uInt64)((float64)(now - deadline) / periodNs);
+		softClockTick += passed;
+		lateSampleWarning = TRUE;
+		quickDAQwaitMissed = passed;
+		waitLastEdge = softClockEpoch + (uInt64)((float64)softClockTick * periodNs);
+		if (quickDAQcycleTiming.enabled)
+			quickDAQcycleTiming.wakeOvershoots++;
+		return 0;
+	}
+
+	if (quickDAQwaitMode == WAIT_BLOCKING)
+		qdSleepUntilNs(deadline);
+	else if (quickDAQwaitMode == WAIT_HYBRID && deadline > now + quickDAQwaitSpinNs)
+		qdSleepUntilNs(deadline - quickDAQwaitSpinNs);
+	// Spin the remainder (also covers sleeps that return early)
+	while ((now = qdMonotonicNs()) < deadline) {
+		qdCpuRelax();
+	}
+
+	lateSampleWarning = FALSE;
+	quickDAQwaitMissed = 0;
+	waitLastEdge = deadline;
+	if (quickDAQcycleTiming.enabled)
+		quickDAQhistRecord(&(quickDAQcycleTiming.hist[TIMING_WAKE]), now - deadline);
+	return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
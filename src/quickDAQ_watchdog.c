@@ -0,0 +1,168 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <cLinkedList.h>
+#include <NIDAQmx.h>
+#include <ansi_c.h>
+#include "quickDAQ_internal.h"
+#include <macrodef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//---------------------------------
+// Loop watchdog Global Definitions
+//---------------------------------
+// Watchdog state of the session
+#define watchdogTicks		(quickDAQactiveSession->watchdogTicks)
+#define watchdogHandler		(quickDAQactiveSession->watchdogHandler)
+#define watchdogUserData	(quickDAQactiveSession->watchdogUserData)
+#define watchdogThread		(quickDAQactiveSession->watchdogThread)
+#define watchdogWake		(quickDAQactiveSession->watchdogWake)
+#define watchdogRunning		(quickDAQactiveSession->watchdogRunning)
+#define watchdogTrips		(quickDAQactiveSession->watchdogTrips)
+
+//------------------------------------
+// Loop watchdog function definitions
+//------------------------------------
+
+/*!
+ * \fn void setWatchdog(unsigned missedTicks, quickDAQwatchdogHandler handler, void* userData)
+ * Arms a watchdog thread at quickDAQstart(). It trips when syncSampling() or quickDAQcycle() has
+ * not completed for 'missedTicks' sample clock periods, counted from the first completed cycle.
+ * On a trip it calls 'handler' from the watchdog thread, or, if 'handler' is NULL, writes the
+ * safe-state frames (see setSafeAnalogOut) to all output tasks and latches the safe state until
+ * clearSafeState(). 0 disables the watchdog. The watchdog does not start without a sampling rate
+ * above 0 (e.g. ON_DEMAND sampling without a rate). Must be called before quickDAQstart().
+ */
+void setWatchdog(unsigned missedTicks, quickDAQwatchdogHandler handler, void* userData)
+{
+	if (quickDAQStatus != STATUS_INIT && quickDAQStatus != STATUS_READY) {
+		quickDAQSetError(ERROR_NOTCONFIG, TRUE);
+		return;
+	}
+	watchdogTicks = missedTicks;
+	watchdogHandler = handler;
+	watchdogUserData = userData;
+}
+
+// Writes the safe-state frames from the watchdog thread. Errors are only printed: the error ring
+// belongs to the stalled control thread.
+static void watchdogSafeOutputs()
+{
+	NItask	*myTask = NULL;
+	int32	error = 0;
+
+	qdAtomicStore(&quickDAQsafeState, TRUE);
+	if (quickDAQreplay != NULL)
+		return;
+	for (myTask = firstNItask(); myTask != NULL; myTask = nextNItask(myTask)) {
+		if (myTask->taskType == ANALOG_OUT)
+			error = DAQmxWriteAnalogF64(myTask->taskHandler, DAQmxDefaults.NIsamplesPerCh, DAQmxDefaults.AnalogAutoStart,
+				DAQmxDefaults.IOtimeout, DAQmxDefaults.dataLayout, (float64*)myTask->safeBuffer, NULL, NULL);
+		else if (myTask->taskType == DIGITAL_OUT)
+			error = DAQmxWriteDigitalU32(myTask->taskHandler, DAQmxDefaults.NIsamplesPerCh, DAQmxDefaults.DigiAutoStart,
+				DAQmxDefaults.IOtimeout, DAQmxDefaults.dataLayout, (uInt32*)myTask->safeBuffer, NULL, NULL);
+		else
+			continue;
+		if (DAQmxFailed(error))
+			fprintf(ERRSTREAM, "QuickDAQ library: Warning: Watchdog could not write the safe state (NI-DAQmx error %ld).\n", (long)error);
+	}
+}
+
+// Watchdog thread: samples the heartbeat a few times per timeout and trips once per stall
+static QD_THREAD_FUNC(watchdogThreadFunc, arg)
+{
+	uInt64		timeoutNs = 0, lastChange = 0, now = 0;
+	uint64_t	lastBeat = 0, beat = 0;
+	unsigned	pollMs = 1;
+	bool32		hasTripped = FALSE;
+
+	quickDAQsetSession((quickDAQSession*)arg);
+	timeoutNs = (uInt64)((float64)watchdogTicks * 1e9 / DAQmxSamplingRate);
+	if (timeoutNs / 4000000ULL > 1)
+		pollMs = (unsigned)(timeoutNs / 4000000ULL);
+	lastBeat = qdAtomicLoadRelaxed(&quickDAQheartbeat);
+	lastChange = qdMonotonicNs();
+
+	while (qdAtomicLoad(&watchdogRunning)) {
+		qdEventWait(&watchdogWake, pollMs);
+		beat = qdAtomicLoadRelaxed(&quickDAQheartbeat);
+		now = qdMonotonicNs();
+		if (beat != lastBeat) {
+			lastBeat = beat;
+			lastChange = now;
+			hasTripped = FALSE;
+			continue;
+		}
+		// Not armed before the first cycle, and trips once per stall
+		if (beat == 0 || hasTripped || now - lastChange < timeoutNs || !qdAtomicLoad(&watchdogRunning))
+			continue;
+
+		hasTripped = TRUE;
+		qdAtomicFetchAdd(&watchdogTrips, 1);
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Watchdog tripped, no cycle completed for %.1f ms.\n", (now - lastChange) / 1e6);
+		if (watchdogHandler != NULL)
+			watchdogHandler(beat, watchdogUserData);
+		else
+			watchdogSafeOutputs();
+	}
+	QD_THREAD_RETURN;
+}
+
+// Called by quickDAQstart() once all tasks run
+void startWatchdog()
+{
+	if (watchdogTicks == 0)
+		return;
+	// The timeout is counted in sample clock periods: without a rate there is no period
+	if (!(DAQmxSamplingRate > 0.0)) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: The watchdog needs a sampling rate above 0. Watchdog disabled.\n");
+		return;
+	}
+	quickDAQbeatCount = 0;
+	qdAtomicStoreRelaxed(&quickDAQheartbeat, 0);
+	qdAtomicStore(&watchdogTrips, 0);
+	if (qdEventInit(&watchdogWake) != 0) {
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Unable to start the watchdog thread.\n");
+		return;
+	}
+	qdAtomicStore(&watchdogRunning, 1);
+	if (qdThreadCreate(&watchdogThread, watchdogThreadFunc, (void*)quickDAQactiveSession) != 0) {
+		qdAtomicStore(&watchdogRunning, 0);
+		qdEventDestroy(&watchdogWake);
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Unable to start the watchdog thread.\n");
+	}
+}
+
+void stopWatchdog()
+{
+	if (!qdAtomicLoad(&watchdogRunning))
+		return;
+	qdAtomicStore(&watchdogRunning, 0);
+	qdEventSignal(&watchdogWake);
+	qdThreadJoin(watchdogThread);
+	qdEventDestroy(&watchdogWake);
+}
+
+/*inline*/ uInt64 getWatchdogTrips()
+{
+	return qdAtomicLoad(&watchdogTrips);
+}
+
+/*!
+ * \fn void quickDAQbeat()
+ * Bumps the heartbeat watched by the loop watchdog, once per control loop iteration. The count is
+ * kept by the control thread and published with one plain 64-bit store: no lock or syscall.
+ */
+void quickDAQbeat()
+{
+	qdAtomicStoreRelaxed(&quickDAQheartbeat, ++quickDAQbeatCount);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <quickDAQ_workers.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-------------------------------------
+// Worker pool function definitions
+//-------------------------------------
+
+// Wakes the parked workers after a generation bump. This fence and the one of the parking worker
+// order 'generation' against 'isParked', so no wake-up is lost. Spinning workers cost no syscall.
+static void wakeParkedWorkers(quickDAQworkerPool* pool)
+{
+	unsigned workerNum;
+
+	qdAtomicFence();
+	for (workerNum = 0; workerNum < pool->workerCount; workerNum++) {
+		if (qdAtomicLoad(&pool->workers[workerNum].isParked))
+			qdEventSignal(&pool->workers[workerNum].wake);
+	}
+}
+
+// Worker 'n' runs job numbers n+1, n+1+(W+1), ... of each generation; the dispatcher runs the
+// job numbers that are multiples of (W+1). Workers spin on the generation counter, then park on
+// their wake event once idle for QUICKDAQ_WORKER_SPIN_NS.
+static QD_THREAD_FUNC(poolWorkerThread, arg)
+{
+	quickDAQworker*		worker = (quickDAQworker*)arg;
+	quickDAQworkerPool*	pool = worker->pool;
+	uint64_t			seenGeneration = 0, generation = 0, idleSince = 0;
+	unsigned			idleSpins = 0, jobNum = 0, jobStride = 0;
+
+	if (pool->threadInit != NULL)
+		pool->threadInit(pool->initArg);
+	if (worker->cpu >= 0 && qdPinCurrentThread(worker->cpu) != 0)
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Could not pin worker %u to CPU %d.\n", worker->workerNum, worker->cpu);
+
+	for (;;) {
+		generation = qdAtomicLoad(&pool->generation);
+		if (generation == seenGeneration) {
+			// The clock is read every 256 polls only
+			if (idleSpins++ == 0)
+				idleSince = qdMonotonicNs();
+			else if ((idleSpins & 0xFF) == 0 && qdMonotonicNs() - idleSince > QUICKDAQ_WORKER_SPIN_NS) {
+				qdAtomicStore(&worker->isParked, 1);
+				qdAtomicFence();
+				if (qdAtomicLoad(&pool->generation) == seenGeneration)
+					qdEventWait(&worker->wake, QUICKDAQ_WORKER_PARK_MS);
+				qdAtomicStore(&worker->isParked, 0);
+				idleSpins = 0;
+				continue;
+			}
+			qdCpuRelax();
+			continue;
+		}
+		idleSpins = 0;
+		seenGeneration = generation;
+		if (!qdAtomicLoad(&pool->isRunning))
+			break;
+
+		jobStride = pool->workerCount + 1;
+		for (jobNum = worker->workerNum + 1; jobNum < pool->jobCount; jobNum += jobStride) {
+			pool->job(jobNum, pool->jobArg);
+		}
+		qdAtomicFetchAdd(&pool->pending, (uint64_t)-1);
+	}
+	QD_THREAD_RETURN;
+}
+
+/*!
+ * \fn quickDAQworkerPool* quickDAQpoolCreateEx(unsigned workerCount, const int* cpuList, quickDAQworkerInit threadInit, void* initArg)
+ * Creates a pool of 'workerCount' worker threads (at most QUICKDAQ_MAX_WORKERS).
+ * Worker 'n' is pinned to cpuList[n] if 'cpuList' is not NULL and cpuList[n] >= 0. Each worker
+ * calls threadInit(initArg) when it starts, if 'threadInit' is not NULL.
+ */
+quickDAQworkerPool* quickDAQpoolCreateEx(unsigned workerCount, const int* cpuList, quickDAQworkerInit threadInit, void* initArg)
+{
+	quickDAQworkerPool* pool = NULL;
+	unsigned workerNum;
+
+	if (workerCount > QUICKDAQ_MAX_WORKERS)
+		workerCount = QUICKDAQ_MAX_WORKERS;
+
+	pool = (quickDAQworkerPool*)qdAlignedAlloc(QD_CACHELINE, sizeof(quickDAQworkerPool));
+	if (pool == NULL)
+		return NULL;
+	memset(pool, 0, sizeof(quickDAQworkerPool));
+	pool->isRunning = 1;
+	pool->threadInit = threadInit;
+	pool->initArg = initArg;
+
+	for (workerNum = 0; workerNum < workerCount; workerNum++) {
+		pool->workers[workerNum].pool = pool;
+		pool->workers[workerNum].workerNum = workerNum;
+		pool->workers[workerNum].cpu = (cpuList != NULL) ? cpuList[workerNum] : -1;
+		if (qdEventInit(&(pool->workers[workerNum].wake)) != 0)
+			break;
+		if (qdThreadCreate(&(pool->workers[workerNum].thread), poolWorkerThread, (void*)&(pool->workers[workerNum])) != 0) {
+			qdEventDestroy(&(pool->workers[workerNum].wake));
+			break;
+		}
+		pool->workerCount++;
+	}
+	if (pool->workerCount != workerCount)
+		fprintf(ERRSTREAM, "QuickDAQ library: Warning: Only %u of %u worker threads could be started.\n", pool->workerCount, workerCount);
+	return pool;
+}
+
+void quickDAQpoolDestroy(quickDAQworkerPool* pool)
+{
+	unsigned workerNum;
+
+	if (pool == NULL)
+		return;
+	qdAtomicStore(&pool->isRunning, 0);
+	qdAtomicFetchAdd(&pool->generation, 1);
+	wakeParkedWorkers(pool);
+	for (workerNum = 0; workerNum < pool->workerCount; workerNum++) {
+		qdThreadJoin(pool->workers[workerNum].thread);
+		qdEventDestroy(&(pool->workers[workerNum].wake));
+	}
+	qdAlignedFree(pool);
+}
+
+/*!
+ * \fn void quickDAQpoolRun(quickDAQworkerPool* pool, unsigned jobCount, quickDAQjob job, void* jobArg)
+ * Runs job(0, jobArg) ... job(jobCount-1, jobArg) across the pool and the calling thread.
+ * Returns once every job has completed. Must only be called from one thread at a time.
+ */
+void quickDAQpoolRun(quickDAQworkerPool* pool, unsigned jobCount, quickDAQjob job, void* jobArg)
+{
+	unsigned jobNum, jobStride = pool->workerCount + 1;
+
+	pool->job = job;
+	pool->jobArg = jobArg;
+	pool->jobCount = jobCount;
+	qdAtomicStore(&pool->pending, pool->workerCount);
+	qdAtomicFetchAdd(&pool->generation, 1);
+	wakeParkedWorkers(pool);
+
+	for (jobNum = 0; jobNum < jobCount; jobNum += jobStride) {
+		job(jobNum, jobArg);
+	}
+	while (qdAtomicLoad(&pool->pending) != 0) {
+		qdCpuRelax();
+	}
+}
+
+#ifdef __cplusplus
+}
+#endif